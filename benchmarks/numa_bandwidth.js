@@ -0,0 +1,95 @@
+const fs = require('fs');
+const os = require('os');
+const path = require('path');
+const { execFileSync } = require('child_process');
+
+// ==========================================
+// CONFIGURATION
+// ==========================================
+// Usage: node benchmarks/numa_bandwidth.js [file] [--fake N]
+//   --fake N  splits this machine's CPUs into N fake nodes (FASTSCAN_NUMA_SYSFS),
+//             so placement can be exercised on a single-node box
+const args = process.argv.slice(2);
+const fakeAt = args.indexOf('--fake');
+const FAKE_NODES = fakeAt >= 0 ? parseInt(args.splice(fakeAt, 2)[1], 10) : 0;
+const TARGET_FILE = args[0] || path.join(__dirname, 'big_data.log');
+const ITERATIONS = 5;
+const PATTERN = 'ERROR';
+
+if (!fs.existsSync(TARGET_FILE)) {
+    console.error(`Error: File '${TARGET_FILE}' not found.`);
+    process.exit(1);
+}
+
+// ==========================================
+// UTILITIES
+// ==========================================
+function printSeparator() {
+    console.log("------------------------------------------------------------");
+}
+
+// nodeN/cpulist files with the CPUs dealt out in contiguous blocks
+function makeFakeTopology(nodes) {
+    const root = fs.mkdtempSync(path.join(os.tmpdir(), 'fastscan-numa-'));
+    const cpus = os.cpus().length;
+    for (let n = 0; n < nodes; n++) {
+        const lo = Math.floor(cpus * n / nodes);
+        const hi = Math.floor(cpus * (n + 1) / nodes) - 1;
+        fs.mkdirSync(path.join(root, `node${n}`));
+        fs.writeFileSync(path.join(root, `node${n}`, 'cpulist'), hi >= lo ? `${lo}-${hi}\n` : '\n');
+    }
+    return root;
+}
+
+// Best of ITERATIONS countFile runs in a child process, pinned to `cpus` when given
+function measure(env, cpus) {
+    const child = `
+        const fastscan = require(${JSON.stringify(path.join(__dirname, '../src/index'))});
+        fastscan.warmup();
+        fastscan.countFile(process.argv[1], ${JSON.stringify(PATTERN)});
+        let best = Infinity;
+        for (let i = 0; i < ${ITERATIONS}; i++) {
+            const t = process.hrtime.bigint();
+            fastscan.countFile(process.argv[1], ${JSON.stringify(PATTERN)});
+            best = Math.min(best, Number(process.hrtime.bigint() - t) / 1e6);
+        }
+        console.log(best);
+    `;
+    const cmd = cpus ? ['taskset', ['-c', cpus.join(','), process.execPath, '-e', child, TARGET_FILE]]
+                     : [process.execPath, ['-e', child, TARGET_FILE]];
+    return parseFloat(execFileSync(cmd[0], cmd[1], { env, encoding: 'utf8' }));
+}
+
+// ==========================================
+// MAIN EXECUTION
+// ==========================================
+const env = { ...process.env };
+if (FAKE_NODES > 0) env.FASTSCAN_NUMA_SYSFS = makeFakeTopology(FAKE_NODES);
+
+// The topology as the addon reads it (fake or real)
+const nodes = JSON.parse(execFileSync(process.execPath,
+    ['-e', `console.log(JSON.stringify(require(${JSON.stringify(path.join(__dirname, '../src/index'))}).numaNodes))`],
+    { env, encoding: 'utf8' }));
+
+const size = fs.statSync(TARGET_FILE).size;
+const gbps = (ms) => (size / 1e9 / (ms / 1000)).toFixed(2);
+
+console.log(`🚀 FastScan NUMA Bandwidth`);
+console.log(`📁 File: ${TARGET_FILE} (${(size / 1024 / 1024).toFixed(2)} MB, pattern "${PATTERN}")`);
+console.log(`🧩 Nodes: ${nodes.length}${FAKE_NODES ? ` (fake: ${env.FASTSCAN_NUMA_SYSFS})` : ''}`);
+printSeparator();
+
+nodes.forEach((cpus, n) => {
+    if (cpus.length === 0) {
+        console.log(`  [Node ${n}] no CPUs, skipped`);
+        return;
+    }
+    const ms = measure(env, cpus);
+    console.log(`  [Node ${n}] ${cpus.length} CPUs: ${ms.toFixed(2)} ms, ${gbps(ms)} GB/s`);
+});
+
+const ms = measure(env, null);
+console.log(`  [All nodes] ${os.cpus().length} CPUs: ${ms.toFixed(2)} ms, ${gbps(ms)} GB/s`);
+printSeparator();
+
+if (FAKE_NODES > 0) fs.rmSync(env.FASTSCAN_NUMA_SYSFS, { recursive: true, force: true });
@@ -6,7 +6,28 @@
         "native/src/addon.c",
         "native/src/scanner.c",
         "native/src/mmap_reader.c",
-        "native/src/fastscan.c"
+        "native/src/fastscan.c",
+        "native/src/cpu_features.c",
+        "native/src/byte_freq.c",
+        "native/src/kernels.c",
+        "native/src/skip_search.c",
+        "native/src/multi_literal.c",
+        "native/src/multi_ssse3.c",
+        "native/src/multi_avx2.c",
+        "native/src/multi_avx512.c",
+        "native/src/dictionary.c",
+        "native/src/regex.c",
+        "native/src/regex_dfa.c",
+        "native/src/pattern.c",
+        "native/src/thread_pool.c",
+        "native/src/numa_topology.c",
+        "native/src/parallelism.c",
+        "native/src/scan_executor.c",
+        "native/src/stream_reader.c",
+        "native/src/uring_reader.c",
+        "native/src/kernels_sse2.c",
+        "native/src/kernels_avx2.c",
+        "native/src/kernels_avx512.c"
       ],
       "include_dirs": [
         "native/include"
@@ -0,0 +1,27 @@
+#ifndef FASTSCAN_BYTE_FREQ_H
+#define FASTSCAN_BYTE_FREQ_H
+
+#include "safe_types.h"
+
+// Lower score = rarer byte = better prefilter candidate
+typedef struct {
+    uint32_t score[256];
+} fs_byte_model_t;
+
+// Pattern positions compared by the SIMD prefilter (equal for 1-byte patterns)
+typedef struct {
+    fs_size_t first;
+    fs_size_t second;
+} fs_rare_pair_t;
+
+
+// Built-in byte ranks for typical log text
+void fs_byte_model_builtin(fs_byte_model_t* model);
+
+// Learns from evenly spaced samples of `data`; the built-in ranks break ties
+void fs_byte_model_learn(fs_byte_model_t* model, const fs_byte_t* data, fs_size_t size);
+
+// Picks the two rarest pattern positions (model may be NULL for the built-in table)
+fs_rare_pair_t fs_pick_rare_pair(const fs_byte_t* pattern, fs_size_t pattern_len, const fs_byte_model_t* model);
+
+#endif // FASTSCAN_BYTE_FREQ_H
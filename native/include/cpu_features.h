@@ -0,0 +1,22 @@
+#ifndef FASTSCAN_CPU_FEATURES_H
+#define FASTSCAN_CPU_FEATURES_H
+
+// SIMD instruction set levels, ordered by vector width
+typedef enum {
+    FS_ISA_SSE2 = 0,     // 16 bytes per compare (baseline x86-64)
+    FS_ISA_AVX2,         // 32 bytes per compare
+    FS_ISA_AVX512BW      // 64 bytes per compare
+} fs_isa_t;
+
+
+// Detects the best ISA once (cpuid + OS support). Safe to call repeatedly.
+// FASTSCAN_ISA=sse2|avx2|avx512bw in the environment can only lower the level.
+void fs_cpu_init(void);
+
+
+fs_isa_t fs_cpu_isa(void);
+
+
+const char* fs_isa_name(fs_isa_t isa);
+
+#endif // FASTSCAN_CPU_FEATURES_H
@@ -0,0 +1,66 @@
+#ifndef FASTSCAN_DICTIONARY_H
+#define FASTSCAN_DICTIONARY_H
+
+#include "safe_types.h"
+#include "matcher.h"
+
+// Pattern ids must fit the tag bits of a packed match
+#define FS_DICT_MAX_PATTERNS (1u << (64 - FS_MATCH_ID_SHIFT))
+
+// Prefilter key: the first min(8, shortest length) bytes of a position, hashed
+// into a blocked Bloom filter (3 bits in one 64-bit word) of ~32 bits per
+// unique pattern, 2^16 .. 2^28 bits
+#define FS_DICT_MAX_PREFIX 8
+#define FS_DICT_FILTER_MIN_BITS 16
+#define FS_DICT_FILTER_MAX_BITS 28
+
+// One trie slot; base/check/term of a node share a cache line
+typedef struct {
+    int32_t base;       // Inner node: child of byte c is base + c. Leaf: -(u + 1), u = unique pattern
+    int32_t check;      // Parent slot, -1 when free
+    uint32_t term;      // Inner node where unique pattern u ends: u + 1, else 0
+} fs_dict_node_t;
+
+/*
+ * Large literal sets (up to ~1M patterns), built once and shared read-only by
+ * every scan and thread. Branching prefixes live in a double-array trie; once
+ * a prefix is unique, the rest of the pattern is compared straight from the
+ * pattern bytes (tail), so the arrays only hold the top few levels.
+ */
+typedef struct {
+    // Double-array trie; slot 0 is the root
+    fs_dict_node_t* nodes;
+    fs_size_t size;
+    fs_size_t capacity;
+
+    // Sorted unique patterns and the ids (input order) that share each one
+    const fs_byte_t** ustr;
+    uint32_t* ulen;
+    uint32_t* id_start; // ids of u: ids[id_start[u] .. id_start[u + 1])
+    uint32_t* ids;
+    fs_size_t unique;
+
+    fs_size_t count;
+    fs_size_t min_len;
+    fs_size_t max_len;
+    fs_size_t max_per_pos;
+
+    // Prefilter over the first `prefix` bytes of every pattern
+    fs_size_t prefix;
+    uint64_t prefix_mask;
+    int filter_shift;   // 64 - log2(words)
+    uint64_t* filter;
+
+    fs_byte_t* blob;    // Owned copy of all pattern bytes
+} fs_dict_t;
+
+// From a list; pattern i gets id i. Empty patterns are allowed and never match.
+fs_status_t fs_dict_build(fs_dict_t* d, const fs_byte_t* const* patterns, const fs_size_t* lens, fs_size_t count);
+
+// From a newline separated file (\r\n accepted); the pattern on line i gets id i
+fs_status_t fs_dict_load(fs_dict_t* d, const char* filepath);
+
+void fs_dict_destroy(fs_dict_t* d);
+void fs_dict_matcher(fs_matcher_t* out, const fs_dict_t* d);
+
+#endif // FASTSCAN_DICTIONARY_H
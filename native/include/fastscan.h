@@ -3,20 +3,65 @@
 
 #include "safe_types.h"
 #include "config.h"
+#include "kernels.h"
+#include "matcher.h"
+#include "pattern.h"
 
 
 typedef struct {
     const fs_byte_t* data; 
     fs_size_t size;        
     int fd;                
+    int stream;            // Not mappable (pipe, FIFO, device, /proc...): data is NULL, read through stream_reader.h
+    int windowed;          // data is NULL: scans map FS_MMAP_WINDOW bytes at a time (mmap_reader.h)
+    int uring;             // Whole-file scans read it through io_uring (uring_reader.h); ranges use the mapping
+    int direct;            // ...with O_DIRECT
+    int once;              // Read for one scan: no read-ahead past the range a scan thread is on (fs_pagein_t)
+    int evict;             // ...and what the scan reads into the page cache is evicted behind it
 } fs_region_t;
 
+// How fastscan_load_file reads a regular file (ctx->io_mode, set before loading it)
+typedef enum {
+    FS_IO_AUTO = 0,        // io_uring for a cold file of FS_URING_MIN_SIZE or more; windows from FS_MMAP_WINDOW_MIN_SIZE
+    FS_IO_MMAP,            // Mapped whole and paged in
+    FS_IO_URING,           // io_uring reads into buffers
+    FS_IO_DIRECT,          // io_uring with O_DIRECT: the page cache is neither used nor filled
+    FS_IO_WINDOW,          // Mapped a window per scan thread at a time
+    FS_IO_ONCE             // Mapped, and the page cache left as it was found: pages the scan reads in are evicted
+} fs_io_mode_t;
+
+
+// Progress of a running scan, as handed to on_progress
+typedef struct {
+    fs_size_t bytes_scanned;    // Bytes of the file the tasks have got through so far
+    fs_size_t total_bytes;
+    fs_size_t matches;          // Found so far (lines in line mode); at most max_matches except when counting
+} fs_progress_t;
+
+// Called from whichever scan thread finds a report due; must not block
+typedef void (*fs_progress_fn)(void* arg, const fs_progress_t* progress);
+
+// Takes the matches of a stream scan as they are found: offsets (tagged ones still packed, see
+// FS_MATCH_*), or in line mode `count` (start, end, number) triples; and with count 0 after every
+// block, a point to pass on what it has gathered. Non-zero stops the scan.
+typedef int (*fs_stream_sink_fn)(void* arg, const fs_size_t* items, fs_size_t count);
 
 typedef struct {
-    // Input
+    // Literal input, kept so sample_frequencies can re-pick its rare pair (NULL otherwise)
     const char* pattern;
     fs_size_t pattern_len;
 
+    // Needle re-prepared from a sample of the file; replaces the compiled one for this scan
+    fs_needle_t needle;
+    int sample_frequencies;
+
+    // What is scanned: shared (fastscan_init_pattern) or compiled for this context (owned_pattern)
+    const fastscan_pattern_t* compiled;
+    fastscan_pattern_t* owned_pattern;
+
+    // What fastscan_execute runs: the compiled pattern's matcher, or one over `needle`
+    fs_matcher_t matcher;
+
 
     fs_region_t region;
 
@@ -25,14 +70,73 @@ typedef struct {
     fs_size_t match_count;
     fs_size_t max_matches;
 
+    // Pattern index of each match (multi-literal only, parallel to matches)
+    uint32_t* match_ids;
+
+    // Line mode (set before fastscan_execute): one entry per matching line, `matches` holds the line
+    // starts, max_matches caps lines. Ends are the offset of the '\n' (or the file size); numbers start at 1.
+    int line_mode;
+    fs_size_t* line_ends;
+    fs_size_t* line_numbers;
+
+    // Threads per scan, the caller included (0: from the CPUs the process may use, see parallelism.h)
+    int threads;
+
+    // io_uring applies to fastscan_execute and fastscan_count of literals and pattern lists, when the
+    // kernel allows it, and windows to any scan of them; regular expressions, line mode and stream
+    // regions always use their usual path
+    fs_io_mode_t io_mode;
+
+    // Set to non-zero by another thread to stop the scan: running tasks notice within CANCEL_STEP bytes,
+    // the partial results are freed and the scan returns FS_ERROR_CANCELLED. NULL: not cancellable.
+    const int32_t* cancel;
+
+    // Progress reports (NULL: none): at most one per progress_interval_ms while the scan runs, read from
+    // per-task counters, and a last one with bytes_scanned == total_bytes when it completes
+    fs_progress_fn on_progress;
+    void* progress_arg;
+    uint32_t progress_interval_ms;
+
 
     int is_initialized;
 } fastscan_ctx_t;
 
 
+// One-time CPU detection and kernel selection (idempotent)
+void fastscan_global_init(void);
+
+// Starts the worker pool that multi-threaded scans run on (otherwise started by the first one);
+// returns its number of workers. Idempotent. A scan asking for more threads grows the pool.
+int fastscan_warmup(void);
+
+// The one-shot inits compile a pattern owned by the context; the inputs may be freed afterwards
 fs_status_t fastscan_init(fastscan_ctx_t* ctx, const char* pattern, fs_size_t max_results);
+// Several literals in one pass. Matches come out
+// ordered by offset, then pattern index. Above FS_MULTI_MAX_PATTERNS a dictionary is built.
+fs_status_t fastscan_init_multi(fastscan_ctx_t* ctx, const char* const* patterns, const fs_size_t* lens,
+                                fs_size_t count, fs_size_t max_results);
+
+// Compiled pattern, not owned; it may serve many contexts at once and must outlive them
+fs_status_t fastscan_init_pattern(fastscan_ctx_t* ctx, const fastscan_pattern_t* pattern, fs_size_t max_results);
+
+// Offsets of every match start; FS_ERROR_INVALID_ARG for syntax the engine does not support
+fs_status_t fastscan_init_regex(fastscan_ctx_t* ctx, const char* pattern, fs_size_t len, fs_size_t max_results);
+// Maps a regular file; anything else (or a file that reports a size of 0) becomes a stream region
 fs_status_t fastscan_load_file(fastscan_ctx_t* ctx, const char* filepath);
 fs_status_t fastscan_execute(fastscan_ctx_t* ctx);
+
+// Matches starting in [from, to) only (reads may run past `to`), first max_matches of them in order.
+// Streaming scans call it window after window, with matches freed or handed off in between.
+// Not for line mode (FS_ERROR_INVALID_ARG unless the range is the whole file) nor stream regions.
+fs_status_t fastscan_execute_range(fastscan_ctx_t* ctx, fs_size_t from, fs_size_t to);
+
+// Stream regions only (region.stream): matches go to sink block by block instead of being stored,
+// max_matches is not applied. fastscan_execute and fastscan_count handle streams on their own.
+fs_status_t fastscan_execute_stream(fastscan_ctx_t* ctx, fs_stream_sink_fn sink, void* arg);
+
+// Count only: match_count gets the number of matches in the whole file (max_results is ignored);
+// no offsets are stored, memory stays O(threads)
+fs_status_t fastscan_count(fastscan_ctx_t* ctx);
 void fastscan_destroy(fastscan_ctx_t* ctx);
 
 #endif // FASTSCAN_FASTSCAN_H
@@ -0,0 +1,96 @@
+#ifndef FASTSCAN_KERNELS_H
+#define FASTSCAN_KERNELS_H
+
+#include "safe_types.h"
+#include "byte_freq.h"
+#include "cpu_features.h"
+
+// Pattern length classes, each with its own verification sequence
+typedef enum {
+    FS_LEN_1 = 0,
+    FS_LEN_2,
+    FS_LEN_3,
+    FS_LEN_4,
+    FS_LEN_5_8,
+    FS_LEN_9_16,
+    FS_LEN_LONG,
+    FS_LEN_CLASSES
+} fs_len_class_t;
+
+typedef struct fs_needle fs_needle_t;
+
+// Long-pattern sampling filter (skip_search.c): gram length and hash buckets
+#define FS_SKIP_GRAM 8
+#define FS_SKIP_SAMPLE (2 * FS_SKIP_GRAM)
+#define FS_SKIP_HASH_BITS 12
+#define FS_SKIP_TABLE_SIZE (1 << FS_SKIP_HASH_BITS)
+
+// Patterns at least this long use the sampling filter instead of the rare-pair prefilter
+#define FS_SKIP_MIN_LEN 160
+
+// ...unless some gram repeats this often in the pattern (periodic needles)
+#define FS_SKIP_MAX_CHAIN 32
+
+/*
+ * Kernel contract: scans start positions [p, limit) and appends the offsets
+ * (relative to `base`) of every match to out[*count .. cap). No byte at or past
+ * `end` is read, so `limit` must not exceed end - len + 1.
+ *
+ * Returns `limit` when the range is exhausted, or the position of the first
+ * match that did not fit so the caller can grow `out` and resume from there.
+ */
+typedef const fs_byte_t* (*fs_kernel_fn)(const fs_needle_t* n, const fs_byte_t* p, const fs_byte_t* limit,
+                                         const fs_byte_t* end, const fs_byte_t* base,
+                                         fs_size_t* out, fs_size_t* count, fs_size_t cap);
+
+// Count-only variant: number of matches starting in [p, limit), same reads, nothing written
+typedef fs_size_t (*fs_count_kernel_fn)(const fs_needle_t* n, const fs_byte_t* p, const fs_byte_t* limit,
+                                        const fs_byte_t* end);
+
+// A pattern prepared for scanning: prefilter pair, verify words and kernel
+struct fs_needle {
+    const fs_byte_t* bytes;   // Not owned
+    fs_size_t len;
+    fs_len_class_t len_class;
+    fs_rare_pair_t rare;
+
+    // First / last 8 bytes (zero padded), compared as words by the verifiers
+    uint64_t head;
+    uint64_t tail;
+
+    fs_kernel_fn scan;
+    fs_kernel_fn fallback;    // Rare-pair kernel for this length; `scan` may delegate to it
+    fs_count_kernel_fn count; // NULL when `scan` is not the rare-pair kernel (counted through `scan`)
+
+    // Long patterns only (owned): gram hash -> chain of pattern offsets, see skip_search.c
+    uint16_t* skip_head;
+    uint16_t* skip_next;
+};
+
+
+// Picks the rare pair (model may be NULL) and the kernel for the running CPU.
+// Re-initializing requires fs_needle_destroy first (long needles own a table).
+fs_status_t fs_needle_init(fs_needle_t* n, const fs_byte_t* pattern, fs_size_t len, const fs_byte_model_t* model);
+void fs_needle_destroy(fs_needle_t* n);
+
+fs_len_class_t fs_len_class(fs_size_t len);
+fs_kernel_fn fs_kernel_select(fs_isa_t isa, fs_len_class_t len_class);
+fs_count_kernel_fn fs_counter_select(fs_isa_t isa, fs_len_class_t len_class);
+
+// Sublinear engine for long needles (ISA independent). Returns 0 when the
+// needle is unsuitable (too periodic) or on allocation failure.
+int fs_skip_table_init(fs_needle_t* n);
+void fs_skip_table_free(fs_needle_t* n);
+const fs_byte_t* fs_skip_scan(const fs_needle_t* n, const fs_byte_t* p, const fs_byte_t* limit,
+                              const fs_byte_t* end, const fs_byte_t* base,
+                              fs_size_t* out, fs_size_t* count, fs_size_t cap);
+
+// One table per instruction set, indexed by fs_len_class_t
+extern const fs_kernel_fn fs_kernels_sse2[FS_LEN_CLASSES];
+extern const fs_kernel_fn fs_kernels_avx2[FS_LEN_CLASSES];
+extern const fs_kernel_fn fs_kernels_avx512[FS_LEN_CLASSES];
+extern const fs_count_kernel_fn fs_counters_sse2[FS_LEN_CLASSES];
+extern const fs_count_kernel_fn fs_counters_avx2[FS_LEN_CLASSES];
+extern const fs_count_kernel_fn fs_counters_avx512[FS_LEN_CLASSES];
+
+#endif // FASTSCAN_KERNELS_H
@@ -0,0 +1,40 @@
+#ifndef FASTSCAN_MATCHER_H
+#define FASTSCAN_MATCHER_H
+
+#include "safe_types.h"
+
+typedef struct fs_matcher fs_matcher_t;
+
+/*
+ * Span contract, shared by every engine fastscan_execute can run: reports
+ * matches starting in [from, to) of data, reading at most up to data_len,
+ * appended to out[*count .. cap) in ascending offset order. Returns the offset
+ * to resume from: `to` when done, else the first position whose matches did
+ * not all fit (nothing of that position has been written).
+ */
+typedef fs_size_t (*fs_span_fn)(const fs_matcher_t* m, const fs_byte_t* data, fs_size_t data_len,
+                                fs_size_t from, fs_size_t to, fs_size_t* out, fs_size_t* count, fs_size_t cap);
+
+// Optional count-only counterpart of span: number of matches starting in [from, to), no cap
+typedef fs_size_t (*fs_span_count_fn)(const fs_matcher_t* m, const fs_byte_t* data, fs_size_t data_len,
+                                      fs_size_t from, fs_size_t to);
+
+struct fs_matcher {
+    fs_span_fn span;
+    fs_span_count_fn count;   // NULL: counted through span into a small reused buffer
+    const void* impl;         // fs_needle_t, fs_multi_t, ... (not owned)
+
+    fs_size_t max_len;        // Longest match: a chunk reads up to max_len - 1 bytes past its end
+                              // ((fs_size_t)-1: up to the end of the line, see regex.h)
+    fs_size_t max_per_pos;    // Most matches one start position can produce (callers keep that much room)
+    int tagged;               // Matches carry a pattern id (see FS_MATCH_*)
+};
+
+// Tagged matches pack the pattern id above a 44-bit (16TB) offset
+#define FS_MATCH_ID_SHIFT 44
+#define FS_MATCH_OFFSET_MASK ((((fs_size_t)1) << FS_MATCH_ID_SHIFT) - 1)
+#define FS_MATCH_PACK(offset, id) ((fs_size_t)(offset) | ((fs_size_t)(id) << FS_MATCH_ID_SHIFT))
+#define FS_MATCH_OFFSET(m) ((m) & FS_MATCH_OFFSET_MASK)
+#define FS_MATCH_ID(m) ((uint32_t)((m) >> FS_MATCH_ID_SHIFT))
+
+#endif // FASTSCAN_MATCHER_H
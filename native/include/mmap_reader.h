@@ -4,8 +4,93 @@
 #include "fastscan.h"
 
 
+// Bytes mapped ahead of a scan cursor (MADV_POPULATE_READ), and read ahead of those (MADV_WILLNEED)
+#define FS_PAGEIN_STEP (1024 * 1024)
+#define FS_PAGEIN_AHEAD (8 * 1024 * 1024)
+
+// Scanned bytes a cursor leaves mapped behind it before they are dropped
+#define FS_PAGEIN_DROP (4 * 1024 * 1024)
+
+// Pages between the dropped ones and the read-ahead front, whose earlier state eviction needs
+#define FS_PAGEIN_PAGES ((FS_PAGEIN_AHEAD + FS_PAGEIN_DROP + 2 * FS_PAGEIN_STEP) / FS_MEMORY_ALIGNMENT)
+
+// Windowed regions: each scan thread maps FS_MMAP_WINDOW bytes at a time (plus what its last task
+// reads past them), at offsets rounded down to FS_MMAP_WINDOW_ALIGN
+#define FS_MMAP_WINDOW (256ull * 1024 * 1024)
+#define FS_MMAP_WINDOW_ALIGN (2 * 1024 * 1024)
+
+// FS_IO_AUTO maps files at least this large a window at a time: page tables for every page
+// of a whole-file mapping would take size / 512 bytes once the scan has been through it
+#define FS_MMAP_WINDOW_MIN_SIZE (4ull * 1024 * 1024 * 1024)
+
+// Maps the file without reading it; scans page it in as they go (fs_pagein_t). Streams are left unmapped.
 fs_status_t fs_mmap_open(const char* filepath, fs_region_t* region);
 
+// FS_IO_ONCE: scans read no further ahead than their range, and evict what they read into the page
+// cache when mincore can tell them what was there already (it can for the file's owner or a writer)
+void fs_mmap_once(fs_region_t* region);
+
+// Gives the whole-file mapping up: the region becomes windowed and scans map parts of it (fs_window_map)
+void fs_mmap_windowed(fs_region_t* region);
+
+// A part of a windowed region's file, mapped on its own
+typedef struct {
+    const fs_byte_t* data;      // At file offset `base`; NULL when nothing is mapped
+    fs_size_t base;
+    fs_size_t len;
+} fs_window_t;
+
+// Maps [from, to) of the file, `from` rounded down to FS_MMAP_WINDOW_ALIGN (unmapping what w held)
+fs_status_t fs_window_map(fs_window_t* w, const fs_region_t* region, fs_size_t from, fs_size_t to);
+
+void fs_window_unmap(fs_window_t* w);
+
+/*
+ * Pages a mapped range in just ahead of the cursor that scans it, instead of
+ * the whole file before the scan starts: the next FS_PAGEIN_STEP bytes are
+ * populated (a single call, which waits only for pages not read yet), and
+ * reads are started up to FS_PAGEIN_AHEAD bytes ahead, so I/O overlaps the
+ * scan. Pages behind the cursor are dropped from the mapping (they stay in
+ * the page cache), so a scan maps no more than a few MB per thread at a time.
+ *
+ * In a region opened for one pass (region->once) nothing is read past the end
+ * of the range, and with region->evict the pages that were not cached when
+ * the cursor got to them (mincore, just before they are read) are evicted
+ * again once it has passed them: the page cache is left as the scan found it.
+ */
+typedef struct {
+    const fs_byte_t* data;      // The mapping (NULL: nothing to do)
+    fs_size_t size;
+    fs_size_t limit;            // Nothing is paged in past it
+    fs_size_t dropped;          // Pages before it are unmapped (page aligned)
+    fs_size_t populated;        // Mapped up to here
+    fs_size_t advised;          // Read ahead up to here
+
+#ifdef __linux__
+    // Eviction (fd -1: none): whether each page was cached before the scan, from `recorded` up to `seen`
+    int fd;
+    fs_size_t base;             // File offset of data[0]
+    fs_size_t recorded;
+    fs_size_t seen;
+    unsigned char cached[FS_PAGEIN_PAGES];  // Page i at i % FS_PAGEIN_PAGES
+#endif
+} fs_pagein_t;
+
+// Starts at `from` of the range [from, to) of a mapping of `size` bytes at file offset `base` of
+// region's file; region NULL (data is a buffer, not a mapping) does nothing
+void fs_pagein_begin(fs_pagein_t* p, const fs_region_t* region, const fs_byte_t* data, fs_size_t size,
+                     fs_size_t base, fs_size_t from, fs_size_t to);
+
+// The cursor is at pos
+void fs_pagein_advance(fs_pagein_t* p, fs_size_t pos);
+
+// The range was scanned up to `to`: what is still mapped of it is dropped
+void fs_pagein_end(fs_pagein_t* p, fs_size_t to);
+
+// Share of `samples` pages, spread over the mapping, that are in the page cache (1.0 for no mapping,
+// or when mincore cannot see the page cache of this file, see fs_mmap_once)
+double fs_mmap_resident(const fs_region_t* region, int samples);
+
 
 void fs_mmap_close(fs_region_t* region);
 
@@ -0,0 +1,57 @@
+#ifndef FASTSCAN_MULTI_LITERAL_H
+#define FASTSCAN_MULTI_LITERAL_H
+
+#include "safe_types.h"
+#include "matcher.h"
+
+// Teddy-style packed matcher: up to 64 literals, 8 fingerprint buckets
+#define FS_MULTI_MAX_PATTERNS 64
+#define FS_TEDDY_BUCKETS 8
+#define FS_TEDDY_MAX_PREFIX 3
+
+typedef struct fs_multi fs_multi_t;
+
+// Same shape as fs_kernel_fn; emits FS_MATCH_PACK(offset, id), ids ascending per position
+typedef const fs_byte_t* (*fs_multi_fn)(const fs_multi_t* m, const fs_byte_t* p, const fs_byte_t* limit,
+                                        const fs_byte_t* end, const fs_byte_t* base,
+                                        fs_size_t* out, fs_size_t* count, fs_size_t cap);
+
+struct fs_multi {
+    fs_size_t count;
+    const fs_byte_t* bytes[FS_MULTI_MAX_PATTERNS];   // Not owned
+    fs_size_t lens[FS_MULTI_MAX_PATTERNS];
+    fs_size_t min_len;
+    fs_size_t max_len;
+
+    // First 8 bytes of each pattern (zero padded) and the mask of the bytes that count
+    uint64_t head[FS_MULTI_MAX_PATTERNS];
+    uint64_t head_mask[FS_MULTI_MAX_PATTERNS];
+
+    // Fingerprint: bit b of lo[k][x & 15] & hi[k][x >> 4] is set when some pattern
+    // of bucket b may have byte x at position k (k < prefix)
+    fs_size_t prefix;
+    uint8_t lo[FS_TEDDY_MAX_PREFIX][16] __attribute__((aligned(16)));
+    uint8_t hi[FS_TEDDY_MAX_PREFIX][16] __attribute__((aligned(16)));
+    uint64_t bucket_ids[FS_TEDDY_BUCKETS];            // Pattern ids per bucket
+
+    fs_multi_fn scan;
+};
+
+// Builds the fingerprint tables and picks the kernel for the running CPU
+fs_status_t fs_multi_init(fs_multi_t* m, const fs_byte_t* const* patterns, const fs_size_t* lens, fs_size_t count);
+void fs_multi_matcher(fs_matcher_t* out, const fs_multi_t* m);
+
+const fs_byte_t* fs_multi_scan_scalar(const fs_multi_t* m, const fs_byte_t* p, const fs_byte_t* limit,
+                                      const fs_byte_t* end, const fs_byte_t* base,
+                                      fs_size_t* out, fs_size_t* count, fs_size_t cap);
+const fs_byte_t* fs_multi_scan_ssse3(const fs_multi_t* m, const fs_byte_t* p, const fs_byte_t* limit,
+                                     const fs_byte_t* end, const fs_byte_t* base,
+                                     fs_size_t* out, fs_size_t* count, fs_size_t cap);
+const fs_byte_t* fs_multi_scan_avx2(const fs_multi_t* m, const fs_byte_t* p, const fs_byte_t* limit,
+                                    const fs_byte_t* end, const fs_byte_t* base,
+                                    fs_size_t* out, fs_size_t* count, fs_size_t cap);
+const fs_byte_t* fs_multi_scan_avx512(const fs_multi_t* m, const fs_byte_t* p, const fs_byte_t* limit,
+                                      const fs_byte_t* end, const fs_byte_t* base,
+                                      fs_size_t* out, fs_size_t* count, fs_size_t cap);
+
+#endif // FASTSCAN_MULTI_LITERAL_H
@@ -0,0 +1,31 @@
+#ifndef FASTSCAN_NUMA_TOPOLOGY_H
+#define FASTSCAN_NUMA_TOPOLOGY_H
+
+// Nodes beyond this are folded into node 0
+#define FS_NUMA_MAX_NODES 64
+
+/*
+ * NUMA layout read once from /sys/devices/system/node (nodeN/cpulist).
+ * FASTSCAN_NUMA_SYSFS=<dir> reads a fake layout from <dir>/nodeN/cpulist instead,
+ * for benchmarking placement on a single-node machine.
+ * Without sysfs (or outside Linux) there is one node holding every CPU.
+ */
+void fs_numa_init(void);
+
+// Number of nodes (at least 1)
+int fs_numa_nodes(void);
+
+// Node of a CPU (0 when it is in no node)
+int fs_numa_cpu_node(int cpu);
+
+// Node of the CPU the calling thread runs on right now
+int fs_numa_current_node(void);
+
+// Up to `max` CPUs of a node, ascending; returns how many there are
+int fs_numa_node_cpus(int node, int* cpus, int max);
+
+// Node holding each page (one address per page); -1 for pages that are not resident
+// or that the kernel would not place
+void fs_numa_page_nodes(const void** pages, int n, int* nodes);
+
+#endif // FASTSCAN_NUMA_TOPOLOGY_H
@@ -0,0 +1,21 @@
+#ifndef FASTSCAN_PARALLELISM_H
+#define FASTSCAN_PARALLELISM_H
+
+// How many CPUs a scan can really use, from the limits the process runs under
+typedef struct {
+    int online;         // CPUs online on the host
+    int affinity;       // CPUs in the process's affinity mask
+    int quota;          // CPUs worth of cgroup CPU quota (rounded up); 0 when unlimited
+    int cores;          // Physical cores among the affinity CPUs (SMT siblings count once)
+    int effective;      // min(affinity, quota, cores), or FASTSCAN_THREADS when set
+} fs_parallelism_t;
+
+/*
+ * Read once: sched_getaffinity, the cgroup v2 cpu.max (or v1 cpu.cfs_quota_us /
+ * cpu.cfs_period_us) of the process's cgroup and its ancestors, and the SMT
+ * sibling lists in /sys/devices/system/cpu. FASTSCAN_THREADS=<n> in the
+ * environment replaces `effective`.
+ */
+const fs_parallelism_t* fs_parallelism(void);
+
+#endif // FASTSCAN_PARALLELISM_H
@@ -0,0 +1,55 @@
+#ifndef FASTSCAN_PATTERN_H
+#define FASTSCAN_PATTERN_H
+
+#include "safe_types.h"
+#include "matcher.h"
+#include "kernels.h"
+#include "multi_literal.h"
+#include "dictionary.h"
+#include "regex.h"
+
+typedef enum {
+    FS_PATTERN_LITERAL = 0,
+    FS_PATTERN_MULTI,       // Literal list or dictionary file; matches are tagged with the list index
+    FS_PATTERN_REGEX
+} fs_pattern_kind_t;
+
+/*
+ * A pattern prepared once and scanned many times: the needle (kernel, rare
+ * pair, skip table), the Teddy tables, the dictionary trie or the regex NFA.
+ * Scans only read it, so one compiled pattern may serve any number of
+ * contexts and threads at once. The engines point into the struct itself,
+ * so it must not be moved once compiled.
+ */
+typedef struct {
+    fs_pattern_kind_t kind;
+
+    // Owned copy of the input: the literal, the regex source or every list entry back to back
+    fs_byte_t* text;
+    fs_size_t text_len;
+    fs_size_t count;
+
+    fs_needle_t needle;
+    fs_multi_t multi;
+    fs_dict_t dict;
+    int use_dict;
+    fs_regex_t regex;
+
+    // Set up for whichever engine the kind uses
+    fs_matcher_t matcher;
+} fastscan_pattern_t;
+
+// A literal (FS_PATTERN_LITERAL) or a regular expression (FS_PATTERN_REGEX)
+fs_status_t fastscan_pattern_compile(fastscan_pattern_t* p, const char* pattern, fs_size_t len,
+                                     fs_pattern_kind_t kind);
+
+// A literal list; pattern i gets id i. Above FS_MULTI_MAX_PATTERNS a dictionary is built.
+fs_status_t fastscan_pattern_compile_list(fastscan_pattern_t* p, const char* const* patterns,
+                                          const fs_size_t* lens, fs_size_t count);
+
+// A newline separated list file, always held as a dictionary
+fs_status_t fastscan_pattern_load_list(fastscan_pattern_t* p, const char* filepath);
+
+void fastscan_pattern_destroy(fastscan_pattern_t* p);
+
+#endif // FASTSCAN_PATTERN_H
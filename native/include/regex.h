@@ -0,0 +1,72 @@
+#ifndef FASTSCAN_REGEX_H
+#define FASTSCAN_REGEX_H
+
+#include "safe_types.h"
+#include "matcher.h"
+#include "kernels.h"
+
+// Compile limits: NFA nodes after counted repetition is expanded, {n,m} bounds, group nesting
+#define FS_REGEX_MAX_NODES (1 << 16)
+#define FS_REGEX_MAX_REPEAT 1000
+#define FS_REGEX_MAX_DEPTH 128
+
+// Longest required literal kept for the prefilter
+#define FS_REGEX_MAX_LITERAL 64
+
+// Lazy DFA cache per scanning thread; flushed and rebuilt when full
+#define FS_REGEX_DFA_STATES 4096
+#define FS_REGEX_DFA_POOL (1 << 20)
+
+typedef enum {
+    FS_RE_BYTES = 0,   // Consumes one byte of sets[cls]
+    FS_RE_SPLIT,       // Epsilon to out and out1
+    FS_RE_BOL,         // Line start assertion
+    FS_RE_EOL,         // Line end assertion
+    FS_RE_MATCH
+} fs_re_op_t;
+
+typedef struct {
+    uint8_t op;
+    uint16_t cls;
+    int32_t out;
+    int32_t out1;
+} fs_re_node_t;
+
+/*
+ * Byte-oriented regular expression (JavaScript syntax without backreferences,
+ * lookaround or \b) whose matches never cross a newline. `.` does not take a
+ * \r, and `^` / `$` hold after / before one, as JavaScript's line terminators. The NFA is built for
+ * the reversed expression: every line is confirmed by one backward DFA pass,
+ * which yields all match starts in the line at once.
+ */
+typedef struct {
+    fs_re_node_t* nodes;
+    fs_size_t node_count;
+    int32_t start;
+
+    uint64_t (*sets)[4];        // 256-bit byte sets of FS_RE_BYTES nodes
+    fs_size_t set_count;
+    int anchored;               // Has ^ or $: a \r ends a line for them
+
+    // Bytes no set tells apart share a DFA column
+    uint8_t byte_class[256];
+    fs_size_t classes;
+
+    // Substring every match contains; lines without it are never looked at
+    fs_byte_t literal[FS_REGEX_MAX_LITERAL];
+    fs_size_t literal_len;
+    fs_needle_t needle;
+
+    // Another required substring, looked up in each candidate line before the DFA runs
+    fs_byte_t second[FS_REGEX_MAX_LITERAL];
+    fs_size_t second_len;
+} fs_regex_t;
+
+// Invalid or unsupported syntax and oversized expressions give FS_ERROR_INVALID_ARG
+fs_status_t fs_regex_compile(fs_regex_t* re, const char* pattern, fs_size_t len);
+void fs_regex_destroy(fs_regex_t* re);
+
+// Reports every offset at which a match starts (like overlapping literal matches)
+void fs_regex_matcher(fs_matcher_t* out, const fs_regex_t* re);
+
+#endif // FASTSCAN_REGEX_H
@@ -17,7 +17,9 @@ typedef enum {
     FS_ERROR_INVALID_ARG,
     FS_ERROR_OUT_OF_BOUNDS,
     FS_ERROR_MMAP_FAILED,
-    FS_ERROR_OPEN_FAILED
+    FS_ERROR_OPEN_FAILED,
+    FS_ERROR_CANCELLED,
+    FS_ERROR_READ_FAILED
 } fs_status_t;
 
 #endif // FASTSCAN_SAFE_TYPES_H
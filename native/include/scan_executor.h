@@ -0,0 +1,27 @@
+#ifndef FASTSCAN_SCAN_EXECUTOR_H
+#define FASTSCAN_SCAN_EXECUTOR_H
+
+// Most async scans running at once; later ones wait in the queue
+#define FS_EXECUTOR_MAX_THREADS 16
+
+typedef void (*fs_job_fn)(void* arg);
+
+/*
+ * Threads of FastScan's own that run whole async scans, so a scan never holds
+ * a slot of the libuv threadpool (fs, dns, crypto) while it runs. Each job is
+ * the calling thread of its scan and hands chunks to the worker pool
+ * (thread_pool.h). A thread is started when a job finds none idle, up to
+ * FS_EXECUTOR_MAX_THREADS; idle threads sleep until the next job.
+ *
+ * Jobs that wait on something other than the scan (a stream for its consumer's
+ * ack, a pipe for its writer) go to a second lane with no cap, so however many
+ * of them are open they never keep other scans from starting.
+ */
+
+// Runs fn(arg) on an executor thread, in submission order; -1 when no thread could be started
+int fs_executor_submit(fs_job_fn fn, void* arg);
+
+// Same, on the uncapped lane: a job is never left queued behind ones that wait
+int fs_executor_submit_blocking(fs_job_fn fn, void* arg);
+
+#endif // FASTSCAN_SCAN_EXECUTOR_H
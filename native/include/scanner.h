@@ -3,6 +3,18 @@
 
 #include "fastscan.h"
 #include "safe_types.h"
+#include "kernels.h"
+
+// Scans start positions [from, to) of data with the needle's kernel (reads may extend to data_len).
+// Returns the offset to resume from: `to` when done, else the first match that did not fit.
+fs_size_t fs_scan_span(const fs_needle_t* needle, const fs_byte_t* data, fs_size_t data_len,
+                       fs_size_t from, fs_size_t to, fs_size_t* out, fs_size_t* count, fs_size_t cap);
+
+// Wraps a needle in the generic span interface used by fastscan_execute
+void fs_needle_matcher(fs_matcher_t* out, const fs_needle_t* needle);
+
+// Whole-buffer scan, stops at max_matches
+fs_status_t fs_scan_needle(const fs_needle_t* needle, const fs_byte_t* data, fs_size_t data_len, fs_size_t* out_matches, fs_size_t* match_count, fs_size_t max_matches);
 
 fs_status_t fs_scan_run(fastscan_ctx_t* ctx);
 fs_status_t fs_scan_raw(const fs_byte_t* data, fs_size_t data_len, const fs_byte_t* pattern, fs_size_t pattern_len, fs_size_t* out_matches, fs_size_t* match_count, fs_size_t max_matches);
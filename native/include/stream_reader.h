@@ -0,0 +1,25 @@
+#ifndef FASTSCAN_STREAM_READER_H
+#define FASTSCAN_STREAM_READER_H
+
+#include "fastscan.h"
+
+/*
+ * Inputs that cannot be mapped (pipes, FIFOs, sockets, character devices,
+ * /proc files that report a size of 0) are read() in FS_IO_BLOCK_SIZE blocks.
+ * A reader thread fills one block while the calling thread scans the other,
+ * so I/O and matching overlap. Each block is scanned by the same span as a
+ * mapped file, behind the bytes the block before could not finish: its last
+ * max_len - 1 bytes, or its unfinished last line for a regex and in line mode.
+ * Offsets and line numbers count from the start of the stream.
+ *
+ * A reader that has waited 100ms for more input hands over the block
+ * it has so far, so a slow producer (tail -f) sees its matches without waiting
+ * for a full block.
+ */
+
+// Scans the stream behind ctx->region.fd with ctx->matcher. Matches (lines in line mode) go to
+// sink in stream order; with sink NULL they are only counted into *count (line mode ignored).
+// ctx->cancel and ctx->on_progress are honoured; total_bytes stays 0 until the stream ends.
+fs_status_t fs_stream_scan(const fastscan_ctx_t* ctx, fs_stream_sink_fn sink, void* arg, fs_size_t* count);
+
+#endif // FASTSCAN_STREAM_READER_H
@@ -0,0 +1,38 @@
+#ifndef FASTSCAN_THREAD_POOL_H
+#define FASTSCAN_THREAD_POOL_H
+
+#include <stddef.h>
+
+// Slots in the task queue; a full queue makes the submitting thread run the task itself
+#define FS_POOL_QUEUE_SIZE 1024
+
+// Upper bound on pool workers, whatever the machine reports
+#define FS_POOL_MAX_WORKERS 256
+
+typedef void (*fs_task_fn)(void* arg);
+
+/*
+ * Process-wide pool of workers, each pinned to one CPU of the process's
+ * affinity mask, taken from each NUMA node in turn. Tasks go through a
+ * bounded lock-free queue; idle workers spin briefly, then sleep until a
+ * task is queued.
+ */
+
+// Grows the pool to `workers` threads (a call asking for no more than before only returns the count)
+int fs_pool_start(int workers);
+
+// Workers started so far (0 before fs_pool_start)
+int fs_pool_size(void);
+
+// Runs fn(args + i * stride) for i in [0, n) and returns once all of them finished.
+// The calling thread takes tasks from the queue too, so it never waits idle.
+void fs_pool_run(fs_task_fn fn, void* args, size_t stride, int n);
+
+// Runs fn(args + i * stride) for i in [0, tasks) on up to `runners` threads of the pool (the caller
+// included). Each runner works through its own contiguous share from the front; once it runs dry it
+// steals the back half of the largest share left.
+// With `nodes` (the NUMA node of each task, or NULL), runners start on shares of their own node's
+// tasks and steal from their own node first.
+void fs_pool_run_tasks(fs_task_fn fn, void* args, size_t stride, int tasks, int runners, const int* nodes);
+
+#endif // FASTSCAN_THREAD_POOL_H
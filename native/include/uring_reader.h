@@ -0,0 +1,62 @@
+#ifndef FASTSCAN_URING_READER_H
+#define FASTSCAN_URING_READER_H
+
+#include "safe_types.h"
+#include "config.h"
+
+// Bytes of the file each read covers (plus the overlap), a multiple of FS_MEMORY_ALIGNMENT
+#define FS_URING_BLOCK (4 * 1024 * 1024)
+
+// Reads in flight: two per scan thread, within these bounds
+#define FS_URING_MIN_DEPTH 4
+#define FS_URING_MAX_DEPTH 16
+
+// FS_IO_AUTO takes io_uring only for files at least this large whose sampled pages are mostly not cached
+#define FS_URING_MIN_SIZE (64ull * 1024 * 1024)
+
+/*
+ * Reads a regular file through io_uring (raw io_uring_setup / io_uring_enter,
+ * no liburing): many FS_URING_BLOCK reads in flight into aligned buffers,
+ * optionally with O_DIRECT, so a cold file streams in at device speed instead
+ * of being paged in one fault (or one MAP_POPULATE) at a time. Block i holds
+ * the file from i * FS_URING_BLOCK on, plus `overlap` bytes of the next block
+ * so matches that start in it can be confirmed there.
+ *
+ * Scan threads call fs_uring_next to take blocks in the order their reads
+ * complete. Whichever thread finds none ready waits in io_uring_enter for the
+ * others, then refills the ring with the buffers given back by fs_uring_done.
+ */
+
+typedef struct fs_uring fs_uring_t;
+
+typedef struct {
+    const fs_byte_t* data;
+    fs_size_t index;        // Block number: data[0] is at index * FS_URING_BLOCK in the file
+    fs_size_t len;          // Bytes in data, the overlap included
+    fs_size_t own;          // Start positions that belong to this block: [0, own)
+    int buf;
+} fs_uring_block_t;
+
+// io_uring can be set up here (kernel >= 5.6, not blocked by a seccomp profile); probed once
+int fs_uring_available(void);
+
+// Starts reading `size` bytes of fd with `depth` reads in flight; NULL if the ring cannot be set up.
+// `direct`: read with O_DIRECT through a second descriptor (buffered when the filesystem refuses).
+fs_uring_t* fs_uring_start(int fd, fs_size_t size, fs_size_t overlap, int depth, int direct);
+
+// Next block whose read has completed; 0 once every block was handed out, or after a stop or error
+int fs_uring_next(fs_uring_t* u, fs_uring_block_t* out);
+
+// The block has been scanned: its buffer takes the next read
+void fs_uring_done(fs_uring_t* u, const fs_uring_block_t* block);
+
+// Blocks from `blocks` on are not needed (the scan has enough matches before them)
+void fs_uring_limit(fs_uring_t* u, fs_size_t blocks);
+
+// No more reads are started
+void fs_uring_stop(fs_uring_t* u);
+
+// Waits for the reads still in flight and frees everything; FS_ERROR_READ_FAILED after a failed read
+fs_status_t fs_uring_finish(fs_uring_t* u);
+
+#endif // FASTSCAN_URING_READER_H
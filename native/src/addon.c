@@ -1,117 +1,524 @@
 #include <node_api.h>
+#include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
+#include <sys/stat.h>
 #include "../include/fastscan.h"
 #include "../include/mmap_reader.h"
+#include "../include/cpu_features.h"
+#include "../include/numa_topology.h"
+#include "../include/parallelism.h"
+#include "../include/scan_executor.h"
 
 static napi_value throw_error(napi_env env, const char* msg) {
     napi_throw_error(env, NULL, msg);
     return NULL;
 }
 
+// Optional trailing options object shared by every scan entry point
+typedef struct {
+    int sample_frequencies;
+    int threads;            // 0: native default
+    int32_t* cancel;        // Element 0 of the `cancel` Int32Array; set from JS to stop the scan
+    napi_value cancel_array;
+    napi_value on_progress; // Async scans only: called with { bytesScanned, totalBytes, matches }
+    int progress_interval;  // ms between reports (0: native default)
+    fs_io_mode_t io_mode;   // `io`: 'auto', 'mmap', 'uring', 'direct' or 'window'
+} ScanOptions;
+
+static int get_bool_option(napi_env env, napi_value opts, const char* name, int* out) {
+    bool has = false;
+    if (napi_has_named_property(env, opts, name, &has) != napi_ok || !has) return 0;
+
+    napi_value v;
+    bool b = false;
+    if (napi_get_named_property(env, opts, name, &v) != napi_ok) return -1;
+    if (napi_get_value_bool(env, v, &b) != napi_ok) return -1;
+    *out = b ? 1 : 0;
+    return 0;
+}
+
+static int get_int_option(napi_env env, napi_value opts, const char* name, int* out) {
+    bool has = false;
+    if (napi_has_named_property(env, opts, name, &has) != napi_ok || !has) return 0;
+
+    napi_value v;
+    napi_valuetype type;
+    if (napi_get_named_property(env, opts, name, &v) != napi_ok) return -1;
+    if (napi_typeof(env, v, &type) != napi_ok) return -1;
+    if (type == napi_undefined) return 0;
+    return napi_get_value_int32(env, v, out) == napi_ok ? 0 : -1;
+}
+
+static int get_function_option(napi_env env, napi_value opts, const char* name, napi_value* out) {
+    bool has = false;
+    if (napi_has_named_property(env, opts, name, &has) != napi_ok || !has) return 0;
+
+    napi_value v;
+    napi_valuetype type;
+    if (napi_get_named_property(env, opts, name, &v) != napi_ok) return -1;
+    if (napi_typeof(env, v, &type) != napi_ok) return -1;
+    if (type == napi_undefined) return 0;
+    if (type != napi_function) return -1;
+    *out = v;
+    return 0;
+}
+
+static int get_io_option(napi_env env, napi_value opts, fs_io_mode_t* out) {
+    static const char* const names[] = { "auto", "mmap", "uring", "direct", "window", "once" };
+    bool has = false;
+    if (napi_has_named_property(env, opts, "io", &has) != napi_ok || !has) return 0;
+
+    napi_value v;
+    napi_valuetype type;
+    if (napi_get_named_property(env, opts, "io", &v) != napi_ok) return -1;
+    if (napi_typeof(env, v, &type) != napi_ok) return -1;
+    if (type == napi_undefined) return 0;
+
+    char name[8];
+    size_t len = 0;
+    if (napi_get_value_string_utf8(env, v, name, sizeof(name), &len) != napi_ok) return -1;
+    for (int i = 0; i < (int)(sizeof(names) / sizeof(names[0])); i++) {
+        if (strcmp(name, names[i]) == 0) {
+            *out = (fs_io_mode_t)i;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+// Cancellation flag: an Int32Array the JS side sets to 1 (src/index.js wires an AbortSignal to it)
+static int get_cancel_option(napi_env env, napi_value opts, ScanOptions* out) {
+    bool has = false;
+    if (napi_has_named_property(env, opts, "cancel", &has) != napi_ok || !has) return 0;
+
+    napi_value v;
+    napi_valuetype type;
+    if (napi_get_named_property(env, opts, "cancel", &v) != napi_ok) return -1;
+    if (napi_typeof(env, v, &type) != napi_ok) return -1;
+    if (type == napi_undefined) return 0;
+
+    bool is_typedarray = false;
+    napi_typedarray_type ta_type;
+    size_t length;
+    void* data = NULL;
+    if (napi_is_typedarray(env, v, &is_typedarray) != napi_ok || !is_typedarray) return -1;
+    if (napi_get_typedarray_info(env, v, &ta_type, &length, &data, NULL, NULL) != napi_ok) return -1;
+    if (ta_type != napi_int32_array || length < 1 || !data) return -1;
+
+    out->cancel = (int32_t*)data;
+    out->cancel_array = v;
+    return 0;
+}
+
+static const char* read_scan_options(napi_env env, size_t argc, napi_value* args, size_t index, ScanOptions* opts) {
+    memset(opts, 0, sizeof(ScanOptions));
+    if (argc <= index) return NULL;
+
+    napi_valuetype type;
+    napi_typeof(env, args[index], &type);
+    if (type == napi_undefined || type == napi_null) return NULL;
+    if (type != napi_object) return "Options must be an object";
+
+    if (get_bool_option(env, args[index], "sampleFrequencies", &opts->sample_frequencies)) return "Invalid sampleFrequencies";
+    if (get_int_option(env, args[index], "threads", &opts->threads) || opts->threads < 0) return "Invalid threads";
+    if (get_cancel_option(env, args[index], opts)) return "Invalid cancel";
+    if (get_function_option(env, args[index], "onProgress", &opts->on_progress)) return "Invalid onProgress";
+    if (get_int_option(env, args[index], "progressInterval", &opts->progress_interval) || opts->progress_interval < 0) {
+        return "Invalid progressInterval";
+    }
+    if (get_io_option(env, args[index], &opts->io_mode)) return "Invalid io";
+
+    return NULL;
+}
+
+static void apply_scan_options(fastscan_ctx_t* ctx, const ScanOptions* opts) {
+    ctx->sample_frequencies = opts->sample_frequencies;
+    ctx->threads = opts->threads;
+    ctx->io_mode = opts->io_mode;
+    ctx->cancel = opts->cancel;
+}
+
 static void FreeMatchesCallback(napi_env env, void* data, void* hint) {
     free(data);
 }
 
+// Hands a malloc'd buffer to JS as a typed array (zero-copy); empty results become []
+static napi_value wrap_external(napi_env env, napi_typedarray_type type, void* data, size_t count, size_t elem_size) {
+    napi_value result;
+
+    if (count == 0) {
+        napi_create_array_with_length(env, 0, &result);
+        return result;
+    }
+
+    napi_value array_buffer;
+    napi_create_external_arraybuffer(env, data, count * elem_size, FreeMatchesCallback, NULL, &array_buffer);
+    napi_create_typedarray(env, type, count, array_buffer, 0, &result);
+    return result;
+}
+
+// Multi-literal results: { offsets: BigUint64Array, patternIds: Uint32Array }
+static napi_value wrap_multi_result(napi_env env, fastscan_ctx_t* ctx) {
+    napi_value result;
+    napi_create_object(env, &result);
+
+    napi_set_named_property(env, result, "offsets",
+                            wrap_external(env, napi_biguint64_array, ctx->matches, ctx->match_count, sizeof(fs_size_t)));
+    napi_set_named_property(env, result, "patternIds",
+                            wrap_external(env, napi_uint32_array, ctx->match_ids, ctx->match_count, sizeof(uint32_t)));
+
+    if (ctx->match_count > 0) {
+        ctx->matches = NULL;
+        ctx->match_ids = NULL;
+    }
+    return result;
+}
+
+// Line mode results: { lineNumbers, starts, ends }, all BigUint64Array
+static napi_value wrap_lines_result(napi_env env, fastscan_ctx_t* ctx) {
+    napi_value result;
+    napi_create_object(env, &result);
+
+    napi_set_named_property(env, result, "lineNumbers",
+                            wrap_external(env, napi_biguint64_array, ctx->line_numbers, ctx->match_count, sizeof(fs_size_t)));
+    napi_set_named_property(env, result, "starts",
+                            wrap_external(env, napi_biguint64_array, ctx->matches, ctx->match_count, sizeof(fs_size_t)));
+    napi_set_named_property(env, result, "ends",
+                            wrap_external(env, napi_biguint64_array, ctx->line_ends, ctx->match_count, sizeof(fs_size_t)));
+
+    if (ctx->match_count > 0) {
+        ctx->matches = NULL;
+        ctx->line_ends = NULL;
+        ctx->line_numbers = NULL;
+    }
+    return result;
+}
+
+// Tags compiled pattern handles so foreign externals are rejected
+static const napi_type_tag PATTERN_TAG = { 0x6661737473636e31ULL, 0x7061747465726e31ULL };
+
+// Pattern argument that outlives the call: a literal list copied into one
+// block, or a compiled pattern kept alive by a reference
 typedef struct {
-    napi_async_work work;
+    char* blob;
+    const char** ptrs;
+    fs_size_t* lens;
+    uint32_t count;
+
+    const fastscan_pattern_t* compiled;
+    napi_ref compiled_ref;
+} PatternList;
+
+static void release_patterns(napi_env env, PatternList* list) {
+    if (list->compiled_ref) napi_delete_reference(env, list->compiled_ref);
+    free(list->blob);
+    free((void*)list->ptrs);
+    free(list->lens);
+    memset(list, 0, sizeof(PatternList));
+}
+
+// Compiled handle of the given kind (-1: any), referenced until release_patterns
+static const char* read_compiled(napi_env env, napi_value value, int kind, PatternList* list) {
+    bool tagged = false;
+    void* p = NULL;
+    if (napi_check_object_type_tag(env, value, &PATTERN_TAG, &tagged) != napi_ok || !tagged) return "Invalid compiled pattern";
+    if (napi_get_value_external(env, value, &p) != napi_ok || !p) return "Invalid compiled pattern";
+    if (kind >= 0 && ((const fastscan_pattern_t*)p)->kind != (fs_pattern_kind_t)kind) return "Compiled pattern has the wrong kind";
+
+    list->compiled = (const fastscan_pattern_t*)p;
+    if (napi_create_reference(env, value, 1, &list->compiled_ref) != napi_ok) return "Invalid compiled pattern";
+    return NULL;
+}
+
+static int is_external(napi_env env, napi_value value) {
+    napi_valuetype type;
+    napi_typeof(env, value, &type);
+    return type == napi_external;
+}
+
+static const char* read_patterns(napi_env env, napi_value value, PatternList* list) {
+    memset(list, 0, sizeof(PatternList));
+
+    if (is_external(env, value)) return read_compiled(env, value, FS_PATTERN_MULTI, list);
+
+    bool is_array = false;
+    if (napi_is_array(env, value, &is_array) != napi_ok || !is_array) return "Patterns must be an array or a compiled pattern list";
+    if (napi_get_array_length(env, value, &list->count) != napi_ok) return "Invalid patterns";
+    if (list->count == 0) return "Patterns must not be empty";
+    if (list->count > FS_DICT_MAX_PATTERNS) return "Too many patterns";
+
+    list->ptrs = (const char**)malloc(list->count * sizeof(char*));
+    list->lens = (fs_size_t*)malloc(list->count * sizeof(fs_size_t));
+    if (!list->ptrs || !list->lens) return "Memory allocation failed";
+
+    // 1. Measure
+    size_t total = 0;
+    for (uint32_t i = 0; i < list->count; i++) {
+        napi_value item;
+        size_t len;
+        napi_get_element(env, value, i, &item);
+        if (napi_get_value_string_utf8(env, item, NULL, 0, &len) != napi_ok) return "Invalid pattern";
+        if (len == 0) return "Invalid pattern";
+        if (len > FS_MAX_PATTERN_LEN) return "Pattern too long";
+        list->lens[i] = len;
+        total += len + 1;
+    }
+
+    // 2. Copy
+    list->blob = (char*)malloc(total);
+    if (!list->blob) return "Memory allocation failed";
+
+    char* dst = list->blob;
+    for (uint32_t i = 0; i < list->count; i++) {
+        napi_value item;
+        size_t len;
+        napi_get_element(env, value, i, &item);
+        napi_get_value_string_utf8(env, item, dst, list->lens[i] + 1, &len);
+        list->ptrs[i] = dst;
+        dst += list->lens[i] + 1;
+    }
+
+    return NULL;
+}
+
+static fs_status_t init_patterns(fastscan_ctx_t* ctx, const PatternList* list, fs_size_t max_matches) {
+    if (list->compiled) return fastscan_init_pattern(ctx, list->compiled, max_matches);
+    return fastscan_init_multi(ctx, list->ptrs, list->lens, list->count, max_matches);
+}
+
+typedef struct {
+    napi_threadsafe_function done;  // Brings the finished scan back to the JS thread
+    napi_ref cancel_ref;            // Keeps opts.cancel's buffer alive while the scan may read it
+    napi_threadsafe_function progress;  // opts.on_progress, called from the scan threads (NULL: none)
     napi_deferred deferred;
     char file_path[1024];
     char pattern[4096];
+    size_t pattern_len;
     int32_t max_matches;
-    fs_size_t* matches;
-    fs_size_t match_count;
+    ScanOptions opts;
+    int is_regex;           // scanFileRegexAsync: `pattern` is a regular expression
+    int count_only;         // countFileAsync: only result.match_count is produced
+    int line_mode;          // scanFileLinesAsync: result holds lines (see fastscan_ctx_t)
+    PatternList patterns;   // A literal list or a compiled pattern; `pattern` is unused then
+    fastscan_ctx_t result;  // matches / match_ids / matcher.tagged handed over by the worker
     fs_status_t scan_status;
 } AsyncScanData;
 
-static void ExecuteScan(napi_env env, void* data) {
-    AsyncScanData* async_data = (AsyncScanData*)data;
+// Scan thread side of onProgress: a copy of the report is queued for the JS thread, never waited on
+static void publish_progress(void* arg, const fs_progress_t* progress) {
+    AsyncScanData* async_data = (AsyncScanData*)arg;
+    fs_progress_t* copy = (fs_progress_t*)malloc(sizeof(fs_progress_t));
+    if (!copy) return;
+    *copy = *progress;
+    if (napi_call_threadsafe_function(async_data->progress, copy, napi_tsfn_nonblocking) != napi_ok) free(copy);
+}
+
+static void CallProgress(napi_env env, napi_value js_cb, void* context, void* data) {
+    fs_progress_t* progress = (fs_progress_t*)data;
+    (void)context;
+
+    if (env && js_cb) {
+        napi_value report, value, undefined;
+        napi_create_object(env, &report);
+        napi_create_double(env, (double)progress->bytes_scanned, &value);
+        napi_set_named_property(env, report, "bytesScanned", value);
+        napi_create_double(env, (double)progress->total_bytes, &value);
+        napi_set_named_property(env, report, "totalBytes", value);
+        napi_create_double(env, (double)progress->matches, &value);
+        napi_set_named_property(env, report, "matches", value);
+        napi_get_undefined(env, &undefined);
+        napi_call_function(env, undefined, js_cb, 1, &report, NULL);
+    }
+    free(progress);
+}
+
+// Runs on an executor thread: no V8 access, only the argument block
+static void ExecuteScan(AsyncScanData* async_data) {
     fastscan_ctx_t ctx = {0};
 
-    async_data->scan_status = fastscan_init(&ctx, async_data->pattern, (fs_size_t)async_data->max_matches);
+    if (async_data->patterns.compiled || async_data->patterns.count) {
+        async_data->scan_status = init_patterns(&ctx, &async_data->patterns, (fs_size_t)async_data->max_matches);
+    } else if (async_data->is_regex) {
+        async_data->scan_status = fastscan_init_regex(&ctx, async_data->pattern, async_data->pattern_len,
+                                                      (fs_size_t)async_data->max_matches);
+    } else {
+        async_data->scan_status = fastscan_init(&ctx, async_data->pattern, (fs_size_t)async_data->max_matches);
+    }
+    apply_scan_options(&ctx, &async_data->opts);
+    ctx.line_mode = async_data->line_mode;
+    if (async_data->progress) {
+        ctx.on_progress = publish_progress;
+        ctx.progress_arg = async_data;
+        ctx.progress_interval_ms = (uint32_t)async_data->opts.progress_interval;
+    }
+
+    // Aborted while it waited in the executor queue: not even the file is opened
+    if (async_data->scan_status == FS_SUCCESS && ctx.cancel && __atomic_load_n(ctx.cancel, __ATOMIC_RELAXED)) {
+        async_data->scan_status = FS_ERROR_CANCELLED;
+    }
 
     if (async_data->scan_status == FS_SUCCESS) {
         async_data->scan_status = fastscan_load_file(&ctx, async_data->file_path);
         if (async_data->scan_status == FS_SUCCESS) {
-            async_data->scan_status = fastscan_execute(&ctx);
+            async_data->scan_status = async_data->count_only ? fastscan_count(&ctx) : fastscan_execute(&ctx);
         }
     }
 
-    async_data->matches = ctx.matches;
-    async_data->match_count = ctx.match_count;
+    async_data->result.matches = ctx.matches;
+    async_data->result.match_ids = ctx.match_ids;
+    async_data->result.match_count = ctx.match_count;
+    async_data->result.matcher.tagged = ctx.matcher.tagged;
+    async_data->result.line_ends = ctx.line_ends;
+    async_data->result.line_numbers = ctx.line_numbers;
     ctx.matches = NULL;
+    ctx.match_ids = NULL;
+    ctx.line_ends = NULL;
+    ctx.line_numbers = NULL;
 
-    fs_mmap_close(&ctx.region);
+    fastscan_destroy(&ctx);
+}
+
+// Rejection message of a failed async scan (src/index.js maps it to an error class)
+static const char* status_message(const AsyncScanData* data, fs_status_t status) {
+    if (status == FS_ERROR_OPEN_FAILED) return "File not found";
+    if (status == FS_ERROR_MMAP_FAILED) return "Memory mapping failed";
+    if (status == FS_ERROR_OUT_OF_BOUNDS) return "Buffer allocation failed";
+    if (status == FS_ERROR_CANCELLED) return "Scan aborted";
+    if (status == FS_ERROR_READ_FAILED) return "Read failed";
+    if (status == FS_ERROR_INVALID_ARG) return data->is_regex ? "Invalid regular expression" : "Invalid argument";
+    return "Unknown Error";
 }
 
-static void CompleteScan(napi_env env, napi_status status, void* data) {
+static void free_results(AsyncScanData* async_data) {
+    free(async_data->result.matches);
+    free(async_data->result.match_ids);
+    free(async_data->result.line_ends);
+    free(async_data->result.line_numbers);
+}
+
+// Runs on the JS thread through the scan's threadsafe function (env is NULL once the environment is gone)
+static void CompleteScan(napi_env env, napi_value js_cb, void* context, void* data) {
     AsyncScanData* async_data = (AsyncScanData*)data;
+    (void)js_cb;
+    (void)context;
 
-    if (status != napi_ok) {
-        napi_value err_msg;
-        napi_create_string_utf8(env, "Async internal failure", NAPI_AUTO_LENGTH, &err_msg);
-        napi_reject_deferred(env, async_data->deferred, err_msg);
-    } else if (async_data->scan_status != FS_SUCCESS) {
-        napi_value error_msg;
-        const char* err_str = "Unknown Error";
-        if (async_data->scan_status == FS_ERROR_OPEN_FAILED) err_str = "File not found";
-        if (async_data->scan_status == FS_ERROR_MMAP_FAILED) err_str = "Memory mapping failed";
-        if (async_data->scan_status == FS_ERROR_OUT_OF_BOUNDS) err_str = "Buffer allocation failed";
-        if (async_data->scan_status == FS_ERROR_INVALID_ARG) err_str = "Invalid argument";
+    if (!env) {
+        free_results(async_data);
+        free(async_data);
+        return;
+    }
 
-        napi_create_string_utf8(env, err_str, NAPI_AUTO_LENGTH, &error_msg);
+    if (async_data->scan_status != FS_SUCCESS) {
+        napi_value error_msg;
+        napi_create_string_utf8(env, status_message(async_data, async_data->scan_status), NAPI_AUTO_LENGTH, &error_msg);
         napi_reject_deferred(env, async_data->deferred, error_msg);
     } else {
-        napi_value js_result_array;
-        
-        if (async_data->match_count > 0) {
-            size_t byte_length = async_data->match_count * sizeof(fs_size_t);
-
-            napi_value array_buffer;
-            napi_create_external_arraybuffer(
-                env,
-                async_data->matches,
-                byte_length,
-                FreeMatchesCallback,
-                NULL,
-                &array_buffer
-            );
-
-            napi_create_typedarray(
-                env, 
-                napi_biguint64_array, 
-                async_data->match_count, 
-                array_buffer, 
-                0, 
-                &js_result_array
-            );
-
-            async_data->matches = NULL;
+        fastscan_ctx_t* res = &async_data->result;
+        napi_value js_result;
 
+        if (async_data->count_only) {
+            napi_create_double(env, (double)res->match_count, &js_result);
+        } else if (async_data->line_mode) {
+            js_result = wrap_lines_result(env, res);
+        } else if (res->matcher.tagged) {
+            js_result = wrap_multi_result(env, res);
         } else {
-            napi_create_array_with_length(env, 0, &js_result_array);
+            js_result = wrap_external(env, napi_biguint64_array, res->matches, res->match_count, sizeof(fs_size_t));
+            if (res->match_count > 0) res->matches = NULL;
         }
 
-        napi_resolve_deferred(env, async_data->deferred, js_result_array);
+        napi_resolve_deferred(env, async_data->deferred, js_result);
     }
 
-    if (async_data->matches) {
-        free(async_data->matches);
-    }
-    
-    napi_delete_async_work(env, async_data->work);
+    free_results(async_data);
+    release_patterns(env, &async_data->patterns);
+    if (async_data->cancel_ref) napi_delete_reference(env, async_data->cancel_ref);
     free(async_data);
 }
 
+static void RunScan(void* arg) {
+    AsyncScanData* async_data = (AsyncScanData*)arg;
+    napi_threadsafe_function done = async_data->done;
+
+    ExecuteScan(async_data);
+    if (async_data->progress) napi_release_threadsafe_function(async_data->progress, napi_tsfn_release);
+    napi_call_threadsafe_function(done, async_data, napi_tsfn_blocking);
+    napi_release_threadsafe_function(done, napi_tsfn_release);
+}
+
+// Pipes, FIFOs, sockets and devices are read() and wait on their writer: they go to the executor's
+// uncapped lane, so an idle writer never keeps other scans from starting
+static int waits_on_writer(const char* path) {
+    struct stat st;
+    return stat(path, &st) == 0 && !S_ISREG(st.st_mode);
+}
+
+// Queues a filled AsyncScanData on the scan executor (not the libuv pool); takes ownership of it
+static napi_value queue_scan(napi_env env, AsyncScanData* async_data) {
+    napi_status status;
+    napi_value promise;
+    status = napi_create_promise(env, &async_data->deferred, &promise);
+    if (status != napi_ok) { release_patterns(env, &async_data->patterns); free(async_data); return NULL; }
+
+    if (async_data->opts.cancel &&
+        napi_create_reference(env, async_data->opts.cancel_array, 1, &async_data->cancel_ref) != napi_ok) {
+        release_patterns(env, &async_data->patterns);
+        free(async_data);
+        return NULL;
+    }
+    async_data->opts.cancel_array = NULL;
+
+    napi_value resource_name;
+    napi_create_string_utf8(env, "fastscan_resource", NAPI_AUTO_LENGTH, &resource_name);
+
+    // Reports are rate-limited where they are made (progress_interval_ms), so the queue needs no bound
+    if (async_data->opts.on_progress &&
+        napi_create_threadsafe_function(env, async_data->opts.on_progress, NULL, resource_name, 0, 1, NULL, NULL,
+                                        NULL, CallProgress, &async_data->progress) != napi_ok) {
+        release_patterns(env, &async_data->patterns);
+        if (async_data->cancel_ref) napi_delete_reference(env, async_data->cancel_ref);
+        free(async_data);
+        return NULL;
+    }
+    async_data->opts.on_progress = NULL;
+
+    // Keeps the event loop alive until the scan is back, like the async work it replaces
+    status = napi_create_threadsafe_function(env, NULL, NULL, resource_name, 0, 1, NULL, NULL,
+                                             NULL, CompleteScan, &async_data->done);
+    if (status != napi_ok) {
+        if (async_data->progress) napi_release_threadsafe_function(async_data->progress, napi_tsfn_abort);
+        release_patterns(env, &async_data->patterns);
+        if (async_data->cancel_ref) napi_delete_reference(env, async_data->cancel_ref);
+        free(async_data);
+        return NULL;
+    }
+
+    int blocking = waits_on_writer(async_data->file_path);
+    if ((blocking ? fs_executor_submit_blocking : fs_executor_submit)(RunScan, async_data) != 0) {
+        napi_release_threadsafe_function(async_data->done, napi_tsfn_abort);
+        if (async_data->progress) napi_release_threadsafe_function(async_data->progress, napi_tsfn_abort);
+        napi_value err_msg;
+        napi_create_string_utf8(env, "Async internal failure", NAPI_AUTO_LENGTH, &err_msg);
+        napi_reject_deferred(env, async_data->deferred, err_msg);
+        release_patterns(env, &async_data->patterns);
+        if (async_data->cancel_ref) napi_delete_reference(env, async_data->cancel_ref);
+        free(async_data);
+    }
+
+    return promise;
+}
+
 static napi_value ScanFileAsync(napi_env env, napi_callback_info info) {
     napi_status status;
-    size_t argc = 3;
-    napi_value args[3];
+    size_t argc = 4;
+    napi_value args[4];
 
     status = napi_get_cb_info(env, info, &argc, args, NULL, NULL);
-    if (status != napi_ok || argc < 3) return throw_error(env, "Invalid arguments. Expected (path, pattern, maxMatches)");
+    if (status != napi_ok || argc < 3) return throw_error(env, "Invalid arguments. Expected (path, pattern, maxMatches[, options])");
 
-    AsyncScanData* async_data = (AsyncScanData*)malloc(sizeof(AsyncScanData));
+    AsyncScanData* async_data = (AsyncScanData*)calloc(1, sizeof(AsyncScanData));
     if (!async_data) return throw_error(env, "Memory allocation failed");
 
     size_t len;
@@ -119,54 +526,68 @@ static napi_value ScanFileAsync(napi_env env, napi_callback_info info) {
     if (status != napi_ok) { free(async_data); return throw_error(env, "Invalid file path"); }
     if (len >= sizeof(async_data->file_path)) { free(async_data); return throw_error(env, "File path too long"); }
 
-    status = napi_get_value_string_utf8(env, args[1], async_data->pattern, sizeof(async_data->pattern), &len);
-    if (status != napi_ok) { free(async_data); return throw_error(env, "Invalid pattern"); }
-    if (len >= sizeof(async_data->pattern)) { free(async_data); return throw_error(env, "Pattern too long"); }
+    if (!is_external(env, args[1])) {
+        status = napi_get_value_string_utf8(env, args[1], async_data->pattern, sizeof(async_data->pattern), &len);
+        if (status != napi_ok) { free(async_data); return throw_error(env, "Invalid pattern"); }
+        if (len >= sizeof(async_data->pattern)) { free(async_data); return throw_error(env, "Pattern too long"); }
+    }
 
     status = napi_get_value_int32(env, args[2], &async_data->max_matches);
     if (status != napi_ok) { free(async_data); return throw_error(env, "Invalid maxMatches"); }
     if (async_data->max_matches <= 0) { free(async_data); return throw_error(env, "maxMatches must be positive"); }
 
-    napi_value promise;
-    status = napi_create_promise(env, &async_data->deferred, &promise);
-    if (status != napi_ok) { free(async_data); return NULL; }
+    const char* opts_err = read_scan_options(env, argc, args, 3, &async_data->opts);
+    if (opts_err) { free(async_data); return throw_error(env, opts_err); }
 
-    napi_value resource_name;
-    napi_create_string_utf8(env, "fastscan_resource", NAPI_AUTO_LENGTH, &resource_name);
+    // Any compiled kind; the result shape follows it
+    if (is_external(env, args[1])) {
+        const char* err = read_compiled(env, args[1], -1, &async_data->patterns);
+        if (err) { release_patterns(env, &async_data->patterns); free(async_data); return throw_error(env, err); }
+    }
 
-    status = napi_create_async_work(
-        env,
-        NULL,
-        resource_name,
-        ExecuteScan,
-        CompleteScan,
-        async_data,
-        &async_data->work
-    );
+    return queue_scan(env, async_data);
+}
 
-    if (status != napi_ok) {
-        free(async_data);
-        return NULL;
+// Maps, scans and wraps the results of an initialized context, then destroys it
+static napi_value run_sync(napi_env env, fastscan_ctx_t* ctx, const char* file_path) {
+    fs_status_t scan_status = fastscan_load_file(ctx, file_path);
+    if (scan_status != FS_SUCCESS) {
+        fastscan_destroy(ctx);
+        if (scan_status == FS_ERROR_OPEN_FAILED) {
+            return throw_error(env, "Failed to open file");
+        }
+        return throw_error(env, "Failed to map file to memory");
     }
 
-    status = napi_queue_async_work(env, async_data->work);
-    if (status != napi_ok) {
-        napi_delete_async_work(env, async_data->work);
-        free(async_data);
-        return NULL;
+    scan_status = fastscan_execute(ctx);
+    if (scan_status != FS_SUCCESS) {
+        fastscan_destroy(ctx);
+        return throw_error(env, "Error during scanning process");
     }
 
-    return promise;
+    napi_value js_result;
+    if (ctx->line_mode) {
+        js_result = wrap_lines_result(env, ctx);
+    } else if (ctx->matcher.tagged) {
+        js_result = wrap_multi_result(env, ctx);
+    } else {
+        js_result = wrap_external(env, napi_biguint64_array, ctx->matches, ctx->match_count, sizeof(fs_size_t));
+        if (ctx->match_count > 0) ctx->matches = NULL;
+    }
+
+    fastscan_destroy(ctx);
+
+    return js_result;
 }
 
 static napi_value ScanFileSync(napi_env env, napi_callback_info info) {
     napi_status status;
 
-    size_t argc = 3;
-    napi_value args[3];
+    size_t argc = 4;
+    napi_value args[4];
     status = napi_get_cb_info(env, info, &argc, args, NULL, NULL);
     if (status != napi_ok || argc < 3) {
-        return throw_error(env, "Invalid arguments. Expected (path, pattern, maxMatches)");
+        return throw_error(env, "Invalid arguments. Expected (path, pattern, maxMatches[, options])");
     }
 
     size_t path_len, pattern_len;
@@ -177,76 +598,775 @@ static napi_value ScanFileSync(napi_env env, napi_callback_info info) {
     if (status != napi_ok) return throw_error(env, "Invalid file path");
     if (path_len >= sizeof(file_path)) return throw_error(env, "File path too long");
     
-    status = napi_get_value_string_utf8(env, args[1], pattern, sizeof(pattern), &pattern_len);
-    if (status != napi_ok) return throw_error(env, "Invalid pattern");
-    if (pattern_len >= sizeof(pattern)) return throw_error(env, "Pattern too long");
+    int compiled = is_external(env, args[1]);
+    if (!compiled) {
+        status = napi_get_value_string_utf8(env, args[1], pattern, sizeof(pattern), &pattern_len);
+        if (status != napi_ok) return throw_error(env, "Invalid pattern");
+        if (pattern_len >= sizeof(pattern)) return throw_error(env, "Pattern too long");
+    }
 
     int32_t max_matches;
     status = napi_get_value_int32(env, args[2], &max_matches);
     if (status != napi_ok) return throw_error(env, "Invalid maxMatches value");
     if (max_matches <= 0) return throw_error(env, "maxMatches must be positive");
 
+    ScanOptions opts;
+    const char* opts_err = read_scan_options(env, argc, args, 3, &opts);
+    if (opts_err) return throw_error(env, opts_err);
+
     fastscan_ctx_t ctx = {0};
-    fs_status_t scan_status = fastscan_init(&ctx, pattern, (fs_size_t)max_matches);
+    fs_status_t scan_status;
+    PatternList list = {0};
+
+    if (compiled) {
+        const char* err = read_compiled(env, args[1], -1, &list);
+        if (err) { release_patterns(env, &list); return throw_error(env, err); }
+        scan_status = init_patterns(&ctx, &list, (fs_size_t)max_matches);
+    } else {
+        scan_status = fastscan_init(&ctx, pattern, (fs_size_t)max_matches);
+    }
 
+    napi_value result;
     if (scan_status != FS_SUCCESS) {
-        return throw_error(env, "Failed to initialize scanner");
+        result = throw_error(env, "Failed to initialize scanner");
+    } else {
+        apply_scan_options(&ctx, &opts);
+        result = run_sync(env, &ctx, file_path);
     }
 
-    scan_status = fastscan_load_file(&ctx, file_path);
+    release_patterns(env, &list);
+    return result;
+}
+
+static napi_value ScanFileMultiAsync(napi_env env, napi_callback_info info) {
+    napi_status status;
+    size_t argc = 4;
+    napi_value args[4];
+
+    status = napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+    if (status != napi_ok || argc < 3) return throw_error(env, "Invalid arguments. Expected (path, patterns, maxMatches[, options])");
+
+    AsyncScanData* async_data = (AsyncScanData*)calloc(1, sizeof(AsyncScanData));
+    if (!async_data) return throw_error(env, "Memory allocation failed");
+
+    size_t len;
+    status = napi_get_value_string_utf8(env, args[0], async_data->file_path, sizeof(async_data->file_path), &len);
+    if (status != napi_ok) { free(async_data); return throw_error(env, "Invalid file path"); }
+    if (len >= sizeof(async_data->file_path)) { free(async_data); return throw_error(env, "File path too long"); }
+
+    status = napi_get_value_int32(env, args[2], &async_data->max_matches);
+    if (status != napi_ok) { free(async_data); return throw_error(env, "Invalid maxMatches"); }
+    if (async_data->max_matches <= 0) { free(async_data); return throw_error(env, "maxMatches must be positive"); }
+
+    const char* opts_err = read_scan_options(env, argc, args, 3, &async_data->opts);
+    if (opts_err) { free(async_data); return throw_error(env, opts_err); }
+
+    const char* list_err = read_patterns(env, args[1], &async_data->patterns);
+    if (list_err) { release_patterns(env, &async_data->patterns); free(async_data); return throw_error(env, list_err); }
+
+    return queue_scan(env, async_data);
+}
+
+static napi_value ScanFileMultiSync(napi_env env, napi_callback_info info) {
+    napi_status status;
+
+    size_t argc = 4;
+    napi_value args[4];
+    status = napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+    if (status != napi_ok || argc < 3) {
+        return throw_error(env, "Invalid arguments. Expected (path, patterns, maxMatches[, options])");
+    }
+
+    size_t path_len;
+    char file_path[1024];
+
+    status = napi_get_value_string_utf8(env, args[0], file_path, sizeof(file_path), &path_len);
+    if (status != napi_ok) return throw_error(env, "Invalid file path");
+    if (path_len >= sizeof(file_path)) return throw_error(env, "File path too long");
+
+    int32_t max_matches;
+    status = napi_get_value_int32(env, args[2], &max_matches);
+    if (status != napi_ok) return throw_error(env, "Invalid maxMatches value");
+    if (max_matches <= 0) return throw_error(env, "maxMatches must be positive");
+
+    ScanOptions opts;
+    const char* opts_err = read_scan_options(env, argc, args, 3, &opts);
+    if (opts_err) return throw_error(env, opts_err);
+
+    PatternList list;
+    const char* list_err = read_patterns(env, args[1], &list);
+    if (list_err) { release_patterns(env, &list); return throw_error(env, list_err); }
+
+    fastscan_ctx_t ctx = {0};
+    fs_status_t scan_status = init_patterns(&ctx, &list, (fs_size_t)max_matches);
+
+    napi_value result;
     if (scan_status != FS_SUCCESS) {
-        fastscan_destroy(&ctx);
-        if (scan_status == FS_ERROR_OPEN_FAILED) {
-            return throw_error(env, "Failed to open file");
+        result = throw_error(env, "Failed to initialize scanner");
+    } else {
+        apply_scan_options(&ctx, &opts);
+        result = run_sync(env, &ctx, file_path);
+    }
+
+    release_patterns(env, &list);
+    return result;
+}
+
+// (path, pattern[, maxMatches][, options]) into an argument block. The pattern is a string kept in
+// the fixed buffer or a compiled handle of `kind` (-1: any). The caller releases data->patterns either way.
+static const char* read_pattern_args(napi_env env, size_t argc, napi_value* args, int kind, int with_max,
+                                     AsyncScanData* data) {
+    size_t len;
+    if (napi_get_value_string_utf8(env, args[0], data->file_path, sizeof(data->file_path), &len) != napi_ok) return "Invalid file path";
+    if (len >= sizeof(data->file_path)) return "File path too long";
+
+    int compiled = is_external(env, args[1]);
+    if (!compiled) {
+        if (napi_get_value_string_utf8(env, args[1], data->pattern, sizeof(data->pattern), &data->pattern_len) != napi_ok) return "Invalid pattern";
+        if (data->pattern_len >= sizeof(data->pattern)) return "Pattern too long";
+    }
+
+    if (with_max) {
+        if (napi_get_value_int32(env, args[2], &data->max_matches) != napi_ok) return "Invalid maxMatches";
+        if (data->max_matches <= 0) return "maxMatches must be positive";
+    }
+
+    const char* err = read_scan_options(env, argc, args, with_max ? 3 : 2, &data->opts);
+    if (err || !compiled) return err;
+    return read_compiled(env, args[1], kind, &data->patterns);
+}
+
+static const char* read_regex_args(napi_env env, size_t argc, napi_value* args, AsyncScanData* data) {
+    data->is_regex = 1;
+    return read_pattern_args(env, argc, args, FS_PATTERN_REGEX, 1, data);
+}
+
+static napi_value ScanFileRegexAsync(napi_env env, napi_callback_info info) {
+    size_t argc = 4;
+    napi_value args[4];
+    if (napi_get_cb_info(env, info, &argc, args, NULL, NULL) != napi_ok || argc < 3) {
+        return throw_error(env, "Invalid arguments. Expected (path, regex, maxMatches[, options])");
+    }
+
+    AsyncScanData* async_data = (AsyncScanData*)calloc(1, sizeof(AsyncScanData));
+    if (!async_data) return throw_error(env, "Memory allocation failed");
+
+    const char* err = read_regex_args(env, argc, args, async_data);
+    if (err) { release_patterns(env, &async_data->patterns); free(async_data); return throw_error(env, err); }
+
+    return queue_scan(env, async_data);
+}
+
+static napi_value ScanFileRegexSync(napi_env env, napi_callback_info info) {
+    size_t argc = 4;
+    napi_value args[4];
+    if (napi_get_cb_info(env, info, &argc, args, NULL, NULL) != napi_ok || argc < 3) {
+        return throw_error(env, "Invalid arguments. Expected (path, regex, maxMatches[, options])");
+    }
+
+    // Same argument block as the async call; only its buffers are used here
+    AsyncScanData* data = (AsyncScanData*)calloc(1, sizeof(AsyncScanData));
+    if (!data) return throw_error(env, "Memory allocation failed");
+
+    const char* err = read_regex_args(env, argc, args, data);
+    if (err) { release_patterns(env, &data->patterns); free(data); return throw_error(env, err); }
+
+    fastscan_ctx_t ctx = {0};
+    fs_status_t scan_status = data->patterns.compiled
+        ? init_patterns(&ctx, &data->patterns, (fs_size_t)data->max_matches)
+        : fastscan_init_regex(&ctx, data->pattern, data->pattern_len, (fs_size_t)data->max_matches);
+
+    napi_value result;
+    if (scan_status == FS_ERROR_INVALID_ARG) {
+        result = throw_error(env, "Invalid regular expression");
+    } else if (scan_status != FS_SUCCESS) {
+        result = throw_error(env, "Failed to initialize scanner");
+    } else {
+        apply_scan_options(&ctx, &data->opts);
+        result = run_sync(env, &ctx, data->file_path);
+    }
+
+    release_patterns(env, &data->patterns);
+    free(data);
+    return result;
+}
+
+static const char* read_count_args(napi_env env, size_t argc, napi_value* args, AsyncScanData* data) {
+    data->count_only = 1;
+    return read_pattern_args(env, argc, args, -1, 0, data);
+}
+
+static napi_value CountFileAsync(napi_env env, napi_callback_info info) {
+    size_t argc = 3;
+    napi_value args[3];
+    if (napi_get_cb_info(env, info, &argc, args, NULL, NULL) != napi_ok || argc < 2) {
+        return throw_error(env, "Invalid arguments. Expected (path, pattern[, options])");
+    }
+
+    AsyncScanData* async_data = (AsyncScanData*)calloc(1, sizeof(AsyncScanData));
+    if (!async_data) return throw_error(env, "Memory allocation failed");
+
+    const char* err = read_count_args(env, argc, args, async_data);
+    if (err) { release_patterns(env, &async_data->patterns); free(async_data); return throw_error(env, err); }
+
+    return queue_scan(env, async_data);
+}
+
+static napi_value CountFileSync(napi_env env, napi_callback_info info) {
+    size_t argc = 3;
+    napi_value args[3];
+    if (napi_get_cb_info(env, info, &argc, args, NULL, NULL) != napi_ok || argc < 2) {
+        return throw_error(env, "Invalid arguments. Expected (path, pattern[, options])");
+    }
+
+    // Same argument block as the async call; only its buffers are used here
+    AsyncScanData* data = (AsyncScanData*)calloc(1, sizeof(AsyncScanData));
+    if (!data) return throw_error(env, "Memory allocation failed");
+
+    const char* err = read_count_args(env, argc, args, data);
+    if (err) { release_patterns(env, &data->patterns); free(data); return throw_error(env, err); }
+
+    fastscan_ctx_t ctx = {0};
+    fs_status_t scan_status = data->patterns.compiled
+        ? init_patterns(&ctx, &data->patterns, 0)
+        : fastscan_init(&ctx, data->pattern, 0);
+    apply_scan_options(&ctx, &data->opts);
+
+    napi_value result = NULL;
+    if (scan_status != FS_SUCCESS) {
+        throw_error(env, "Failed to initialize scanner");
+    } else if ((scan_status = fastscan_load_file(&ctx, data->file_path)) != FS_SUCCESS) {
+        throw_error(env, scan_status == FS_ERROR_OPEN_FAILED ? "Failed to open file" : "Failed to map file to memory");
+    } else if (fastscan_count(&ctx) != FS_SUCCESS) {
+        throw_error(env, "Error during scanning process");
+    } else {
+        napi_create_double(env, (double)ctx.match_count, &result);
+    }
+
+    fastscan_destroy(&ctx);
+    release_patterns(env, &data->patterns);
+    free(data);
+    return result;
+}
+
+static const char* read_lines_args(napi_env env, size_t argc, napi_value* args, AsyncScanData* data) {
+    data->line_mode = 1;
+    return read_pattern_args(env, argc, args, -1, 1, data);
+}
+
+static napi_value ScanFileLinesAsync(napi_env env, napi_callback_info info) {
+    size_t argc = 4;
+    napi_value args[4];
+    if (napi_get_cb_info(env, info, &argc, args, NULL, NULL) != napi_ok || argc < 3) {
+        return throw_error(env, "Invalid arguments. Expected (path, pattern, maxLines[, options])");
+    }
+
+    AsyncScanData* async_data = (AsyncScanData*)calloc(1, sizeof(AsyncScanData));
+    if (!async_data) return throw_error(env, "Memory allocation failed");
+
+    const char* err = read_lines_args(env, argc, args, async_data);
+    if (err) { release_patterns(env, &async_data->patterns); free(async_data); return throw_error(env, err); }
+
+    return queue_scan(env, async_data);
+}
+
+static napi_value ScanFileLinesSync(napi_env env, napi_callback_info info) {
+    size_t argc = 4;
+    napi_value args[4];
+    if (napi_get_cb_info(env, info, &argc, args, NULL, NULL) != napi_ok || argc < 3) {
+        return throw_error(env, "Invalid arguments. Expected (path, pattern, maxLines[, options])");
+    }
+
+    // Same argument block as the async call; only its buffers are used here
+    AsyncScanData* data = (AsyncScanData*)calloc(1, sizeof(AsyncScanData));
+    if (!data) return throw_error(env, "Memory allocation failed");
+
+    const char* err = read_lines_args(env, argc, args, data);
+    if (err) { release_patterns(env, &data->patterns); free(data); return throw_error(env, err); }
+
+    fastscan_ctx_t ctx = {0};
+    fs_status_t scan_status = data->patterns.compiled
+        ? init_patterns(&ctx, &data->patterns, (fs_size_t)data->max_matches)
+        : fastscan_init(&ctx, data->pattern, (fs_size_t)data->max_matches);
+
+    napi_value result;
+    if (scan_status != FS_SUCCESS) {
+        result = throw_error(env, "Failed to initialize scanner");
+    } else {
+        apply_scan_options(&ctx, &data->opts);
+        ctx.line_mode = 1;
+        result = run_sync(env, &ctx, data->file_path);
+    }
+
+    release_patterns(env, &data->patterns);
+    free(data);
+    return result;
+}
+
+// Streaming scans: batches of at most STREAM_BATCH matches, at most STREAM_DEPTH of them handed to JS
+// and not yet consumed. Windows start at STREAM_FIRST_WINDOW bytes (first matches arrive quickly)
+// and double up to STREAM_MAX_WINDOW while they come back short of a full batch.
+#define STREAM_BATCH 65536
+#define STREAM_DEPTH 4
+#define STREAM_FIRST_WINDOW (8ull * 1024 * 1024)
+#define STREAM_MAX_WINDOW (1024ull * 1024 * 1024)
+
+// Shared by the executor thread and the JS handle; freed by whichever lets go last
+typedef struct {
+    AsyncScanData scan;             // Path, pattern and options; `result` and `deferred` are unused
+    napi_threadsafe_function deliver;
+    fs_size_t limit;                // Matches in the whole stream (0: no limit)
+
+    pthread_mutex_t lock;
+    pthread_cond_t consumed;
+    int pending;                    // Batches handed to JS and not acknowledged yet
+    int32_t stop;                   // The consumer is gone; the scan's cancel flag
+    int refs;
+} StreamData;
+
+// One delivery: a batch of matches, or the end of the stream (offsets NULL) with its status
+typedef struct {
+    fs_size_t* offsets;
+    uint32_t* ids;
+    fs_size_t count;
+    int end;
+    fs_status_t status;
+} StreamBatch;
+
+static void stream_unref(StreamData* s) {
+    pthread_mutex_lock(&s->lock);
+    int last = --s->refs == 0;
+    pthread_mutex_unlock(&s->lock);
+    if (!last) return;
+
+    pthread_mutex_destroy(&s->lock);
+    pthread_cond_destroy(&s->consumed);
+    free(s);
+}
+
+static void stream_stop(StreamData* s) {
+    pthread_mutex_lock(&s->lock);
+    __atomic_store_n(&s->stop, 1, __ATOMIC_RELAXED);
+    pthread_cond_signal(&s->consumed);
+    pthread_mutex_unlock(&s->lock);
+}
+
+// Waits for room under STREAM_DEPTH, then queues the batch; -1 once the consumer is gone
+static int stream_push(StreamData* s, StreamBatch* batch) {
+    pthread_mutex_lock(&s->lock);
+    while (s->pending >= STREAM_DEPTH && !s->stop) pthread_cond_wait(&s->consumed, &s->lock);
+    int stopped = s->stop;
+    if (!stopped) s->pending++;
+    pthread_mutex_unlock(&s->lock);
+
+    if (stopped || napi_call_threadsafe_function(s->deliver, batch, napi_tsfn_blocking) != napi_ok) return -1;
+    return 0;
+}
+
+// Stream regions (pipes, stdin...): matches come block by block and are gathered into batches here
+typedef struct {
+    StreamData* s;
+    int tagged;
+    fs_size_t* offsets;
+    fs_size_t count;
+    fs_size_t sent;
+    int failed;
+} StreamSink;
+
+// Hands the gathered matches to JS; -1 when that is not possible (no memory, consumer gone)
+static int flush_sink(StreamSink* k) {
+    StreamBatch* batch = (StreamBatch*)calloc(1, sizeof(StreamBatch));
+    uint32_t* ids = k->tagged ? (uint32_t*)malloc(k->count * sizeof(uint32_t)) : NULL;
+    if (!batch || (k->tagged && !ids)) {
+        free(batch);
+        free(ids);
+        k->failed = 1;
+        return -1;
+    }
+    for (fs_size_t i = 0; ids && i < k->count; i++) {
+        ids[i] = FS_MATCH_ID(k->offsets[i]);
+        k->offsets[i] = FS_MATCH_OFFSET(k->offsets[i]);
+    }
+
+    // The JS thread frees the batch once it has it
+    fs_size_t n = k->count;
+    batch->offsets = k->offsets;
+    batch->ids = ids;
+    batch->count = n;
+    k->offsets = NULL;
+    k->count = 0;
+    if (stream_push(k->s, batch)) {
+        free(batch->offsets);
+        free(batch->ids);
+        free(batch);
+        return -1;
+    }
+    k->sent += n;
+    return 0;
+}
+
+static int stream_sink(void* arg, const fs_size_t* items, fs_size_t count) {
+    StreamSink* k = (StreamSink*)arg;
+    fs_size_t limit = k->s->limit;
+
+    // End of a block: whatever has been found so far goes out
+    if (count == 0) return k->count ? flush_sink(k) != 0 : 0;
+
+    for (fs_size_t i = 0; i < count; i++) {
+        if (limit && k->sent + k->count >= limit) break;
+        if (!k->offsets && !(k->offsets = (fs_size_t*)malloc(STREAM_BATCH * sizeof(fs_size_t)))) {
+            k->failed = 1;
+            return 1;
         }
-        return throw_error(env, "Failed to map file to memory");
+        k->offsets[k->count++] = items[i];
+        if (k->count == STREAM_BATCH && flush_sink(k)) return 1;
     }
+    return limit && k->sent + k->count >= limit;
+}
 
-    scan_status = fastscan_execute(&ctx);
-    
-    napi_value js_result_array = NULL;
-    
-    if (scan_status == FS_SUCCESS) {
-        if (ctx.match_count > 0) {
-            size_t byte_length = ctx.match_count * sizeof(fs_size_t);
-
-            napi_value array_buffer;
-            napi_create_external_arraybuffer(
-                env, 
-                ctx.matches, 
-                byte_length, 
-                FreeMatchesCallback, 
-                NULL, 
-                &array_buffer
-            );
-
-            napi_create_typedarray(
-                env, 
-                napi_biguint64_array, 
-                ctx.match_count, 
-                array_buffer, 
-                0, 
-                &js_result_array
-            );
+static void RunStream(void* arg) {
+    StreamData* s = (StreamData*)arg;
+    AsyncScanData* scan = &s->scan;
+    napi_threadsafe_function deliver = s->deliver;
+    fastscan_ctx_t ctx = {0};
 
-            ctx.matches = NULL;
+    fs_status_t status = scan->patterns.compiled
+        ? init_patterns(&ctx, &scan->patterns, STREAM_BATCH)
+        : fastscan_init(&ctx, scan->pattern, STREAM_BATCH);
+    apply_scan_options(&ctx, &scan->opts);
+    ctx.cancel = &s->stop;
+    if (status == FS_SUCCESS) status = fastscan_load_file(&ctx, scan->file_path);
+
+    if (status == FS_SUCCESS && ctx.region.stream) {
+        StreamSink k = { s, ctx.matcher.tagged, NULL, 0, 0, 0 };
+        status = fastscan_execute_stream(&ctx, stream_sink, &k);
+        if (status == FS_SUCCESS && k.count) flush_sink(&k);
+        if (status == FS_SUCCESS && k.failed) status = FS_ERROR_OUT_OF_BOUNDS;
+        free(k.offsets);
+    }
+
+    fs_size_t from = 0, sent = 0, window = STREAM_FIRST_WINDOW;
+    while (status == FS_SUCCESS && from < ctx.region.size) {
+        fs_size_t want = s->limit && s->limit - sent < STREAM_BATCH ? s->limit - sent : STREAM_BATCH;
+        if (want == 0) break;
+        fs_size_t to = ctx.region.size - from > window ? from + window : ctx.region.size;
+
+        ctx.max_matches = want;
+        status = fastscan_execute_range(&ctx, from, to);
+        if (status != FS_SUCCESS) break;
+
+        fs_size_t n = ctx.match_count;
+        if (n == STREAM_BATCH && (!s->limit || sent + n < s->limit)) {
+            // Full batch with more to come: resume at its last offset, whose entries are dropped and
+            // found again (a pattern list may have more matches there than the batch had room for)
+            fs_size_t last = ctx.matches[n - 1];
+            fs_size_t keep = n;
+            while (keep > 0 && ctx.matches[keep - 1] == last) keep--;
+            n = keep;
+            from = last;
+
+            // Every entry is at that one offset: all of its entries go out on their own, however many
+            // (a batch longer than STREAM_BATCH only for a list with that many matches at one offset)
+            if (keep == 0) {
+                free(ctx.matches);
+                free(ctx.match_ids);
+                ctx.matches = NULL;
+                ctx.match_ids = NULL;
+                ctx.max_matches = ctx.matcher.max_per_pos;
+                if (s->limit && s->limit - sent < ctx.max_matches) ctx.max_matches = s->limit - sent;
+                status = fastscan_execute_range(&ctx, last, last + 1);
+                if (status != FS_SUCCESS) break;
+                n = ctx.match_count;
+                from = last + 1;
+            }
+        } else {
+            from = to;
+            if (window < STREAM_MAX_WINDOW) window *= 2;
+        }
+
+        if (n == 0) {
+            free(ctx.matches);
+            free(ctx.match_ids);
         } else {
-            napi_create_array_with_length(env, 0, &js_result_array);
+            StreamBatch* batch = (StreamBatch*)calloc(1, sizeof(StreamBatch));
+            if (!batch) {
+                status = FS_ERROR_OUT_OF_BOUNDS;
+                break;
+            }
+            batch->offsets = ctx.matches;
+            batch->ids = ctx.match_ids;
+            batch->count = n;
+            ctx.matches = NULL;
+            ctx.match_ids = NULL;
+            if (stream_push(s, batch)) {
+                free(batch->offsets);
+                free(batch->ids);
+                free(batch);
+                break;
+            }
+            sent += n;
+        }
+        ctx.matches = NULL;
+        ctx.match_ids = NULL;
+        ctx.match_count = 0;
+    }
+    fastscan_destroy(&ctx);
+
+    // The end marker hands `s` back to the JS thread, which releases the pattern and this thread's reference
+    StreamBatch* end = (StreamBatch*)calloc(1, sizeof(StreamBatch));
+    if (end) {
+        end->end = 1;
+        end->status = status == FS_ERROR_CANCELLED ? FS_SUCCESS : status;
+        if (napi_call_threadsafe_function(deliver, end, napi_tsfn_blocking) != napi_ok) free(end);
+    }
+    napi_release_threadsafe_function(deliver, napi_tsfn_release);
+}
+
+// onBatch(null, offsets[, patternIds]) per batch; onBatch(error | null) once at the end
+static void CallBatch(napi_env env, napi_value js_cb, void* context, void* data) {
+    StreamData* s = (StreamData*)context;
+    StreamBatch* batch = (StreamBatch*)data;
+
+    if (!env) {
+        free(batch->offsets);
+        free(batch->ids);
+        free(batch);
+        return;
+    }
+
+    napi_value argv[3], undefined;
+    size_t argc = 1;
+    napi_get_undefined(env, &undefined);
+    napi_get_null(env, &argv[0]);
+
+    if (batch->end) {
+        if (batch->status != FS_SUCCESS) {
+            napi_create_string_utf8(env, status_message(&s->scan, batch->status), NAPI_AUTO_LENGTH, &argv[0]);
         }
+        release_patterns(env, &s->scan.patterns);
     } else {
-        fastscan_destroy(&ctx);
-        return throw_error(env, "Error during scanning process");
+        argv[1] = wrap_external(env, napi_biguint64_array, batch->offsets, batch->count, sizeof(fs_size_t));
+        argc = 2;
+        if (batch->ids) {
+            argv[2] = wrap_external(env, napi_uint32_array, batch->ids, batch->count, sizeof(uint32_t));
+            argc = 3;
+        }
     }
 
-    fastscan_destroy(&ctx);
+    int end = batch->end;
+    free(batch);
+    if (js_cb) napi_call_function(env, undefined, js_cb, argc, argv, NULL);
+    if (end) stream_unref(s);
+}
+
+static void FinalizeStream(napi_env env, void* data, void* hint) {
+    StreamData* s = (StreamData*)data;
+    stream_stop(s);
+    stream_unref(s);
+}
+
+// (path, pattern, options, limit, onBatch) -> handle. `limit` caps the whole stream (0: none); the
+// scan runs on the executor and calls onBatch as batches are ready. streamAck(handle) after each
+// batch is consumed makes room for the next; streamClose(handle) stops the scan.
+static napi_value ScanStream(napi_env env, napi_callback_info info) {
+    size_t argc = 5;
+    napi_value args[5];
+    if (napi_get_cb_info(env, info, &argc, args, NULL, NULL) != napi_ok || argc < 5) {
+        return throw_error(env, "Invalid arguments. Expected (path, pattern, options, limit, onBatch)");
+    }
+
+    StreamData* s = (StreamData*)calloc(1, sizeof(StreamData));
+    if (!s) return throw_error(env, "Memory allocation failed");
+
+    const char* err = read_pattern_args(env, 3, args, -1, 0, &s->scan);
+    double limit = 0;
+    napi_valuetype cb_type;
+    if (!err && (napi_get_value_double(env, args[3], &limit) != napi_ok || !(limit >= 0))) err = "Invalid maxMatches";
+    if (!err && (napi_typeof(env, args[4], &cb_type) != napi_ok || cb_type != napi_function)) err = "Invalid onBatch";
+    if (!err && s->scan.patterns.compiled && s->scan.patterns.compiled->kind == FS_PATTERN_REGEX) s->scan.is_regex = 1;
+    if (err) { release_patterns(env, &s->scan.patterns); free(s); return throw_error(env, err); }
+    s->limit = isinf(limit) || limit >= 18446744073709551616.0 ? 0 : (fs_size_t)limit;
+
+    napi_value resource_name, handle;
+    napi_create_string_utf8(env, "fastscan_stream", NAPI_AUTO_LENGTH, &resource_name);
+    if (napi_create_threadsafe_function(env, args[4], NULL, resource_name, 0, 1, NULL, NULL,
+                                        s, CallBatch, &s->deliver) != napi_ok) {
+        release_patterns(env, &s->scan.patterns);
+        free(s);
+        return throw_error(env, "Memory allocation failed");
+    }
+
+    pthread_mutex_init(&s->lock, NULL);
+    pthread_cond_init(&s->consumed, NULL);
+    s->refs = 2;
+    if (napi_create_external(env, s, FinalizeStream, NULL, &handle) != napi_ok) {
+        napi_release_threadsafe_function(s->deliver, napi_tsfn_abort);
+        release_patterns(env, &s->scan.patterns);
+        pthread_mutex_destroy(&s->lock);
+        pthread_cond_destroy(&s->consumed);
+        free(s);
+        return throw_error(env, "Memory allocation failed");
+    }
+
+    if (fs_executor_submit_blocking(RunStream, s) != 0) {
+        napi_release_threadsafe_function(s->deliver, napi_tsfn_abort);
+        release_patterns(env, &s->scan.patterns);
+        stream_stop(s);
+        stream_unref(s);
+        return throw_error(env, "Async internal failure");
+    }
+    return handle;
+}
+
+static StreamData* get_stream(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    void* p = NULL;
+    if (napi_get_cb_info(env, info, &argc, args, NULL, NULL) != napi_ok || argc < 1) return NULL;
+    if (!is_external(env, args[0]) || napi_get_value_external(env, args[0], &p) != napi_ok) return NULL;
+    return (StreamData*)p;
+}
+
+// streamAck(handle): one delivered batch was consumed
+static napi_value StreamAck(napi_env env, napi_callback_info info) {
+    StreamData* s = get_stream(env, info);
+    if (!s) return throw_error(env, "Invalid stream");
+
+    pthread_mutex_lock(&s->lock);
+    if (s->pending > 0) s->pending--;
+    pthread_cond_signal(&s->consumed);
+    pthread_mutex_unlock(&s->lock);
+    return NULL;
+}
+
+// streamClose(handle): the consumer is done; the scan stops within its cancel step
+static napi_value StreamClose(napi_env env, napi_callback_info info) {
+    StreamData* s = get_stream(env, info);
+    if (!s) return throw_error(env, "Invalid stream");
+    stream_stop(s);
+    return NULL;
+}
+
+static void FreePatternCallback(napi_env env, void* data, void* hint) {
+    fastscan_pattern_destroy((fastscan_pattern_t*)data);
+    free(data);
+}
+
+// { handle, kind, size, maxLength }; the handle owns the compiled pattern
+static napi_value wrap_pattern(napi_env env, fastscan_pattern_t* p) {
+    static const char* const kinds[] = { "literal", "multi", "regex" };
+
+    napi_value handle, result, v;
+    if (napi_create_external(env, p, FreePatternCallback, NULL, &handle) != napi_ok) {
+        fastscan_pattern_destroy(p);
+        free(p);
+        return throw_error(env, "Memory allocation failed");
+    }
+    napi_type_tag_object(env, handle, &PATTERN_TAG);
+
+    napi_create_object(env, &result);
+    napi_set_named_property(env, result, "handle", handle);
+    napi_create_string_utf8(env, kinds[p->kind], NAPI_AUTO_LENGTH, &v);
+    napi_set_named_property(env, result, "kind", v);
+    napi_create_double(env, (double)p->count, &v);
+    napi_set_named_property(env, result, "size", v);
+    // Regex matches are bounded by the line only
+    napi_create_double(env, p->kind == FS_PATTERN_REGEX ? INFINITY : (double)p->matcher.max_len, &v);
+    napi_set_named_property(env, result, "maxLength", v);
+
+    return result;
+}
+
+static napi_value LoadDictionary(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    if (napi_get_cb_info(env, info, &argc, args, NULL, NULL) != napi_ok || argc < 1) {
+        return throw_error(env, "Invalid arguments. Expected (path)");
+    }
+
+    char file_path[1024];
+    size_t path_len;
+    if (napi_get_value_string_utf8(env, args[0], file_path, sizeof(file_path), &path_len) != napi_ok) return throw_error(env, "Invalid file path");
+    if (path_len >= sizeof(file_path)) return throw_error(env, "File path too long");
+
+    fastscan_pattern_t* p = (fastscan_pattern_t*)malloc(sizeof(fastscan_pattern_t));
+    if (!p) return throw_error(env, "Memory allocation failed");
+
+    fs_status_t status = fastscan_pattern_load_list(p, file_path);
+    if (status != FS_SUCCESS) {
+        free(p);
+        if (status == FS_ERROR_OPEN_FAILED) return throw_error(env, "File not found");
+        if (status == FS_ERROR_OUT_OF_BOUNDS) return throw_error(env, "Buffer allocation failed");
+        if (status == FS_ERROR_INVALID_ARG) return throw_error(env, "Invalid dictionary");
+        return throw_error(env, "Memory mapping failed");
+    }
+
+    return wrap_pattern(env, p);
+}
+
+// (pattern[, regex]): a string literal, a regular expression source or a literal list
+static napi_value Compile(napi_env env, napi_callback_info info) {
+    size_t argc = 2;
+    napi_value args[2];
+    if (napi_get_cb_info(env, info, &argc, args, NULL, NULL) != napi_ok || argc < 1) {
+        return throw_error(env, "Invalid arguments. Expected (pattern[, regex])");
+    }
+
+    bool regex = false;
+    if (argc > 1 && napi_get_value_bool(env, args[1], &regex) != napi_ok) return throw_error(env, "Invalid regex flag");
+
+    fastscan_pattern_t* p = (fastscan_pattern_t*)malloc(sizeof(fastscan_pattern_t));
+    if (!p) return throw_error(env, "Memory allocation failed");
+
+    fs_status_t status;
+    bool is_array = false;
+    napi_is_array(env, args[0], &is_array);
+
+    if (is_array && !regex) {
+        // 1. Literal list, copied by read_patterns and again by the compiled pattern
+        PatternList list;
+        const char* err = read_patterns(env, args[0], &list);
+        if (err) { release_patterns(env, &list); free(p); return throw_error(env, err); }
+        status = fastscan_pattern_compile_list(p, list.ptrs, list.lens, list.count);
+        release_patterns(env, &list);
+    } else {
+        // 2. Single string, read once at its exact length
+        size_t len;
+        if (napi_get_value_string_utf8(env, args[0], NULL, 0, &len) != napi_ok) { free(p); return throw_error(env, "Invalid pattern"); }
+        if (!regex && len == 0) { free(p); return throw_error(env, "Invalid pattern"); }
+        if (!regex && len > FS_MAX_PATTERN_LEN) { free(p); return throw_error(env, "Pattern too long"); }
+
+        char* text = (char*)malloc(len + 1);
+        if (!text) { free(p); return throw_error(env, "Memory allocation failed"); }
+        napi_get_value_string_utf8(env, args[0], text, len + 1, &len);
 
-    return js_result_array;
+        status = fastscan_pattern_compile(p, text, len, regex ? FS_PATTERN_REGEX : FS_PATTERN_LITERAL);
+        free(text);
+    }
+
+    if (status != FS_SUCCESS) {
+        free(p);
+        if (status == FS_ERROR_INVALID_ARG) return throw_error(env, regex ? "Invalid regular expression" : "Invalid pattern");
+        return throw_error(env, "Buffer allocation failed");
+    }
+
+    return wrap_pattern(env, p);
+}
+
+// warmup() -> number of pool workers
+static napi_value Warmup(napi_env env, napi_callback_info info) {
+    napi_value result;
+    napi_create_int32(env, fastscan_warmup(), &result);
+    return result;
 }
 
 static napi_value Init(napi_env env, napi_value exports) {
     napi_status status;
     napi_value fn;
 
+    // Pick the scan kernel once for the lifetime of the process
+    fastscan_global_init();
+
     status = napi_create_function(env, NULL, 0, ScanFileSync, NULL, &fn);
     if (status != napi_ok) return NULL;
     napi_set_named_property(env, exports, "scanFile", fn);
@@ -255,6 +1375,102 @@ static napi_value Init(napi_env env, napi_value exports) {
     if (status != napi_ok) return NULL;
     napi_set_named_property(env, exports, "scanFileAsync", fn);
 
+    status = napi_create_function(env, NULL, 0, ScanStream, NULL, &fn);
+    if (status != napi_ok) return NULL;
+    napi_set_named_property(env, exports, "scanStream", fn);
+
+    status = napi_create_function(env, NULL, 0, StreamAck, NULL, &fn);
+    if (status != napi_ok) return NULL;
+    napi_set_named_property(env, exports, "streamAck", fn);
+
+    status = napi_create_function(env, NULL, 0, StreamClose, NULL, &fn);
+    if (status != napi_ok) return NULL;
+    napi_set_named_property(env, exports, "streamClose", fn);
+
+    status = napi_create_function(env, NULL, 0, ScanFileMultiSync, NULL, &fn);
+    if (status != napi_ok) return NULL;
+    napi_set_named_property(env, exports, "scanFileMulti", fn);
+
+    status = napi_create_function(env, NULL, 0, ScanFileMultiAsync, NULL, &fn);
+    if (status != napi_ok) return NULL;
+    napi_set_named_property(env, exports, "scanFileMultiAsync", fn);
+
+    status = napi_create_function(env, NULL, 0, ScanFileRegexSync, NULL, &fn);
+    if (status != napi_ok) return NULL;
+    napi_set_named_property(env, exports, "scanFileRegex", fn);
+
+    status = napi_create_function(env, NULL, 0, ScanFileRegexAsync, NULL, &fn);
+    if (status != napi_ok) return NULL;
+    napi_set_named_property(env, exports, "scanFileRegexAsync", fn);
+
+    status = napi_create_function(env, NULL, 0, ScanFileLinesSync, NULL, &fn);
+    if (status != napi_ok) return NULL;
+    napi_set_named_property(env, exports, "scanFileLines", fn);
+
+    status = napi_create_function(env, NULL, 0, ScanFileLinesAsync, NULL, &fn);
+    if (status != napi_ok) return NULL;
+    napi_set_named_property(env, exports, "scanFileLinesAsync", fn);
+
+    status = napi_create_function(env, NULL, 0, CountFileSync, NULL, &fn);
+    if (status != napi_ok) return NULL;
+    napi_set_named_property(env, exports, "countFile", fn);
+
+    status = napi_create_function(env, NULL, 0, CountFileAsync, NULL, &fn);
+    if (status != napi_ok) return NULL;
+    napi_set_named_property(env, exports, "countFileAsync", fn);
+
+    status = napi_create_function(env, NULL, 0, LoadDictionary, NULL, &fn);
+    if (status != napi_ok) return NULL;
+    napi_set_named_property(env, exports, "loadDictionary", fn);
+
+    status = napi_create_function(env, NULL, 0, Compile, NULL, &fn);
+    if (status != napi_ok) return NULL;
+    napi_set_named_property(env, exports, "compile", fn);
+
+    status = napi_create_function(env, NULL, 0, Warmup, NULL, &fn);
+    if (status != napi_ok) return NULL;
+    napi_set_named_property(env, exports, "warmup", fn);
+
+    napi_value simd;
+    napi_create_string_utf8(env, fs_isa_name(fs_cpu_isa()), NAPI_AUTO_LENGTH, &simd);
+    napi_set_named_property(env, exports, "simd", simd);
+
+    // CPUs of each NUMA node, as the pool places workers and tasks on them
+    napi_value numa;
+    napi_create_array_with_length(env, fs_numa_nodes(), &numa);
+    for (int node = 0; node < fs_numa_nodes(); node++) {
+        int cpus[1024];
+        int n = fs_numa_node_cpus(node, cpus, 1024);
+        if (n > 1024) n = 1024;
+
+        napi_value list, cpu;
+        napi_create_array_with_length(env, n, &list);
+        for (int i = 0; i < n; i++) {
+            napi_create_int32(env, cpus[i], &cpu);
+            napi_set_element(env, list, i, cpu);
+        }
+        napi_set_element(env, numa, node, list);
+    }
+    napi_set_named_property(env, exports, "numaNodes", numa);
+
+    // CPUs scans may use, and what limits them
+    const fs_parallelism_t* par = fs_parallelism();
+    napi_value parallelism, v;
+    napi_create_object(env, &parallelism);
+    napi_create_int32(env, par->online, &v);
+    napi_set_named_property(env, parallelism, "online", v);
+    napi_create_int32(env, par->affinity, &v);
+    napi_set_named_property(env, parallelism, "affinity", v);
+    napi_create_int32(env, par->quota, &v);
+    napi_set_named_property(env, parallelism, "quota", v);
+    napi_create_int32(env, par->cores, &v);
+    napi_set_named_property(env, parallelism, "cores", v);
+    napi_create_int32(env, par->effective, &v);
+    napi_set_named_property(env, parallelism, "effective", v);
+    napi_create_int32(env, par->effective > 1 ? par->effective - 1 : 1, &v);
+    napi_set_named_property(env, parallelism, "threads", v);
+    napi_set_named_property(env, exports, "parallelism", parallelism);
+
     return exports;
 }
 
@@ -0,0 +1,93 @@
+#include "byte_freq.h"
+#include <string.h>
+
+#define SAMPLE_WINDOWS 64
+#define SAMPLE_WINDOW_SIZE 1024
+
+/*
+ * Frequency rank of every byte in typical log text: 0 = rarest, 255 = most common.
+ * Space, timestamp digits, lowercase English letters and separators (":-./")
+ * dominate; control bytes and non-ASCII are rare.
+ */
+static const fs_byte_t g_log_byte_rank[256] = {
+      0,   1,   2,   3,   4,   5,   6,   7,   8, 199, 229,   9,  10, 178,  11,  12, // 0x00
+     13,  14,  15,  16,  17,  18,  19,  20,  21,  22,  23,  24,  25,  26,  27,  28, // 0x10
+    255, 163, 215, 179, 164, 170, 180, 191, 194, 195, 165, 181, 216, 232, 236, 223, // 0x20
+    253, 251, 249, 243, 242, 241, 240, 237, 235, 234, 238, 182, 171, 217, 172, 183, // 0x30
+    173, 207, 186, 202, 203, 218, 192, 196, 193, 208, 166, 174, 200, 197, 206, 204, // 0x40
+    201, 162, 209, 210, 211, 198, 184, 187, 168, 175, 161, 212, 167, 213, 158, 219, // 0x50
+    159, 250, 220, 230, 231, 254, 225, 224, 239, 247, 185, 205, 233, 227, 246, 248, // 0x60
+    226, 176, 244, 245, 252, 228, 214, 221, 188, 222, 169, 189, 177, 190, 160,  29, // 0x70
+     94,  95,  96,  97,  98,  99, 100, 101, 102, 103, 104, 105, 106, 107, 108, 109, // 0x80
+    110, 111, 112, 113, 114, 115, 116, 117, 118, 119, 120, 121, 122, 123, 124, 125, // 0x90
+    126, 127, 128, 129, 130, 131, 132, 133, 134, 135, 136, 137, 138, 139, 140, 141, // 0xA0
+    142, 143, 144, 145, 146, 147, 148, 149, 150, 151, 152, 153, 154, 155, 156, 157, // 0xB0
+     30,  31,  48,  49,  50,  51,  52,  53,  54,  55,  56,  57,  58,  59,  60,  61, // 0xC0
+     62,  63,  64,  65,  66,  67,  68,  69,  70,  71,  72,  73,  74,  75,  76,  77, // 0xD0
+     78,  79,  80,  81,  82,  83,  84,  85,  86,  87,  88,  89,  90,  91,  92,  93, // 0xE0
+     32,  33,  34,  35,  36,  37,  38,  39,  40,  41,  42,  43,  44,  45,  46,  47, // 0xF0
+};
+
+void fs_byte_model_builtin(fs_byte_model_t* model) {
+    for (int b = 0; b < 256; b++) {
+        model->score[b] = g_log_byte_rank[b];
+    }
+}
+
+void fs_byte_model_learn(fs_byte_model_t* model, const fs_byte_t* data, fs_size_t size) {
+    uint32_t counts[256];
+    memset(counts, 0, sizeof(counts));
+
+    // 1. Histogram of a few evenly spaced windows (64KB at most)
+    fs_size_t windows = size / SAMPLE_WINDOW_SIZE;
+    if (windows > SAMPLE_WINDOWS) windows = SAMPLE_WINDOWS;
+
+    if (windows == 0) {
+        for (fs_size_t i = 0; i < size; i++) counts[data[i]]++;
+    } else {
+        fs_size_t stride = size / windows;
+        for (fs_size_t w = 0; w < windows; w++) {
+            const fs_byte_t* p = data + w * stride;
+            for (fs_size_t i = 0; i < SAMPLE_WINDOW_SIZE; i++) counts[p[i]]++;
+        }
+    }
+
+    // 2. Observed count first, built-in rank as tie breaker (bytes absent from the sample)
+    for (int b = 0; b < 256; b++) {
+        model->score[b] = (counts[b] << 8) | g_log_byte_rank[b];
+    }
+}
+
+fs_rare_pair_t fs_pick_rare_pair(const fs_byte_t* pattern, fs_size_t pattern_len, const fs_byte_model_t* model) {
+    fs_rare_pair_t pair = { 0, 0 };
+    if (pattern_len < 2) return pair;
+
+    fs_byte_model_t builtin;
+    if (!model) {
+        fs_byte_model_builtin(&builtin);
+        model = &builtin;
+    }
+
+    // 1. Rarest position
+    for (fs_size_t i = 1; i < pattern_len; i++) {
+        if (model->score[pattern[i]] < model->score[pattern[pair.first]]) pair.first = i;
+    }
+
+    // 2. Second rarest; on ties prefer the position farthest from the first (less correlated)
+    pair.second = pair.first == 0 ? 1 : 0;
+    for (fs_size_t i = 0; i < pattern_len; i++) {
+        if (i == pair.first) continue;
+
+        uint32_t s = model->score[pattern[i]];
+        uint32_t best = model->score[pattern[pair.second]];
+        if (s < best) {
+            pair.second = i;
+        } else if (s == best) {
+            fs_size_t d = i > pair.first ? i - pair.first : pair.first - i;
+            fs_size_t best_d = pair.second > pair.first ? pair.second - pair.first : pair.first - pair.second;
+            if (d > best_d) pair.second = i;
+        }
+    }
+
+    return pair;
+}
@@ -0,0 +1,52 @@
+#include "cpu_features.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+static pthread_once_t g_cpu_once = PTHREAD_ONCE_INIT;
+static fs_isa_t g_isa = FS_ISA_SSE2;
+
+static fs_isa_t detect_isa(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+
+    // __builtin_cpu_supports also checks XCR0, so the OS saves the wide registers
+    if (__builtin_cpu_supports("avx512bw")) return FS_ISA_AVX512BW;
+    if (__builtin_cpu_supports("avx2")) return FS_ISA_AVX2;
+#endif
+    return FS_ISA_SSE2;
+}
+
+static void cpu_init_once(void) {
+    fs_isa_t isa = detect_isa();
+
+    // Manual override for benchmarking / debugging the fallback kernels
+    const char* env = getenv("FASTSCAN_ISA");
+    if (env) {
+        fs_isa_t wanted = isa;
+        if (strcmp(env, "sse2") == 0) wanted = FS_ISA_SSE2;
+        else if (strcmp(env, "avx2") == 0) wanted = FS_ISA_AVX2;
+        else if (strcmp(env, "avx512bw") == 0) wanted = FS_ISA_AVX512BW;
+
+        if (wanted < isa) isa = wanted;
+    }
+
+    g_isa = isa;
+}
+
+void fs_cpu_init(void) {
+    pthread_once(&g_cpu_once, cpu_init_once);
+}
+
+fs_isa_t fs_cpu_isa(void) {
+    fs_cpu_init();
+    return g_isa;
+}
+
+const char* fs_isa_name(fs_isa_t isa) {
+    switch (isa) {
+        case FS_ISA_AVX512BW: return "avx512bw";
+        case FS_ISA_AVX2:     return "avx2";
+        default:              return "sse2";
+    }
+}
@@ -0,0 +1,435 @@
+/*
+ * Dictionary matcher: forward walk of a tail-compressed double-array trie
+ * from every position that passes a prefix Bloom filter.
+ *
+ * Walking from the start position (rather than Aho-Corasick's end-position
+ * reporting) keeps matches in offset order, so chunks, buffer growth and the
+ * merge work exactly as for a single pattern. Tails end every walk as soon
+ * as the prefix is unique, so the typical walk is a handful of array probes.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "dictionary.h"
+#include "mmap_reader.h"
+#include "config.h"
+
+#define unlikely(x) __builtin_expect(!!(x), 0)
+
+#define INITIAL_SLOTS 1024
+
+typedef struct {
+    const fs_byte_t* bytes;
+    uint32_t len;
+    uint32_t id;
+} entry_t;
+
+static int cmp_entry(const void* a, const void* b) {
+    const entry_t* x = (const entry_t*)a;
+    const entry_t* y = (const entry_t*)b;
+    uint32_t n = x->len < y->len ? x->len : y->len;
+    int c = memcmp(x->bytes, y->bytes, n);
+    if (c) return c;
+    if (x->len != y->len) return x->len < y->len ? -1 : 1;
+    return x->id < y->id ? -1 : x->id > y->id;
+}
+
+// Build state: free slots form a doubly linked list so placement skips taken ones
+typedef struct {
+    fs_dict_t* d;
+    int32_t* next_free;
+    int32_t* prev_free;
+    fs_size_t head;         // First free slot (== capacity when none)
+} builder_t;
+
+static void unlink_free(builder_t* b, fs_size_t pos) {
+    int32_t next = b->next_free[pos], prev = b->prev_free[pos];
+    if (prev >= 0) b->next_free[prev] = next; else b->head = (fs_size_t)next;
+    if ((fs_size_t)next < b->d->capacity) b->prev_free[next] = prev;
+}
+
+static int reserve(builder_t* b, fs_size_t slots) {
+    fs_dict_t* d = b->d;
+    if (slots <= d->capacity) return 0;
+
+    fs_size_t cap = d->capacity ? d->capacity : INITIAL_SLOTS;
+    while (cap < slots) cap *= 2;
+    if (cap > INT32_MAX) return -1;
+
+    fs_dict_node_t* nodes = (fs_dict_node_t*)realloc(d->nodes, cap * sizeof(fs_dict_node_t));
+    if (nodes) d->nodes = nodes;
+    int32_t* next = (int32_t*)realloc(b->next_free, cap * sizeof(int32_t));
+    if (next) b->next_free = next;
+    int32_t* prev = (int32_t*)realloc(b->prev_free, cap * sizeof(int32_t));
+    if (prev) b->prev_free = prev;
+    if (!nodes || !next || !prev) return -1;
+
+    // New slots are free; chain them behind the current last free slot
+    fs_size_t old = d->capacity;
+    int32_t last = -1;
+    if (b->head < old) {
+        last = (int32_t)b->head;
+        while ((fs_size_t)b->next_free[last] < old) last = b->next_free[last];
+    }
+    for (fs_size_t i = old; i < cap; i++) {
+        d->nodes[i] = (fs_dict_node_t){ 0, -1, 0 };
+        b->prev_free[i] = i == old ? last : (int32_t)(i - 1);
+        b->next_free[i] = (int32_t)(i + 1);
+    }
+    if (last >= 0) b->next_free[last] = (int32_t)old; else b->head = old;
+
+    d->capacity = cap;
+    return 0;
+}
+
+// Lowest base whose slots base + c are free for every child byte c
+static fs_size_t find_base(builder_t* b, const fs_byte_t* labels, int n) {
+    fs_dict_t* d = b->d;
+    fs_size_t pos = b->head;
+
+    for (;;) {
+        if (pos >= d->capacity) {
+            fs_size_t old = d->capacity;
+            if (reserve(b, old * 2)) return 0;
+            pos = old;
+            continue;
+        }
+
+        if (pos > labels[0]) {
+            fs_size_t base = pos - labels[0];
+            if (reserve(b, base + 256)) return 0;
+
+            int ok = 1;
+            for (int i = 1; i < n; i++) {
+                if (d->nodes[base + labels[i]].check != -1) { ok = 0; break; }
+            }
+            if (ok) return base;
+        }
+        pos = (fs_size_t)b->next_free[pos];
+    }
+}
+
+typedef struct {
+    fs_size_t lo, hi;       // Sorted unique patterns sharing `depth` bytes
+    fs_size_t depth;
+    fs_size_t node;
+    fs_size_t outputs;      // Ids already reported on the path from the root
+} pending_t;
+
+// Breadth-first placement: the hot top levels end up next to each other
+static int place_all(builder_t* b) {
+    fs_dict_t* d = b->d;
+    fs_size_t head = 0, tail = 0, cap = 1024;
+    pending_t* queue = (pending_t*)malloc(cap * sizeof(pending_t));
+    if (!queue) return -1;
+
+    queue[tail++] = (pending_t){ 0, d->unique, 0, 0, 0 };
+
+    while (head < tail) {
+        pending_t w = queue[head++];
+
+        // 1. A unique prefix becomes a leaf; the rest is compared against the tail
+        if (w.hi - w.lo == 1) {
+            d->nodes[w.node].base = -(int32_t)(w.lo + 1);
+            w.outputs += d->id_start[w.lo + 1] - d->id_start[w.lo];
+            if (w.outputs > d->max_per_pos) d->max_per_pos = w.outputs;
+            continue;
+        }
+
+        // 2. Sorted order puts the one pattern ending here first
+        if (d->ulen[w.lo] == w.depth) {
+            d->nodes[w.node].term = (uint32_t)(w.lo + 1);
+            w.outputs += d->id_start[w.lo + 1] - d->id_start[w.lo];
+            if (w.outputs > d->max_per_pos) d->max_per_pos = w.outputs;
+            w.lo++;
+        }
+
+        // 3. Child labels
+        fs_byte_t labels[256];
+        int n = 0;
+        for (fs_size_t i = w.lo; i < w.hi; i++) {
+            fs_byte_t c = d->ustr[i][w.depth];
+            if (n == 0 || labels[n - 1] != c) labels[n++] = c;
+        }
+
+        fs_size_t base = find_base(b, labels, n);
+        if (base == 0) { free(queue); return -1; }
+
+        d->nodes[w.node].base = (int32_t)base;
+        for (int i = 0; i < n; i++) {
+            fs_size_t child = base + labels[i];
+            d->nodes[child].check = (int32_t)w.node;
+            unlink_free(b, child);
+            if (child + 1 > d->size) d->size = child + 1;
+        }
+
+        // 4. Queue the children with their ranges
+        if (tail + n > cap) {
+            // Reclaim the consumed front before growing
+            memmove(queue, queue + head, (tail - head) * sizeof(pending_t));
+            tail -= head;
+            head = 0;
+            while (tail + n > cap) cap *= 2;
+            pending_t* grown = (pending_t*)realloc(queue, cap * sizeof(pending_t));
+            if (!grown) { free(queue); return -1; }
+            queue = grown;
+        }
+
+        fs_size_t lo = w.lo;
+        for (int i = 0; i < n; i++) {
+            fs_size_t hi = lo;
+            while (hi < w.hi && d->ustr[hi][w.depth] == labels[i]) hi++;
+            queue[tail++] = (pending_t){ lo, hi, w.depth + 1, base + labels[i], w.outputs };
+            lo = hi;
+        }
+    }
+
+    free(queue);
+    return 0;
+}
+
+// Word index from the top hash bits, three bit positions from the bottom 18
+static inline uint64_t filter_hash(uint64_t key) {
+    return key * 0x9E3779B97F4A7C15ULL;
+}
+
+static inline uint64_t filter_bits(uint64_t h) {
+    return (1ULL << (h & 63)) | (1ULL << ((h >> 6) & 63)) | (1ULL << ((h >> 12) & 63));
+}
+
+fs_status_t fs_dict_build(fs_dict_t* d, const fs_byte_t* const* patterns, const fs_size_t* lens, fs_size_t count) {
+    if (!d || !patterns || !lens) return FS_ERROR_NULL_PTR;
+    if (count == 0 || count > FS_DICT_MAX_PATTERNS) return FS_ERROR_INVALID_ARG;
+
+    memset(d, 0, sizeof(fs_dict_t));
+    d->count = count;
+    d->min_len = (fs_size_t)-1;
+
+    fs_status_t status = FS_ERROR_OUT_OF_BOUNDS;
+
+    // 1. Own copy of the bytes, sorted (bytes, length, id)
+    fs_size_t total = 0, used = 0;
+    for (fs_size_t i = 0; i < count; i++) {
+        if (lens[i] > FS_MAX_PATTERN_LEN) return FS_ERROR_INVALID_ARG;
+        total += lens[i];
+    }
+
+    entry_t* entries = (entry_t*)malloc(count * sizeof(entry_t));
+    d->blob = (fs_byte_t*)malloc(total ? total : 1);
+    if (!entries || !d->blob) goto fail;
+
+    fs_size_t filled = 0;
+    fs_byte_t* dst = d->blob;
+    for (fs_size_t i = 0; i < count; i++) {
+        if (lens[i] == 0) continue;
+        memcpy(dst, patterns[i], lens[i]);
+        entries[used].bytes = dst;
+        entries[used].len = (uint32_t)lens[i];
+        entries[used].id = (uint32_t)i;
+        dst += lens[i];
+        used++;
+
+        if (lens[i] < d->min_len) d->min_len = lens[i];
+        if (lens[i] > d->max_len) d->max_len = lens[i];
+    }
+    if (used == 0) { status = FS_ERROR_INVALID_ARG; goto fail; }
+
+    qsort(entries, used, sizeof(entry_t), cmp_entry);
+
+    // 2. Unique patterns, each with the ids that share it
+    d->ustr = (const fs_byte_t**)malloc(used * sizeof(fs_byte_t*));
+    d->ulen = (uint32_t*)malloc(used * sizeof(uint32_t));
+    d->id_start = (uint32_t*)malloc((used + 1) * sizeof(uint32_t));
+    d->ids = (uint32_t*)malloc(used * sizeof(uint32_t));
+    if (!d->ustr || !d->ulen || !d->id_start || !d->ids) goto fail;
+
+    for (fs_size_t i = 0; i < used; i++) {
+        const entry_t* e = &entries[i];
+        if (filled == 0 || e->len != d->ulen[filled - 1] || memcmp(e->bytes, d->ustr[filled - 1], e->len) != 0) {
+            d->ustr[filled] = e->bytes;
+            d->ulen[filled] = e->len;
+            d->id_start[filled] = (uint32_t)i;
+            filled++;
+        }
+        d->ids[i] = e->id;
+    }
+    d->id_start[filled] = (uint32_t)used;
+    d->unique = filled;
+
+    free(entries);
+    entries = NULL;
+
+    // 3. Trie
+    builder_t b = { d, NULL, NULL, 0 };
+    int placed = reserve(&b, INITIAL_SLOTS) == 0;
+    if (placed) {
+        d->nodes[0].check = 0;
+        unlink_free(&b, 0);
+        d->size = 1;
+        placed = place_all(&b) == 0;
+    }
+    free(b.next_free);
+    free(b.prev_free);
+    if (!placed) goto fail;
+
+    // 4. Prefix filter
+    d->prefix = d->min_len < FS_DICT_MAX_PREFIX ? d->min_len : FS_DICT_MAX_PREFIX;
+    d->prefix_mask = d->prefix == 8 ? ~0ULL : (1ULL << (8 * d->prefix)) - 1;
+
+    int log_bits = FS_DICT_FILTER_MIN_BITS;
+    while (log_bits < FS_DICT_FILTER_MAX_BITS && ((fs_size_t)1 << log_bits) < filled * 32) log_bits++;
+    d->filter_shift = 64 - (log_bits - 6);
+    d->filter = (uint64_t*)calloc((fs_size_t)1 << (log_bits - 6), sizeof(uint64_t));
+    if (!d->filter) goto fail;
+
+    for (fs_size_t u = 0; u < filled; u++) {
+        uint64_t key = 0;
+        memcpy(&key, d->ustr[u], d->prefix);
+        uint64_t h = filter_hash(key);
+        d->filter[h >> d->filter_shift] |= filter_bits(h);
+    }
+
+    return FS_SUCCESS;
+
+fail:
+    free(entries);
+    fs_dict_destroy(d);
+    return status;
+}
+
+fs_status_t fs_dict_load(fs_dict_t* d, const char* filepath) {
+    if (!d || !filepath) return FS_ERROR_NULL_PTR;
+
+    fs_region_t region = {0};
+    fs_status_t status = fs_mmap_open(filepath, &region);
+    if (status != FS_SUCCESS) return status;
+
+    // 1. Count lines (a final line without newline still counts)
+    fs_size_t lines = 0;
+    for (fs_size_t i = 0; i < region.size; i++) lines += region.data[i] == '\n';
+    if (region.size > 0 && region.data[region.size - 1] != '\n') lines++;
+
+    const fs_byte_t** ptrs = (const fs_byte_t**)malloc((lines ? lines : 1) * sizeof(fs_byte_t*));
+    fs_size_t* lens = (fs_size_t*)malloc((lines ? lines : 1) * sizeof(fs_size_t));
+
+    if (!ptrs || !lens) {
+        status = FS_ERROR_OUT_OF_BOUNDS;
+    } else {
+        // 2. Split
+        fs_size_t n = 0, start = 0;
+        for (fs_size_t i = 0; i <= region.size && n < lines; i++) {
+            if (i < region.size && region.data[i] != '\n') continue;
+            fs_size_t len = i - start;
+            if (len > 0 && region.data[start + len - 1] == '\r') len--;
+            ptrs[n] = region.data + start;
+            lens[n++] = len;
+            start = i + 1;
+        }
+        status = fs_dict_build(d, ptrs, lens, lines);
+    }
+
+    free(ptrs);
+    free(lens);
+    fs_mmap_close(&region);
+    return status;
+}
+
+void fs_dict_destroy(fs_dict_t* d) {
+    if (!d) return;
+    free(d->nodes);
+    free(d->ustr);
+    free(d->ulen);
+    free(d->id_start);
+    free(d->ids);
+    free(d->filter);
+    free(d->blob);
+    memset(d, 0, sizeof(fs_dict_t));
+}
+
+static inline int append_ids(const fs_dict_t* d, fs_size_t u, fs_size_t offset,
+                             fs_size_t* out, fs_size_t* count, fs_size_t cap) {
+    for (uint32_t i = d->id_start[u]; i < d->id_start[u + 1]; i++) {
+        if (unlikely(*count >= cap)) return -1;
+        out[(*count)++] = FS_MATCH_PACK(offset, d->ids[i]);
+    }
+    return 0;
+}
+
+// Every pattern starting at c (avail bytes readable), ids ascending
+static inline int walk(const fs_dict_t* d, const fs_byte_t* c, fs_size_t avail, fs_size_t offset,
+                       fs_size_t* out, fs_size_t* count, fs_size_t cap) {
+    const fs_size_t first = *count;
+    fs_size_t s = 0;
+
+    for (fs_size_t depth = 0;; depth++) {
+        const fs_dict_node_t* node = &d->nodes[s];
+        int32_t base = node->base;
+
+        if (base < 0) {
+            fs_size_t u = (fs_size_t)(-base - 1);
+            fs_size_t len = d->ulen[u];
+            if (len <= avail && memcmp(c + depth, d->ustr[u] + depth, len - depth) == 0) {
+                if (append_ids(d, u, offset, out, count, cap)) return -1;
+            }
+            break;
+        }
+        if (node->term && append_ids(d, node->term - 1, offset, out, count, cap)) return -1;
+        if (depth == avail) break;
+
+        fs_size_t t = (fs_size_t)base + c[depth];
+        if (t >= d->size || d->nodes[t].check != (int32_t)s) break;
+        s = t;
+    }
+
+    // Shorter patterns came first; order by id (few entries)
+    for (fs_size_t i = first + 1; i < *count; i++) {
+        fs_size_t v = out[i], j = i;
+        while (j > first && out[j - 1] > v) { out[j] = out[j - 1]; j--; }
+        out[j] = v;
+    }
+    return 0;
+}
+
+static fs_size_t dict_span(const fs_matcher_t* m, const fs_byte_t* data, fs_size_t data_len,
+                           fs_size_t from, fs_size_t to, fs_size_t* out, fs_size_t* count, fs_size_t cap) {
+    const fs_dict_t* d = (const fs_dict_t*)m->impl;
+    if (data_len < d->min_len) return to;
+
+    // Last start position that still fits the shortest pattern
+    fs_size_t limit = data_len - d->min_len + 1;
+    if (limit > to) limit = to;
+    if (from >= limit) return to;
+
+    const uint64_t* filter = d->filter;
+    const uint64_t mask = d->prefix_mask;
+    const int shift = d->filter_shift;
+
+    // 1. Whole-word keys while 8 bytes are readable, 2. byte loads for the last few
+    fs_size_t fast_end = data_len >= 8 ? data_len - 7 : 0;
+    if (fast_end > limit) fast_end = limit;
+
+    for (fs_size_t p = from; p < limit; p++) {
+        const fs_byte_t* c = data + p;
+        uint64_t key = 0;
+        if (p < fast_end) memcpy(&key, c, 8);
+        else memcpy(&key, c, d->prefix);
+        uint64_t h = filter_hash(key & mask);
+        uint64_t want = filter_bits(h);
+        if ((filter[h >> shift] & want) != want) continue;
+
+        fs_size_t before = *count;
+        if (walk(d, c, data_len - p, p, out, count, cap)) {
+            *count = before;
+            return p;
+        }
+    }
+    return to;
+}
+
+void fs_dict_matcher(fs_matcher_t* out, const fs_dict_t* d) {
+    out->span = dict_span;
+    out->count = NULL;
+    out->impl = d;
+    out->max_len = d->max_len;
+    out->max_per_pos = d->max_per_pos;
+    out->tagged = 1;
+}
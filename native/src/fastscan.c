@@ -1,221 +1,1366 @@
 #include <stdlib.h>
 #include <string.h>
-#include <pthread.h> 
+#include <pthread.h>
+#include <time.h>
 #include <unistd.h>  
-#include <emmintrin.h>
 #include "fastscan.h"
 #include "mmap_reader.h"
 #include "scanner.h"
+#include "cpu_features.h"
+#include "kernels.h"
+#include "thread_pool.h"
+#include "numa_topology.h"
+#include "parallelism.h"
+#include "stream_reader.h"
+#include "uring_reader.h"
+#include "lines_impl.h"
 
 #define INITIAL_THREAD_CAPACITY 4096
 
+// Matches per span call when counting through an engine without a count kernel
+#define COUNT_BUFFER 4096
+
+// First result capacity of a stream scan, whose size is not known up front; doubled as needed
+#define STREAM_INITIAL_MATCHES 4096
+
+// Work-stealing tasks: page-aligned slices of 1-4MB, about TASKS_PER_THREAD per thread
+#define TASK_MIN_SIZE (1024 * 1024)
+#define TASK_MAX_SIZE (4 * 1024 * 1024)
+#define TASKS_PER_THREAD 4
+
+// Pages per task whose NUMA node is looked up to place the task
+#define NODE_SAMPLES 4
+
+// Bytes scanned between checks of whether a task is still needed (budget cutoff or ctx->cancel)
+#define CANCEL_STEP (256 * 1024)
+
+// Pages of the file mincore looks at before FS_IO_AUTO picks io_uring
+#define URING_RESIDENT_SAMPLES 64
+
+// Shared maxMatches budget: once finished tasks up to index k hold `limit` entries,
+// no task after k can contribute to the result and `cutoff` drops to k
 typedef struct {
-    const fs_byte_t* start;
-    fs_size_t size;
-    const fs_byte_t* pattern;
-    fs_size_t pattern_len;
-    
-    fs_size_t* matches;
+    pthread_mutex_t lock;
+    fs_size_t limit;
+    fs_size_t ntasks;
+    fs_size_t* tree;            // Fenwick tree over the entry counts of finished tasks
+    fs_size_t cutoff;           // Read without the lock; tasks past it stop
+} scan_budget_t;
+
+// Progress counters of one task, on a cache line of their own: only the task writes them
+typedef struct {
+    fs_size_t bytes;
+    fs_size_t matches;
+} __attribute__((aligned(64))) task_progress_t;
+
+// Progress of a scan: the task that finds the interval elapsed claims the report (CAS on `next`),
+// sums the task counters and calls ctx->on_progress. Nothing is shared in between.
+typedef struct {
+    task_progress_t* tasks;     // NULL when nobody listens
+    fs_size_t ntasks;
+    fs_size_t total_bytes;
+    fs_size_t max_matches;      // Cap on the reported matches (0: none)
+    uint64_t interval_ns;
+    uint64_t next;              // CLOCK_MONOTONIC time of the next report
+    fs_progress_fn fn;
+    void* arg;
+} scan_progress_t;
+
+// A task's results: slabs of doubling size, chained instead of realloc'd, so growing never copies
+typedef struct result_slab {
+    struct result_slab* next;
+    fs_size_t* items;
     fs_size_t count;
     fs_size_t capacity;
-    fs_size_t max_collect; 
-    
-    fs_size_t true_chunk_start;
+} result_slab_t;
+
+typedef struct {
+    const fs_matcher_t* matcher;
     const fs_byte_t* global_start;
-} __attribute__((aligned(64))) thread_data_t;
+    fs_size_t global_size;
+    const fs_region_t* paged;   // The file global_start maps (from offset `base`), paged in around the cursor; NULL: a buffer
+    fs_size_t base;
+    struct window_set* windows; // Windowed region: the task maps its range through one of these
 
-static int grow_buffer(thread_data_t* td) {
-    if (td->count >= td->max_collect) return -1; 
-    fs_size_t new_cap = td->capacity == 0 ? INITIAL_THREAD_CAPACITY : td->capacity * 2;
-    if (new_cap > td->max_collect) new_cap = td->max_collect; 
+    // Start positions owned by this task; reads run up to chunk_end + max_len - 1
+    fs_size_t true_chunk_start;
+    fs_size_t chunk_end;
     
-    fs_size_t* new_buf = (fs_size_t*)realloc(td->matches, new_cap * sizeof(fs_size_t));
-    if (!new_buf) return -1;
-    td->matches = new_buf;
-    td->capacity = new_cap;
+    result_slab_t* first;
+    result_slab_t* slab;        // The one being filled
+    fs_size_t filled;           // Entries in the slabs before it
+    fs_size_t max_collect; 
+    fs_size_t counted;          // Entries already added to the budget
+    // Merge: where the task's entries go in the final array, and how many of them fit before max_matches
+    fs_size_t out;
+    fs_size_t* dst;
+    fs_size_t room;
+
+    // Line mode: `matches` holds (start, end, newlines since true_chunk_start) per line
+    const fs_needle_t* newline;
+    fs_size_t newlines;         // In the whole task (when it was scanned to the end)
+
+    scan_budget_t* budget;      // NULL when every task runs to its end
+    fs_size_t index;
+    const int32_t* cancel;      // ctx->cancel
+    scan_progress_t* progress;
+} __attribute__((aligned(64))) task_data_t;
+
+static int budget_init(scan_budget_t* b, fs_size_t ntasks, fs_size_t limit) {
+    b->tree = (fs_size_t*)calloc(ntasks + 1, sizeof(fs_size_t));
+    if (!b->tree) return -1;
+    pthread_mutex_init(&b->lock, NULL);
+    b->limit = limit;
+    b->ntasks = ntasks;
+    b->cutoff = ntasks;
     return 0;
 }
 
-static inline int verify_simd(const fs_byte_t* str, const fs_byte_t* pattern, fs_size_t len) {
-    if (len <= 16) {
-        __m128i p_vec = _mm_loadu_si128((const __m128i*)pattern);
-        __m128i s_vec = _mm_loadu_si128((const __m128i*)str);
-        __m128i cmp = _mm_cmpeq_epi8(p_vec, s_vec);
-        unsigned int mask = _mm_movemask_epi8(cmp);
-        unsigned int target_mask = (1U << len) - 1;
-        return (mask & target_mask) == target_mask;
-    }
-    return memcmp(str, pattern, len) == 0;
+static void budget_destroy(scan_budget_t* b) {
+    pthread_mutex_destroy(&b->lock);
+    free(b->tree);
 }
 
-void* worker_thread(void* arg) {
-    thread_data_t* td = (thread_data_t*)arg;
-    
-    const fs_byte_t* p = td->start;
-    const fs_byte_t* global_start = td->global_start;
-    const fs_byte_t* limit = td->start + td->size - td->pattern_len + 1;
-    const fs_byte_t* overlap_end = global_start + td->true_chunk_start;
-    
-    __m128i first_vec = _mm_set1_epi8(td->pattern[0]);
-    fs_size_t pat_len = td->pattern_len;
-
-    // PHASE 1: Overlap Region
-    while (p < limit && p < overlap_end) {
-        if (*p == td->pattern[0]) {
-            if (verify_simd(p, td->pattern, pat_len)) {
-                fs_size_t abs_off = (fs_size_t)(p - global_start);
-                if (abs_off >= td->true_chunk_start) {
-                    if (td->count >= td->capacity) { if(grow_buffer(td)) goto cleanup; }
-                    td->matches[td->count++] = abs_off;
-                }
+static int budget_cancelled(const task_data_t* td) {
+    return td->budget && td->index > __atomic_load_n(&td->budget->cutoff, __ATOMIC_ACQUIRE);
+}
+
+static int scan_cancelled(const int32_t* cancel) {
+    return cancel && __atomic_load_n(cancel, __ATOMIC_RELAXED);
+}
+
+// The task's results will not be used: past the budget cutoff, or the whole scan was cancelled
+static int task_stopped(const task_data_t* td) {
+    return budget_cancelled(td) || scan_cancelled(td->cancel);
+}
+
+// Brings the task's entries in the budget up to `entries` (they only grow), finds the first
+// index whose prefix reaches the limit, and returns the entries counted for the tasks before it
+static fs_size_t budget_update(task_data_t* td, fs_size_t entries) {
+    scan_budget_t* b = td->budget;
+    if (!b) return 0;
+
+    pthread_mutex_lock(&b->lock);
+    if (entries > td->counted) {
+        fs_size_t add = entries - td->counted;
+        td->counted = entries;
+        for (fs_size_t i = td->index + 1; i <= b->ntasks; i += i & (~i + 1)) b->tree[i] += add;
+
+        fs_size_t pos = 0, left = b->limit, step = 1;
+        while (step * 2 <= b->ntasks) step *= 2;
+        for (; step; step /= 2) {
+            if (pos + step <= b->ntasks && b->tree[pos + step] < left) {
+                pos += step;
+                left -= b->tree[pos];
             }
         }
-        p++;
+        if (pos < b->cutoff) __atomic_store_n(&b->cutoff, pos, __ATOMIC_RELEASE);
     }
 
-    // PHASE 2: Main Chunk
-    while ((uintptr_t)p % 16 != 0 && p < limit) {
-        if (*p == td->pattern[0] && verify_simd(p, td->pattern, pat_len)) {
-             if (td->count >= td->capacity) { if(grow_buffer(td)) goto cleanup; }
-             td->matches[td->count++] = (fs_size_t)(p - global_start);
+    fs_size_t before = 0;
+    for (fs_size_t i = td->index; i; i -= i & (~i + 1)) before += b->tree[i];
+    pthread_mutex_unlock(&b->lock);
+    return before;
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static int progress_init(scan_progress_t* p, const fastscan_ctx_t* ctx, fs_size_t ntasks, fs_size_t max_matches) {
+    memset(p, 0, sizeof(scan_progress_t));
+    if (!ctx->on_progress) return 0;
+
+    if (posix_memalign((void**)&p->tasks, 64, ntasks * sizeof(task_progress_t)) != 0) {
+        p->tasks = NULL;
+        return -1;
+    }
+    memset(p->tasks, 0, ntasks * sizeof(task_progress_t));
+    p->ntasks = ntasks;
+    p->total_bytes = ctx->region.size;
+    p->max_matches = max_matches;
+    p->interval_ns = (uint64_t)(ctx->progress_interval_ms ? ctx->progress_interval_ms : 100) * 1000000ull;
+    p->next = now_ns() + p->interval_ns;
+    p->fn = ctx->on_progress;
+    p->arg = ctx->progress_arg;
+    return 0;
+}
+
+static void progress_report(const scan_progress_t* p, fs_size_t bytes, fs_size_t matches) {
+    fs_progress_t report = { bytes, p->total_bytes, matches };
+    if (p->max_matches && report.matches > p->max_matches) report.matches = p->max_matches;
+    p->fn(p->arg, &report);
+}
+
+// Publishes a task's counters; reports when the interval has passed and no other task got there first
+static void progress_update(scan_progress_t* p, fs_size_t index, fs_size_t bytes, fs_size_t matches) {
+    if (!p || !p->tasks) return;
+    __atomic_store_n(&p->tasks[index].bytes, bytes, __ATOMIC_RELAXED);
+    __atomic_store_n(&p->tasks[index].matches, matches, __ATOMIC_RELAXED);
+
+    uint64_t now = now_ns();
+    uint64_t due = __atomic_load_n(&p->next, __ATOMIC_RELAXED);
+    if (now < due) return;
+    if (!__atomic_compare_exchange_n(&p->next, &due, now + p->interval_ns, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) return;
+
+    fs_size_t total_bytes = 0, total_matches = 0;
+    for (fs_size_t i = 0; i < p->ntasks; i++) {
+        total_bytes += __atomic_load_n(&p->tasks[i].bytes, __ATOMIC_RELAXED);
+        total_matches += __atomic_load_n(&p->tasks[i].matches, __ATOMIC_RELAXED);
+    }
+    progress_report(p, total_bytes, total_matches);
+}
+
+// Last report, from the calling thread once every task is done (not for a cancelled scan)
+static void progress_finish(scan_progress_t* p, fs_size_t matches) {
+    if (p->tasks) progress_report(p, p->total_bytes, matches);
+    free(p->tasks);
+    p->tasks = NULL;
+}
+
+static fs_size_t task_entries(const task_data_t* td) {
+    return td->filled + (td->slab ? td->slab->count : 0);
+}
+
+static void free_slabs(task_data_t* td) {
+    while (td->first) {
+        result_slab_t* next = td->first->next;
+        free(td->first->items);
+        free(td->first);
+        td->first = next;
+    }
+    td->slab = NULL;
+    td->filled = 0;
+}
+
+// What the task adds to the budget: matches, or lines less a first one that may be merged away
+static fs_size_t budget_entries(const task_data_t* td) {
+    if (!td->newline) return task_entries(td);
+    fs_size_t lines = task_entries(td) / 3;
+    if (lines && td->first->items[0] < td->true_chunk_start) lines--;
+    return lines;
+}
+
+// A task past the cutoff gives its memory back at once; the merge never gets to it
+static void finish_task(task_data_t* td) {
+    budget_update(td, budget_entries(td));
+    if (task_stopped(td)) free_slabs(td);
+}
+
+// Room for `need` more entries: the current slab, or a new one twice its size. Each new slab
+// also reports the task's entries to the budget, and caps the task at max_collect less what
+// the tasks before it already hold (running ones included): those alone fill the first N.
+static int reserve(task_data_t* td, fs_size_t need) {
+    if (td->slab && td->slab->capacity - td->slab->count >= need) return 0;
+
+    fs_size_t entries = task_entries(td);
+    fs_size_t held = budget_update(td, budget_entries(td)) * (td->newline ? 3 : 1);
+    fs_size_t limit = held < td->max_collect ? td->max_collect - held : 0;
+    if (limit < entries + need) return -1;
+
+    fs_size_t cap = td->slab ? td->slab->capacity * 2 : INITIAL_THREAD_CAPACITY;
+    if (cap > limit - entries) cap = limit - entries;
+
+    result_slab_t* s = (result_slab_t*)malloc(sizeof(result_slab_t));
+    if (!s) return -1;
+    s->items = (fs_size_t*)malloc(cap * sizeof(fs_size_t));
+    if (!s->items) {
+        free(s);
+        return -1;
+    }
+    s->next = NULL;
+    s->count = 0;
+    s->capacity = cap;
+
+    if (td->slab) td->slab->next = s;
+    else td->first = s;
+    td->slab = s;
+    td->filled = entries;
+    return 0;
+}
+
+static void place_task(void* arg) {
+    task_data_t* td = (task_data_t*)arg;
+    fs_size_t room = td->room;
+    fs_size_t* dst = td->dst;
+
+    for (result_slab_t* s = td->first; s && room; s = s->next) {
+        fs_size_t n = s->count < room ? s->count : room;
+        memcpy(dst, s->items, n * sizeof(fs_size_t));
+        dst += n;
+        room -= n;
+    }
+    free_slabs(td);
+}
+
+// Line mode: the first match of a line ends the search in it; the next one starts past its newline
+static void line_worker(task_data_t* td) {
+    const fs_matcher_t* m = td->matcher;
+    const fs_byte_t* data = td->global_start;
+    const fs_needle_t* nl = td->newline;
+    fs_size_t pos = td->true_chunk_start;
+    fs_size_t counted = pos;
+    fs_size_t report_at = pos + CANCEL_STEP;
+
+    fs_size_t* hits = (fs_size_t*)malloc(m->max_per_pos * sizeof(fs_size_t));
+    if (!hits) return;
+
+    fs_pagein_t pagein;
+    fs_pagein_begin(&pagein, td->paged, data, td->global_size, td->base, pos, td->chunk_end);
+    while (pos < td->chunk_end && !task_stopped(td)) {
+        fs_pagein_advance(&pagein, pos);
+        fs_size_t n = 0;
+        fs_size_t to = td->chunk_end - pos > CANCEL_STEP ? pos + CANCEL_STEP : td->chunk_end;
+        m->span(m, data, td->global_size, pos, to, hits, &n, m->max_per_pos);
+        if (n == 0) {
+            pos = to;
+            progress_update(td->progress, td->index, pos - td->true_chunk_start, task_entries(td) / 3);
+            continue;
+        }
+
+        if (reserve(td, 3)) break;
+
+        // 1. The line around the first hit; one starting before the task keeps the task's first line number
+        fs_size_t hit = m->tagged ? FS_MATCH_OFFSET(hits[0]) : hits[0];
+        fs_size_t start = fs_line_start(data, 0, hit);
+        fs_size_t end = fs_line_end(data, td->global_size, hit);
+
+        // 2. Newlines from where counting stopped up to the line
+        if (start > counted) {
+            td->newlines += nl->count(nl, data + counted, data + start, data + start);
+            counted = start;
+        }
+
+        result_slab_t* s = td->slab;
+        s->items[s->count++] = start;
+        s->items[s->count++] = end;
+        s->items[s->count++] = td->newlines;
+        pos = end + 1;
+
+        if (pos >= report_at) {
+            report_at = pos + CANCEL_STEP;
+            progress_update(td->progress, td->index, (pos < td->chunk_end ? pos : td->chunk_end) - td->true_chunk_start,
+                            task_entries(td) / 3);
         }
-        p++;
     }
+    free(hits);
 
-    const fs_byte_t* simd_limit = limit - 16;
-    while (p < simd_limit) {
-        __m128i chunk = _mm_load_si128((const __m128i*)p);
-        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, first_vec));
+    // 3. Rest of the task, for the line numbers of the tasks after it (none are needed past the cutoff)
+    if (counted < td->chunk_end && !task_stopped(td)) {
+        td->newlines += nl->count(nl, data + counted, data + td->chunk_end, data + td->chunk_end);
+    }
+    fs_pagein_end(&pagein, td->chunk_end);
 
-        while (mask) {
-            int offset = __builtin_ctz(mask);
-            const fs_byte_t* candidate = p + offset;
+    finish_task(td);
+}
 
-            if (verify_simd(candidate, td->pattern, pat_len)) {
-                if (td->count >= td->capacity) { if(grow_buffer(td)) goto cleanup; }
-                td->matches[td->count++] = (fs_size_t)(candidate - global_start);
-            }
-            mask &= mask - 1;
+static void scan_task(void* arg) {
+    task_data_t* td = (task_data_t*)arg;
+    const fs_matcher_t* m = td->matcher;
+    fs_size_t pos = td->true_chunk_start;
+
+    if (td->newline) {
+        line_worker(td);
+        return;
+    }
+
+    // Same span as the single-threaded path, resumed whenever the buffer fills
+    // and every CANCEL_STEP bytes to see whether earlier tasks already hold enough
+    fs_pagein_t pagein;
+    fs_pagein_begin(&pagein, td->paged, td->global_start, td->global_size, td->base, pos, td->chunk_end);
+    while (pos < td->chunk_end && !task_stopped(td)) {
+        fs_pagein_advance(&pagein, pos);
+        if (reserve(td, m->max_per_pos)) break;
+        fs_size_t to = td->chunk_end - pos > CANCEL_STEP ? pos + CANCEL_STEP : td->chunk_end;
+        pos = m->span(m, td->global_start, td->global_size, pos, to,
+                      td->slab->items, &td->slab->count, td->slab->capacity);
+        progress_update(td->progress, td->index, pos - td->true_chunk_start, task_entries(td));
+    }
+    fs_pagein_end(&pagein, pos);
+    finish_task(td);
+}
+
+// Threads per scan: one per usable CPU (affinity, cgroup quota, SMT) but one, unless the scan asks
+static int scan_threads(const fastscan_ctx_t* ctx) {
+    if (ctx && ctx->threads > 0) return ctx->threads;
+    int cpus = fs_parallelism()->effective;
+    return cpus > 1 ? cpus - 1 : 1;
+}
+
+// Bytes per task. A file too small for TASK_MIN_SIZE tasks on every thread gets one task per thread.
+static fs_size_t task_size(fs_size_t total_size, int nth) {
+    fs_size_t sz = total_size / ((fs_size_t)nth * TASKS_PER_THREAD);
+    if (sz < TASK_MIN_SIZE) sz = TASK_MIN_SIZE;
+    if (sz > TASK_MAX_SIZE) sz = TASK_MAX_SIZE;
+    if (total_size / sz < (fs_size_t)nth) sz = (total_size + nth - 1) / nth;
+    return (sz + FS_MEMORY_ALIGNMENT - 1) / FS_MEMORY_ALIGNMENT * FS_MEMORY_ALIGNMENT;
+}
+
+// Zeroed, cache-line aligned array of per-task state
+static void* alloc_tasks(fs_size_t n, size_t size) {
+    void* tasks = NULL;
+    if (posix_memalign(&tasks, 64, n * size) != 0) return NULL;
+    memset(tasks, 0, n * size);
+    return tasks;
+}
+
+// NUMA node of each task: where most of its sampled pages live. Tasks whose pages are not resident
+// yet are dealt out to the nodes with CPUs in turn, so the page cache they fault in is spread over them.
+// NULL on a single node (or when out of memory): any runner may take any task.
+static int* task_nodes(const fs_byte_t* data, fs_size_t total_size, fs_size_t task_sz, fs_size_t ntasks, int nth) {
+    int nnodes = fs_numa_nodes();
+    if (nnodes <= 1 || nth <= 1 || ntasks <= 1) return NULL;
+
+    int* nodes = (int*)malloc(ntasks * sizeof(int));
+    const void** pages = (const void**)malloc(ntasks * NODE_SAMPLES * sizeof(void*));
+    int* found = (int*)malloc(ntasks * NODE_SAMPLES * sizeof(int));
+    if (!nodes || !pages || !found) {
+        free(nodes);
+        free(pages);
+        free(found);
+        return NULL;
+    }
+
+    for (fs_size_t i = 0; i < ntasks; i++) {
+        fs_size_t start = i * task_sz;
+        fs_size_t len = (i == ntasks - 1 ? total_size : (i + 1) * task_sz) - start;
+        for (int s = 0; s < NODE_SAMPLES; s++) {
+            fs_size_t at = start + len / NODE_SAMPLES * s;
+            pages[i * NODE_SAMPLES + s] = data + at / FS_MEMORY_ALIGNMENT * FS_MEMORY_ALIGNMENT;
         }
-        p += 16;
-        
+    }
+    fs_numa_page_nodes(pages, (int)(ntasks * NODE_SAMPLES), found);
 
-        if (td->count >= td->max_collect) goto cleanup;
+    int with_cpus[FS_NUMA_MAX_NODES];
+    int ncpu_nodes = 0;
+    for (int n = 0; n < nnodes; n++) {
+        if (fs_numa_node_cpus(n, NULL, 0) > 0) with_cpus[ncpu_nodes++] = n;
     }
+    if (ncpu_nodes == 0) with_cpus[ncpu_nodes++] = 0;
 
-    while (p < limit) {
-        if (*p == td->pattern[0] && verify_simd(p, td->pattern, pat_len)) {
-             if (td->count >= td->capacity) { if(grow_buffer(td)) goto cleanup; }
-             td->matches[td->count++] = (fs_size_t)(p - global_start);
+    for (fs_size_t i = 0; i < ntasks; i++) {
+        int votes[FS_NUMA_MAX_NODES] = { 0 };
+        int best = -1;
+        for (int s = 0; s < NODE_SAMPLES; s++) {
+            int node = found[i * NODE_SAMPLES + s];
+            if (node < 0) continue;
+            if (++votes[node] > (best < 0 ? 0 : votes[best])) best = node;
         }
-        p++;
+        nodes[i] = best >= 0 ? best : with_cpus[i % ncpu_nodes];
     }
+    free(pages);
+    free(found);
+    return nodes;
+}
 
-cleanup:
-    return NULL;
+// The calling thread is one of the nth runners, so the pool needs one worker less
+static void run_tasks(fs_task_fn fn, void* tasks, size_t stride, fs_size_t n, int nth, const int* nodes) {
+    if (nth > 1 && n > 1) fs_pool_start(nth - 1);
+    fs_pool_run_tasks(fn, tasks, stride, (int)n, nth, nodes);
 }
 
-fs_status_t fastscan_init(fastscan_ctx_t* ctx, const char* pattern, fs_size_t max_results) {
+// Windowed regions: the mappings the runners of one scan share. A task takes a free window that
+// already covers its range, or maps a free one over its range and the FS_MMAP_WINDOW bytes after it.
+// No more than nth tasks run at once, so one of the nth windows is always free.
+typedef struct {
+    fs_window_t win;
+    int busy;
+} __attribute__((aligned(64))) window_slot_t;
+
+typedef struct window_set {
+    pthread_mutex_t lock;
+    const fs_region_t* region;
+    window_slot_t* slots;
+    int nslots;
+    fs_size_t reach;            // Bytes a task reads past its end: max_len - 1
+    int failed;                 // A window could not be mapped
+} window_set_t;
+
+static int windows_init(window_set_t* ws, const fastscan_ctx_t* ctx, int nth) {
+    memset(ws, 0, sizeof(window_set_t));
+    if (!ctx->region.windowed) return 0;
+    ws->slots = (window_slot_t*)alloc_tasks((fs_size_t)nth, sizeof(window_slot_t));
+    if (!ws->slots) return -1;
+    pthread_mutex_init(&ws->lock, NULL);
+    ws->region = &ctx->region;
+    ws->nslots = nth;
+    ws->reach = ctx->matcher.max_len - 1;
+    return 0;
+}
+
+static void windows_destroy(window_set_t* ws) {
+    if (!ws->slots) return;
+    for (int i = 0; i < ws->nslots; i++) fs_window_unmap(&ws->slots[i].win);
+    pthread_mutex_destroy(&ws->lock);
+    free(ws->slots);
+    ws->slots = NULL;
+}
+
+// A window holding [from, to) and the reach after it; NULL when none could be mapped
+static window_slot_t* window_acquire(window_set_t* ws, fs_size_t from, fs_size_t to) {
+    fs_size_t size = ws->region->size;
+    fs_size_t need = size - to > ws->reach ? to + ws->reach : size;
+
+    pthread_mutex_lock(&ws->lock);
+    window_slot_t* slot = NULL;
+    for (int i = 0; i < ws->nslots; i++) {
+        window_slot_t* s = &ws->slots[i];
+        if (s->busy) continue;
+        if (s->win.data && s->win.base <= from && s->win.base + s->win.len >= need) {
+            slot = s;
+            break;
+        }
+        if (!slot || !s->win.data) slot = s;
+    }
+    if (slot) slot->busy = 1;
+    pthread_mutex_unlock(&ws->lock);
+    if (!slot) {
+        __atomic_store_n(&ws->failed, 1, __ATOMIC_RELAXED);
+        return NULL;
+    }
+
+    fs_window_t* w = &slot->win;
+    if (!w->data || w->base > from || w->base + w->len < need) {
+        fs_size_t end = from + FS_MMAP_WINDOW > need ? from + FS_MMAP_WINDOW : need;
+        if (fs_window_map(w, ws->region, from, end) != FS_SUCCESS) {
+            __atomic_store_n(&ws->failed, 1, __ATOMIC_RELAXED);
+            pthread_mutex_lock(&ws->lock);
+            slot->busy = 0;
+            pthread_mutex_unlock(&ws->lock);
+            return NULL;
+        }
+    }
+    return slot;
+}
+
+static void window_release(window_set_t* ws, window_slot_t* slot) {
+    pthread_mutex_lock(&ws->lock);
+    slot->busy = 0;
+    pthread_mutex_unlock(&ws->lock);
+}
+
+// Offsets in a buffer that starts at file offset `base` become offsets in the file
+// (a tagged match keeps its id in the high bits)
+static void rebase_slabs(task_data_t* td, fs_size_t base) {
+    for (result_slab_t* s = td->first; s; s = s->next) {
+        for (fs_size_t i = 0; i < s->count; i++) s->items[i] += base;
+    }
+}
+
+// scan_task over a window of a windowed region: positions are rebased to it, the results back to the file
+static void window_task(void* arg) {
+    task_data_t* td = (task_data_t*)arg;
+    window_slot_t* slot = window_acquire(td->windows, td->true_chunk_start, td->chunk_end);
+    if (!slot) return;
+
+    fs_size_t base = slot->win.base;
+    td->global_start = slot->win.data;
+    td->global_size = slot->win.len;
+    td->true_chunk_start -= base;
+    td->chunk_end -= base;
+    td->base = base;
+    scan_task(td);
+    rebase_slabs(td, base);
+    window_release(td->windows, slot);
+}
+
+void fastscan_global_init(void) {
+    fs_cpu_init();
+}
+
+int fastscan_warmup(void) {
+    return fs_pool_start(scan_threads(NULL) - 1);
+}
+
+fs_status_t fastscan_init_pattern(fastscan_ctx_t* ctx, const fastscan_pattern_t* pattern, fs_size_t max_results) {
     if (!ctx || !pattern) return FS_ERROR_NULL_PTR;
-    
+
+    fastscan_global_init();
+
     memset(ctx, 0, sizeof(fastscan_ctx_t));
-    
-    ctx->pattern = pattern;
-    ctx->pattern_len = strlen(pattern);
     ctx->max_matches = max_results;
+    ctx->region.fd = -1;    // Nothing to close until a file is loaded
+
+    ctx->compiled = pattern;
+    ctx->matcher = pattern->matcher;
+    if (pattern->kind == FS_PATTERN_LITERAL) {
+        ctx->pattern = (const char*)pattern->text;
+        ctx->pattern_len = pattern->text_len;
+    }
+
     ctx->is_initialized = 1;
 
     return FS_SUCCESS;
 }
 
+// Storage for a pattern owned by the context; kernels are picked at compile time, so CPU detection runs first
+static fastscan_pattern_t* alloc_owned(void) {
+    fastscan_global_init();
+    return (fastscan_pattern_t*)malloc(sizeof(fastscan_pattern_t));
+}
+
+static fs_status_t adopt_owned(fastscan_ctx_t* ctx, fastscan_pattern_t* owned, fs_status_t status,
+                               fs_size_t max_results) {
+    if (status != FS_SUCCESS) {
+        free(owned);
+        memset(ctx, 0, sizeof(fastscan_ctx_t));
+        return status;
+    }
+    fastscan_init_pattern(ctx, owned, max_results);
+    ctx->owned_pattern = owned;
+    return FS_SUCCESS;
+}
+
+fs_status_t fastscan_init(fastscan_ctx_t* ctx, const char* pattern, fs_size_t max_results) {
+    if (!ctx || !pattern) return FS_ERROR_NULL_PTR;
+
+    fastscan_pattern_t* owned = alloc_owned();
+    if (!owned) return FS_ERROR_OUT_OF_BOUNDS;
+    return adopt_owned(ctx, owned, fastscan_pattern_compile(owned, pattern, strlen(pattern), FS_PATTERN_LITERAL),
+                       max_results);
+}
+
+fs_status_t fastscan_init_multi(fastscan_ctx_t* ctx, const char* const* patterns, const fs_size_t* lens,
+                                fs_size_t count, fs_size_t max_results) {
+    if (!ctx || !patterns || !lens) return FS_ERROR_NULL_PTR;
+
+    fastscan_pattern_t* owned = alloc_owned();
+    if (!owned) return FS_ERROR_OUT_OF_BOUNDS;
+    return adopt_owned(ctx, owned, fastscan_pattern_compile_list(owned, patterns, lens, count), max_results);
+}
+
+fs_status_t fastscan_init_regex(fastscan_ctx_t* ctx, const char* pattern, fs_size_t len, fs_size_t max_results) {
+    if (!ctx || !pattern) return FS_ERROR_NULL_PTR;
+
+    fastscan_pattern_t* owned = alloc_owned();
+    if (!owned) return FS_ERROR_OUT_OF_BOUNDS;
+    return adopt_owned(ctx, owned, fastscan_pattern_compile(owned, pattern, len, FS_PATTERN_REGEX), max_results);
+}
+
+// Tagged matches: split the pattern ids out, leaving plain offsets behind
+static fs_status_t split_match_ids(fastscan_ctx_t* ctx) {
+    if (!ctx->matcher.tagged || ctx->match_count == 0) return FS_SUCCESS;
+
+    ctx->match_ids = (uint32_t*)malloc(ctx->match_count * sizeof(uint32_t));
+    if (!ctx->match_ids) return FS_ERROR_OUT_OF_BOUNDS;
+
+    for (fs_size_t i = 0; i < ctx->match_count; i++) {
+        ctx->match_ids[i] = FS_MATCH_ID(ctx->matches[i]);
+        ctx->matches[i] = FS_MATCH_OFFSET(ctx->matches[i]);
+    }
+    return FS_SUCCESS;
+}
+
+// Matches of literals and pattern lists end within max_len bytes, so a block or a window needs only
+// max_len - 1 bytes past its end. A regex match, or a line in line mode, reaches as far as its line does.
+static int bounded_matches(const fastscan_ctx_t* ctx) {
+    return !ctx->line_mode && ctx->matcher.max_len != (fs_size_t)-1;
+}
+
+// Whole-file scans read through io_uring instead of the mapping: asked for, or (FS_IO_AUTO) a large
+// file that is mostly not cached (as far as this process can tell: otherwise it stays mapped)
+static int use_uring(const fastscan_ctx_t* ctx) {
+    if (!bounded_matches(ctx) || !fs_uring_available()) return 0;
+    if (ctx->io_mode == FS_IO_URING || ctx->io_mode == FS_IO_DIRECT) return 1;
+    return ctx->io_mode == FS_IO_AUTO && ctx->region.size >= FS_URING_MIN_SIZE &&
+           fs_mmap_resident(&ctx->region, URING_RESIDENT_SAMPLES) < 0.5;
+}
+
+// Scans map a window at a time instead of the whole file: asked for, or (FS_IO_AUTO, FS_IO_ONCE) a file
+// large enough for the page tables of a whole mapping to matter
+static int use_windows(const fastscan_ctx_t* ctx) {
+    if (!bounded_matches(ctx)) return 0;
+    if (ctx->io_mode == FS_IO_WINDOW) return 1;
+    return (ctx->io_mode == FS_IO_AUTO || ctx->io_mode == FS_IO_ONCE) && ctx->region.size >= FS_MMAP_WINDOW_MIN_SIZE;
+}
+
 fs_status_t fastscan_load_file(fastscan_ctx_t* ctx, const char* filepath) {
-    if (!ctx) return FS_ERROR_NULL_PTR;
-    return fs_mmap_open(filepath, &ctx->region);
+    if (!ctx || !ctx->is_initialized) return FS_ERROR_NULL_PTR;
+    fs_status_t status = fs_mmap_open(filepath, &ctx->region);
+    if (status != FS_SUCCESS || ctx->region.stream) return status;
+
+    if (use_uring(ctx)) {
+        ctx->region.uring = 1;
+        ctx->region.direct = ctx->io_mode == FS_IO_DIRECT;
+    } else if (use_windows(ctx)) {
+        fs_mmap_windowed(&ctx->region);
+    }
+    if (ctx->io_mode == FS_IO_ONCE) fs_mmap_once(&ctx->region);
+    return FS_SUCCESS;
+}
+
+// A range scanned by the calling thread alone, with what a match starting in it may read past it:
+// the mapping, or for a windowed region a window of its own. *base is the file offset of *data.
+static fs_status_t range_data(const fastscan_ctx_t* ctx, fs_window_t* win, fs_size_t from, fs_size_t to,
+                              const fs_byte_t** data, fs_size_t* size, fs_size_t* base) {
+    *data = ctx->region.data;
+    *size = ctx->region.size;
+    *base = 0;
+    if (!ctx->region.windowed || to == from) return FS_SUCCESS;
+
+    fs_size_t reach = ctx->matcher.max_len - 1;
+    fs_size_t end = ctx->region.size - to > reach ? to + reach : ctx->region.size;
+    fs_status_t status = fs_window_map(win, &ctx->region, from, end);
+    *data = win->data;
+    *size = win->len;
+    *base = win->base;
+    return status;
+}
+
+// Let the file itself decide which pattern bytes are rare (once per context: later ranges reuse the needle)
+static void sample_needle(fastscan_ctx_t* ctx) {
+    if (!ctx->sample_frequencies || !ctx->pattern || ctx->region.size == 0) return;
+    ctx->sample_frequencies = 0;
+
+    // A windowed region is sampled in its first window
+    fs_byte_model_t model;
+    if (ctx->region.windowed) {
+        fs_window_t head = { 0 };
+        if (fs_window_map(&head, &ctx->region, 0, FS_MMAP_WINDOW) != FS_SUCCESS) return;
+        fs_byte_model_learn(&model, head.data, head.len);
+        fs_window_unmap(&head);
+    } else {
+        fs_byte_model_learn(&model, ctx->region.data, ctx->region.size);
+    }
+    fs_needle_destroy(&ctx->needle);
+    if (fs_needle_init(&ctx->needle, (const fs_byte_t*)ctx->pattern, ctx->pattern_len, &model) == FS_SUCCESS)
+        fs_needle_matcher(&ctx->matcher, &ctx->needle);
+}
+
+// Line mode: every task lists its matching lines, then the merge drops the line two tasks
+// share and numbers lines from the newline counts of the tasks before
+static fs_status_t execute_lines(fastscan_ctx_t* ctx) {
+    fs_size_t total_size = ctx->region.size;
+
+    fs_needle_t newline;
+    fs_status_t status = fs_needle_init(&newline, (const fs_byte_t*)"\n", 1, NULL);
+    if (status != FS_SUCCESS) return status;
+
+    int nth = total_size < (256 * 1024) ? 1 : scan_threads(ctx);
+    fs_size_t task_sz = total_size < (256 * 1024) ? total_size : task_size(total_size, nth);
+    fs_size_t ntasks = task_sz ? (total_size + task_sz - 1) / task_sz : 1;
+
+    scan_budget_t budget;
+    scan_progress_t progress = { 0 };
+    task_data_t* tds = (task_data_t*)alloc_tasks(ntasks, sizeof(task_data_t));
+    if (!tds || progress_init(&progress, ctx, ntasks, ctx->max_matches) || budget_init(&budget, ntasks, ctx->max_matches)) {
+        free(progress.tasks);
+        free(tds);
+        fs_needle_destroy(&newline);
+        return FS_ERROR_OUT_OF_BOUNDS;
+    }
+
+    for (fs_size_t i = 0; i < ntasks; i++) {
+        tds[i].matcher = &ctx->matcher;
+        tds[i].global_start = ctx->region.data;
+        tds[i].global_size = total_size;
+        tds[i].paged = &ctx->region;
+        tds[i].newline = &newline;
+        tds[i].budget = &budget;
+        tds[i].index = i;
+        tds[i].cancel = ctx->cancel;
+        tds[i].progress = &progress;
+
+        // One line more than asked for: the first one may turn out to be the previous task's last
+        tds[i].max_collect = 3 * (ctx->max_matches + 1);
+
+        tds[i].true_chunk_start = i * task_sz;
+        tds[i].chunk_end = (i == ntasks - 1) ? total_size : (i + 1) * task_sz;
+    }
+    int* nodes = task_nodes(ctx->region.data, total_size, task_sz, ntasks, nth);
+    run_tasks(scan_task, tds, sizeof(task_data_t), ntasks, nth, nodes);
+    budget_destroy(&budget);
+    free(nodes);
+
+    if (scan_cancelled(ctx->cancel)) {
+        for (fs_size_t i = 0; i < ntasks; i++) free_slabs(&tds[i]);
+        free(progress.tasks);
+        free(tds);
+        fs_needle_destroy(&newline);
+        return FS_ERROR_CANCELLED;
+    }
+
+    fs_size_t total = 0;
+    for (fs_size_t i = 0; i < ntasks; i++) total += task_entries(&tds[i]) / 3;
+
+    fs_size_t final_cnt = total > ctx->max_matches ? ctx->max_matches : total;
+    ctx->matches = (fs_size_t*)malloc((final_cnt ? final_cnt : 1) * sizeof(fs_size_t));
+    ctx->line_ends = (fs_size_t*)malloc((final_cnt ? final_cnt : 1) * sizeof(fs_size_t));
+    ctx->line_numbers = (fs_size_t*)malloc((final_cnt ? final_cnt : 1) * sizeof(fs_size_t));
+
+    ctx->match_count = 0;
+    fs_size_t base = 0;
+    for (fs_size_t i = 0; i < ntasks; i++) {
+        for (result_slab_t* s = tds[i].first; s && ctx->matches && ctx->line_ends && ctx->line_numbers; s = s->next) {
+            for (fs_size_t j = 0; j < s->count && ctx->match_count < final_cnt; j += 3) {
+                fs_size_t start = s->items[j];
+                if (ctx->match_count > 0 && ctx->matches[ctx->match_count - 1] == start) continue;
+
+                ctx->matches[ctx->match_count] = start;
+                ctx->line_ends[ctx->match_count] = s->items[j + 1];
+                ctx->line_numbers[ctx->match_count++] = base + s->items[j + 2] + 1;
+            }
+        }
+        base += tds[i].newlines;
+        free_slabs(&tds[i]);
+    }
+    free(tds);
+
+    fs_needle_destroy(&newline);
+    if (!ctx->matches || !ctx->line_ends || !ctx->line_numbers) {
+        free(progress.tasks);
+        return FS_ERROR_OUT_OF_BOUNDS;
+    }
+    progress_finish(&progress, ctx->match_count);
+    return FS_SUCCESS;
 }
 
+// Tasks are merged in file order, whichever thread ran them: a prefix sum gives each one its place.
+// Frees the tasks and their node list.
+static fs_status_t merge_tasks(fastscan_ctx_t* ctx, task_data_t* tds, fs_size_t ntasks, int nth, int* nodes,
+                               scan_progress_t* progress) {
+    fs_size_t total = 0, holders = 0;
+    result_slab_t* holder = NULL;
+    for (fs_size_t i = 0; i < ntasks; i++) {
+        fs_size_t entries = task_entries(&tds[i]);
+        if (entries && total < ctx->max_matches) {
+            holders++;
+            holder = tds[i].first;
+        }
+        tds[i].out = total;
+        total += entries;
+    }
+    fs_size_t final_cnt = total > ctx->max_matches ? ctx->max_matches : total;
+    fs_size_t to_copy = final_cnt;
+
+    // 1. One slab holds the whole result (typical of sparse patterns): it becomes the result as it is
+    if (holders == 1 && holder->count >= final_cnt) {
+        ctx->matches = holder->items;
+        holder->items = NULL;
+        to_copy = 0;
+    } else {
+        ctx->matches = (fs_size_t*)malloc(final_cnt * sizeof(fs_size_t));
+        if (!ctx->matches) to_copy = 0;
+    }
+
+    // 2. Otherwise every task copies its slabs to its place in parallel; all of them free their slabs
+    for (fs_size_t i = 0; i < ntasks; i++) {
+        tds[i].room = tds[i].out < to_copy ? to_copy - tds[i].out : 0;
+        tds[i].dst = tds[i].room ? ctx->matches + tds[i].out : NULL;
+    }
+    run_tasks(place_task, tds, sizeof(task_data_t), ntasks, nth, nodes);
+    free(nodes);
+    free(tds);
+
+    if (!ctx->matches) {
+        free(progress->tasks);
+        return FS_ERROR_OUT_OF_BOUNDS;
+    }
+    ctx->match_count = final_cnt;
+    progress_finish(progress, final_cnt);
+    return split_match_ids(ctx);
+}
+
+// Result arrays of a stream scan: room for `cap` entries (lines in line mode)
+static int grow_results(fastscan_ctx_t* ctx, fs_size_t cap) {
+    fs_size_t* matches = (fs_size_t*)realloc(ctx->matches, cap * sizeof(fs_size_t));
+    if (!matches) return -1;
+    ctx->matches = matches;
+    if (!ctx->line_mode) return 0;
+
+    fs_size_t* ends = (fs_size_t*)realloc(ctx->line_ends, cap * sizeof(fs_size_t));
+    if (!ends) return -1;
+    ctx->line_ends = ends;
+    fs_size_t* numbers = (fs_size_t*)realloc(ctx->line_numbers, cap * sizeof(fs_size_t));
+    if (!numbers) return -1;
+    ctx->line_numbers = numbers;
+    return 0;
+}
+
+typedef struct {
+    fastscan_ctx_t* ctx;
+    fs_size_t cap;
+    int failed;
+} stream_results_t;
+
+// Sink of fastscan_execute on a stream: keeps the first max_matches matches (lines), then stops it
+static int collect_stream(void* arg, const fs_size_t* items, fs_size_t count) {
+    stream_results_t* r = (stream_results_t*)arg;
+    fastscan_ctx_t* ctx = r->ctx;
+
+    for (fs_size_t i = 0; i < count && ctx->match_count < ctx->max_matches; i++) {
+        if (ctx->match_count == r->cap) {
+            fs_size_t cap = r->cap * 2 < ctx->max_matches ? r->cap * 2 : ctx->max_matches;
+            if (grow_results(ctx, cap)) {
+                r->failed = 1;
+                return 1;
+            }
+            r->cap = cap;
+        }
+
+        fs_size_t n = ctx->match_count++;
+        if (ctx->line_mode) {
+            ctx->matches[n] = items[3 * i];
+            ctx->line_ends[n] = items[3 * i + 1];
+            ctx->line_numbers[n] = items[3 * i + 2];
+        } else {
+            ctx->matches[n] = items[i];
+        }
+    }
+    return ctx->match_count >= ctx->max_matches;
+}
+
+static fs_status_t execute_stream(fastscan_ctx_t* ctx) {
+    stream_results_t r = { ctx, ctx->max_matches < STREAM_INITIAL_MATCHES ? ctx->max_matches : STREAM_INITIAL_MATCHES, 0 };
+    if (r.cap == 0) r.cap = 1;
+    ctx->match_count = 0;
+
+    fs_status_t status = grow_results(ctx, r.cap) ? FS_ERROR_OUT_OF_BOUNDS : FS_SUCCESS;
+    if (status == FS_SUCCESS) status = fs_stream_scan(ctx, collect_stream, &r, NULL);
+    if (status == FS_SUCCESS && r.failed) status = FS_ERROR_OUT_OF_BOUNDS;
+    if (status == FS_SUCCESS) return ctx->line_mode ? FS_SUCCESS : split_match_ids(ctx);
+
+    free(ctx->matches);
+    free(ctx->line_ends);
+    free(ctx->line_numbers);
+    ctx->matches = ctx->line_ends = ctx->line_numbers = NULL;
+    ctx->match_count = 0;
+    return status;
+}
+
+static fs_status_t execute_uring(fastscan_ctx_t* ctx, int counting);
+
 fs_status_t fastscan_execute(fastscan_ctx_t* ctx) {
+    if (!ctx) return FS_ERROR_NULL_PTR;
+    if (ctx->region.stream) {
+        if (!ctx->is_initialized) return FS_ERROR_NULL_PTR;
+        return scan_cancelled(ctx->cancel) ? FS_ERROR_CANCELLED : execute_stream(ctx);
+    }
+    if (ctx->region.uring && ctx->is_initialized && !ctx->line_mode) {
+        if (scan_cancelled(ctx->cancel)) return FS_ERROR_CANCELLED;
+        fs_status_t status = execute_uring(ctx, 0);
+        if (ctx->region.uring) return status;
+    }
+    return fastscan_execute_range(ctx, 0, ctx->region.size);
+}
+
+fs_status_t fastscan_execute_stream(fastscan_ctx_t* ctx, fs_stream_sink_fn sink, void* arg) {
+    if (!ctx || !ctx->is_initialized || !sink) return FS_ERROR_NULL_PTR;
+    if (!ctx->region.stream) return FS_ERROR_INVALID_ARG;
+    if (scan_cancelled(ctx->cancel)) return FS_ERROR_CANCELLED;
+    return fs_stream_scan(ctx, sink, arg, NULL);
+}
+
+fs_status_t fastscan_execute_range(fastscan_ctx_t* ctx, fs_size_t from, fs_size_t to) {
     if (!ctx || !ctx->is_initialized) return FS_ERROR_NULL_PTR;
+    if (ctx->region.stream || from > to || to > ctx->region.size) return FS_ERROR_INVALID_ARG;
+    if (scan_cancelled(ctx->cancel)) return FS_ERROR_CANCELLED;
     
-    fs_size_t total_size = ctx->region.size;
-    const fs_byte_t* pattern = (const fs_byte_t*)ctx->pattern;
-    const fs_size_t pattern_len = ctx->pattern_len;
+    fs_size_t total_size = to - from;
+    sample_needle(ctx);
+
+    if (ctx->line_mode) {
+        int whole = from == 0 && to == ctx->region.size && !ctx->region.windowed;
+        return whole ? execute_lines(ctx) : FS_ERROR_INVALID_ARG;
+    }
+
+    // Room to finish the position that reaches max_matches; trimmed after the merge
+    const fs_matcher_t* m = &ctx->matcher;
+    const fs_size_t slack = m->max_per_pos - 1;
 
     if (total_size < (256 * 1024)) { 
-        ctx->matches = (fs_size_t*)malloc(sizeof(fs_size_t) * ctx->max_matches);
-        if (!ctx->matches) return FS_ERROR_OUT_OF_BOUNDS;
-        return fs_scan_raw(ctx->region.data, total_size, pattern, pattern_len, ctx->matches, &ctx->match_count, ctx->max_matches);
+        fs_window_t win = { 0 };
+        const fs_byte_t* data;
+        fs_size_t size, base;
+        if (range_data(ctx, &win, from, to, &data, &size, &base) != FS_SUCCESS) return FS_ERROR_MMAP_FAILED;
+
+        ctx->matches = (fs_size_t*)malloc(sizeof(fs_size_t) * (ctx->max_matches + slack));
+        if (!ctx->matches) {
+            fs_window_unmap(&win);
+            return FS_ERROR_OUT_OF_BOUNDS;
+        }
+        ctx->match_count = 0;
+        if (to > from) m->span(m, data, size, from - base, to - base, ctx->matches, &ctx->match_count, ctx->max_matches + slack);
+        fs_window_unmap(&win);
+        if (ctx->match_count > ctx->max_matches) ctx->match_count = ctx->max_matches;
+        for (fs_size_t i = 0; base && i < ctx->match_count; i++) ctx->matches[i] += base;
+        if (ctx->on_progress) {
+            fs_progress_t report = { total_size, total_size, ctx->match_count };
+            ctx->on_progress(ctx->progress_arg, &report);
+        }
+        return split_match_ids(ctx);
     }
 
-    long nproc = sysconf(_SC_NPROCESSORS_ONLN);
-    
-    int nth = nproc > 1 ? (int)nproc - 1 : 1;
-    
-    pthread_t threads[nth];
-    thread_data_t tds[nth];
-    
-    fs_size_t chunk_sz = ctx->region.size / nth;
+    // Many small tasks instead of one chunk per thread: a thread that lands on a dense region
+    // (or loses its core) leaves the rest of its share to the others
+    int nth = scan_threads(ctx);
+    fs_size_t task_sz = task_size(total_size, nth);
+    fs_size_t ntasks = (total_size + task_sz - 1) / task_sz;
+
+    // Tasks after the first max_matches entries are cancelled, so the scan stops early and
+    // holds about max_matches entries plus those of the tasks still running
+    scan_budget_t budget;
+    window_set_t windows;
+    scan_progress_t progress = { 0 };
+    task_data_t* tds = (task_data_t*)alloc_tasks(ntasks, sizeof(task_data_t));
+    if (!tds || progress_init(&progress, ctx, ntasks, ctx->max_matches) || windows_init(&windows, ctx, nth)) {
+        free(progress.tasks);
+        free(tds);
+        return FS_ERROR_OUT_OF_BOUNDS;
+    }
+    if (budget_init(&budget, ntasks, ctx->max_matches)) {
+        windows_destroy(&windows);
+        free(progress.tasks);
+        free(tds);
+        return FS_ERROR_OUT_OF_BOUNDS;
+    }
     
-    for (int i = 0; i < nth; i++) {
+    for (fs_size_t i = 0; i < ntasks; i++) {
+        tds[i].matcher = m;
         tds[i].global_start = ctx->region.data;
-        tds[i].pattern = (const fs_byte_t*)ctx->pattern;
-        tds[i].pattern_len = ctx->pattern_len;
-        tds[i].matches = NULL;
-        tds[i].count = 0;
-        tds[i].capacity = 0;
+        tds[i].global_size = ctx->region.size;
+        tds[i].paged = &ctx->region;
+        tds[i].windows = ctx->region.windowed ? &windows : NULL;
+        tds[i].budget = &budget;
+        tds[i].index = i;
+        tds[i].cancel = ctx->cancel;
+        tds[i].progress = &progress;
 
-        tds[i].max_collect = ctx->max_matches; 
-        
-        fs_size_t start_off = i * chunk_sz;
-        fs_size_t end_off = (i == nth - 1) ? ctx->region.size : (i + 1) * chunk_sz;
-        
-        tds[i].true_chunk_start = start_off;
-        
-        fs_size_t read_start = (i == 0) ? 0 : (start_off - pattern_len + 1);
-        fs_size_t read_end = (i == nth - 1) ? ctx->region.size : (end_off + pattern_len - 1);
-        
-        if (read_end > ctx->region.size) read_end = ctx->region.size;
+        tds[i].max_collect = ctx->max_matches + slack; 
         
-        tds[i].start = ctx->region.data + read_start;
-        tds[i].size = read_end - read_start;
-        
-        pthread_create(&threads[i], NULL, worker_thread, &tds[i]);
+        tds[i].true_chunk_start = from + i * task_sz;
+        tds[i].chunk_end = (i == ntasks - 1) ? to : from + (i + 1) * task_sz;
     }
-    
-    fs_size_t total = 0;
-    for (int i = 0; i < nth; i++) {
-        pthread_join(threads[i], NULL);
-        total += tds[i].count;
+    int* nodes = ctx->region.windowed ? NULL : task_nodes(ctx->region.data + from, total_size, task_sz, ntasks, nth);
+    run_tasks(ctx->region.windowed ? window_task : scan_task, tds, sizeof(task_data_t), ntasks, nth, nodes);
+    budget_destroy(&budget);
+    windows_destroy(&windows);
+
+    if (scan_cancelled(ctx->cancel) || windows.failed) {
+        for (fs_size_t i = 0; i < ntasks; i++) free_slabs(&tds[i]);
+        free(progress.tasks);
+        free(nodes);
+        free(tds);
+        return windows.failed ? FS_ERROR_MMAP_FAILED : FS_ERROR_CANCELLED;
     }
     
-    fs_size_t final_cnt = total > ctx->max_matches ? ctx->max_matches : total;
-    ctx->matches = (fs_size_t*)malloc(final_cnt * sizeof(fs_size_t));
-    if (!ctx->matches) {
-         for(int i=0; i<nth; i++) free(tds[i].matches);
-         return FS_ERROR_OUT_OF_BOUNDS;
+    return merge_tasks(ctx, tds, ntasks, nth, nodes, &progress);
+}
+
+typedef struct {
+    const fs_matcher_t* matcher;
+    const fs_byte_t* data;
+    fs_size_t size;
+    const fs_region_t* paged;   // As in task_data_t
+    fs_size_t base;
+    struct window_set* windows;
+    fs_size_t from;
+    fs_size_t to;
+    fs_size_t count;
+    const int32_t* cancel;
+    scan_progress_t* progress;
+    fs_size_t index;
+    int failed;
+} __attribute__((aligned(64))) count_data_t;
+
+// Number of matches starting in [cd->from, cd->to): the matcher's count kernel, or its span into a
+// reused buffer. A cancellable or watched count runs the kernel CANCEL_STEP bytes at a time.
+static int count_range(const count_data_t* cd, fs_size_t* total) {
+    const fs_matcher_t* m = cd->matcher;
+    const fs_byte_t* data = cd->data;
+    fs_size_t size = cd->size, from = cd->from, to = cd->to;
+    int stepped = cd->cancel || cd->progress || cd->paged;
+
+    fs_pagein_t pagein;
+    if (m->count) {
+        *total = 0;
+        fs_pagein_begin(&pagein, cd->paged, data, size, cd->base, from, to);
+        while (from < to && !scan_cancelled(cd->cancel)) {
+            fs_pagein_advance(&pagein, from);
+            fs_size_t step = stepped && to - from > CANCEL_STEP ? from + CANCEL_STEP : to;
+            *total += m->count(m, data, size, from, step);
+            from = step;
+            progress_update(cd->progress, cd->index, from - cd->from, *total);
+        }
+        fs_pagein_end(&pagein, from);
+        return 0;
     }
-    
+
+    fs_size_t cap = m->max_per_pos > COUNT_BUFFER ? m->max_per_pos : COUNT_BUFFER;
+    fs_size_t* buf = (fs_size_t*)malloc(cap * sizeof(fs_size_t));
+    if (!buf) return -1;
+
+    *total = 0;
+    fs_pagein_begin(&pagein, cd->paged, data, size, cd->base, from, to);
+    while (from < to && !scan_cancelled(cd->cancel)) {
+        fs_pagein_advance(&pagein, from);
+        fs_size_t n = 0;
+        fs_size_t step = stepped && to - from > CANCEL_STEP ? from + CANCEL_STEP : to;
+        from = m->span(m, data, size, from, step, buf, &n, cap);
+        *total += n;
+        progress_update(cd->progress, cd->index, from - cd->from, *total);
+    }
+    fs_pagein_end(&pagein, from);
+    free(buf);
+    return 0;
+}
+
+static void count_task(void* arg) {
+    count_data_t* cd = (count_data_t*)arg;
+    if (!cd->windows) {
+        cd->failed = count_range(cd, &cd->count);
+        return;
+    }
+
+    // Windowed region: the same count over the task's window
+    window_slot_t* slot = window_acquire(cd->windows, cd->from, cd->to);
+    if (!slot) return;
+    count_data_t in_window = *cd;
+    in_window.data = slot->win.data;
+    in_window.size = slot->win.len;
+    in_window.from -= slot->win.base;
+    in_window.to -= slot->win.base;
+    in_window.base = slot->win.base;
+    cd->failed = count_range(&in_window, &cd->count);
+    window_release(cd->windows, slot);
+}
+
+// A whole-file scan or count over io_uring blocks: nth runners take blocks as their reads complete.
+// Block i is task i of the budget and of the progress report, so results merge as the mapped scan's do.
+typedef struct {
+    fastscan_ctx_t* ctx;
+    fs_uring_t* uring;
+    task_data_t* tds;           // Scan: one per block
+    count_data_t* cd;           // Count: the matcher, cancel and progress shared by every block
+    fs_size_t count;
+    int failed;
+} uring_scan_t;
+
+typedef struct {
+    uring_scan_t* scan;
+} __attribute__((aligned(64))) uring_runner_t;
+
+static void uring_block(uring_scan_t* us, const fs_uring_block_t* b) {
+    fs_size_t base = b->index * FS_URING_BLOCK;
+
+    if (!us->tds) {
+        count_data_t cd = *us->cd;
+        cd.data = b->data;
+        cd.size = b->len;
+        cd.from = 0;
+        cd.to = b->own;
+        cd.index = b->index;
+
+        fs_size_t n = 0;
+        if (count_range(&cd, &n)) __atomic_store_n(&us->failed, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&us->count, n, __ATOMIC_RELAXED);
+        return;
+    }
+
+    task_data_t* td = &us->tds[b->index];
+    td->global_start = b->data;
+    td->global_size = b->len;
+    td->true_chunk_start = 0;
+    td->chunk_end = b->own;
+    scan_task(td);
+
+    rebase_slabs(td, base);
+    fs_uring_limit(us->uring, __atomic_load_n(&td->budget->cutoff, __ATOMIC_ACQUIRE) + 1);
+}
+
+static void uring_task(void* arg) {
+    uring_scan_t* us = ((uring_runner_t*)arg)->scan;
+    fs_uring_block_t b;
+
+    while (fs_uring_next(us->uring, &b)) {
+        if (!scan_cancelled(us->ctx->cancel)) uring_block(us, &b);
+        fs_uring_done(us->uring, &b);
+        if (scan_cancelled(us->ctx->cancel)) fs_uring_stop(us->uring);
+    }
+}
+
+// Clears region.uring when no ring could be set up: the caller scans the mapping instead
+static fs_status_t execute_uring(fastscan_ctx_t* ctx, int counting) {
+    fs_size_t total_size = ctx->region.size;
+    const fs_matcher_t* m = &ctx->matcher;
+    sample_needle(ctx);
+
+    int nth = scan_threads(ctx);
+    fs_size_t nblocks = (total_size + FS_URING_BLOCK - 1) / FS_URING_BLOCK;
+    fs_uring_t* u = fs_uring_start(ctx->region.fd, total_size, m->max_len - 1, 2 * nth, ctx->region.direct);
+    if (!u) {
+        ctx->region.uring = 0;
+        return FS_SUCCESS;
+    }
+
+    scan_budget_t budget;
+    scan_progress_t progress = { 0 };
+    uring_scan_t us = { .ctx = ctx, .uring = u };
+    count_data_t cd = { .matcher = m, .cancel = ctx->cancel };
+    uring_runner_t* runners = (uring_runner_t*)alloc_tasks((fs_size_t)nth, sizeof(uring_runner_t));
+    int failed = !runners || progress_init(&progress, ctx, nblocks, counting ? 0 : ctx->max_matches);
+    if (!counting && !failed) {
+        us.tds = (task_data_t*)alloc_tasks(nblocks, sizeof(task_data_t));
+        failed = !us.tds || budget_init(&budget, nblocks, ctx->max_matches);
+        if (failed) {
+            free(us.tds);
+            us.tds = NULL;
+        }
+    }
+    if (failed) {
+        fs_uring_finish(u);
+        free(progress.tasks);
+        free(runners);
+        return FS_ERROR_OUT_OF_BOUNDS;
+    }
+
+    if (counting) {
+        cd.progress = progress.tasks ? &progress : NULL;
+        us.cd = &cd;
+    }
+    for (fs_size_t i = 0; us.tds && i < nblocks; i++) {
+        us.tds[i].matcher = m;
+        us.tds[i].budget = &budget;
+        us.tds[i].index = i;
+        us.tds[i].cancel = ctx->cancel;
+        us.tds[i].progress = &progress;
+        us.tds[i].max_collect = ctx->max_matches + m->max_per_pos - 1;
+    }
+    for (int i = 0; i < nth; i++) runners[i].scan = &us;
+
+    run_tasks(uring_task, runners, sizeof(uring_runner_t), (fs_size_t)nth, nth, NULL);
+    free(runners);
+    if (us.tds) budget_destroy(&budget);
+
+    fs_status_t status = fs_uring_finish(u);
+    if (status == FS_SUCCESS && scan_cancelled(ctx->cancel)) status = FS_ERROR_CANCELLED;
+    if (status == FS_SUCCESS && us.failed) status = FS_ERROR_OUT_OF_BOUNDS;
+    if (status != FS_SUCCESS) {
+        for (fs_size_t i = 0; us.tds && i < nblocks; i++) free_slabs(&us.tds[i]);
+        free(us.tds);
+        free(progress.tasks);
+        return status;
+    }
+
+    if (counting) {
+        ctx->match_count = us.count;
+        progress_finish(&progress, us.count);
+        return FS_SUCCESS;
+    }
+    return merge_tasks(ctx, us.tds, nblocks, nth, NULL, &progress);
+}
+
+fs_status_t fastscan_count(fastscan_ctx_t* ctx) {
+    if (!ctx || !ctx->is_initialized) return FS_ERROR_NULL_PTR;
+    if (scan_cancelled(ctx->cancel)) return FS_ERROR_CANCELLED;
+
+    if (ctx->region.stream) {
+        fs_status_t status = fs_stream_scan(ctx, NULL, NULL, &ctx->match_count);
+        if (status != FS_SUCCESS) ctx->match_count = 0;
+        return status;
+    }
+
     ctx->match_count = 0;
-    for (int i = 0; i < nth; i++) {
-        for (fs_size_t j = 0; j < tds[i].count; j++) {
-            if (ctx->match_count >= final_cnt) break;
-            ctx->matches[ctx->match_count++] = tds[i].matches[j];
+    if (ctx->region.uring) {
+        fs_status_t status = execute_uring(ctx, 1);
+        if (ctx->region.uring) return status;
+    }
+
+    fs_size_t total_size = ctx->region.size;
+    sample_needle(ctx);
+
+    const fs_matcher_t* m = &ctx->matcher;
+
+    if (total_size < (256 * 1024)) {
+        fs_window_t win = { 0 };
+        fs_size_t base;     // 0: the range starts at the start of the file
+        count_data_t whole = { .matcher = m, .to = total_size };
+        if (range_data(ctx, &win, 0, total_size, &whole.data, &whole.size, &base) != FS_SUCCESS) return FS_ERROR_MMAP_FAILED;
+        int failed = count_range(&whole, &ctx->match_count);
+        fs_window_unmap(&win);
+        if (failed) return FS_ERROR_OUT_OF_BOUNDS;
+        if (ctx->on_progress) {
+            fs_progress_t report = { total_size, total_size, ctx->match_count };
+            ctx->on_progress(ctx->progress_arg, &report);
         }
-        free(tds[i].matches);
+        return FS_SUCCESS;
     }
-    
+
+    int nth = scan_threads(ctx);
+    fs_size_t task_sz = task_size(total_size, nth);
+    fs_size_t ntasks = (total_size + task_sz - 1) / task_sz;
+
+    window_set_t windows;
+    scan_progress_t progress = { 0 };
+    count_data_t* cds = (count_data_t*)alloc_tasks(ntasks, sizeof(count_data_t));
+    if (!cds || progress_init(&progress, ctx, ntasks, 0) || windows_init(&windows, ctx, nth)) {
+        free(progress.tasks);
+        free(cds);
+        return FS_ERROR_OUT_OF_BOUNDS;
+    }
+
+    for (fs_size_t i = 0; i < ntasks; i++) {
+        cds[i].matcher = m;
+        cds[i].data = ctx->region.data;
+        cds[i].size = total_size;
+        cds[i].paged = &ctx->region;
+        cds[i].windows = ctx->region.windowed ? &windows : NULL;
+        cds[i].from = i * task_sz;
+        cds[i].to = (i == ntasks - 1) ? total_size : (i + 1) * task_sz;
+        cds[i].cancel = ctx->cancel;
+        cds[i].progress = progress.tasks ? &progress : NULL;
+        cds[i].index = i;
+    }
+    int* nodes = ctx->region.windowed ? NULL : task_nodes(ctx->region.data, total_size, task_sz, ntasks, nth);
+    run_tasks(count_task, cds, sizeof(count_data_t), ntasks, nth, nodes);
+    free(nodes);
+    windows_destroy(&windows);
+
+    int failed = 0;
+    for (fs_size_t i = 0; i < ntasks; i++) {
+        ctx->match_count += cds[i].count;
+        failed |= cds[i].failed;
+    }
+    free(cds);
+
+    if (scan_cancelled(ctx->cancel) || failed || windows.failed) {
+        free(progress.tasks);
+        ctx->match_count = 0;
+        if (windows.failed) return FS_ERROR_MMAP_FAILED;
+        return failed ? FS_ERROR_OUT_OF_BOUNDS : FS_ERROR_CANCELLED;
+    }
+    progress_finish(&progress, ctx->match_count);
     return FS_SUCCESS;
 }
 
 void fastscan_destroy(fastscan_ctx_t* ctx) {
     if (!ctx) return;
 
-    fs_mmap_close(&ctx->region);
+    // A context whose init failed never had a file (and its fd is not -1 but 0)
+    if (ctx->is_initialized) fs_mmap_close(&ctx->region);
+    fs_needle_destroy(&ctx->needle);
 
     if (ctx->matches) {
         free(ctx->matches);
         ctx->matches = NULL;
     }
 
+    free(ctx->match_ids);
+    ctx->match_ids = NULL;
+    free(ctx->line_ends);
+    ctx->line_ends = NULL;
+    free(ctx->line_numbers);
+    ctx->line_numbers = NULL;
+
+    if (ctx->owned_pattern) {
+        fastscan_pattern_destroy(ctx->owned_pattern);
+        free(ctx->owned_pattern);
+        ctx->owned_pattern = NULL;
+    }
+    ctx->compiled = NULL;
+
     ctx->match_count = 0;
     ctx->is_initialized = 0;
 }
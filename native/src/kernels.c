@@ -0,0 +1,60 @@
+#include "kernels.h"
+#include <string.h>
+#include "config.h"
+
+fs_len_class_t fs_len_class(fs_size_t len) {
+    if (len <= 4) return (fs_len_class_t)(FS_LEN_1 + (len - 1));
+    if (len <= 8) return FS_LEN_5_8;
+    if (len <= 16) return FS_LEN_9_16;
+    return FS_LEN_LONG;
+}
+
+fs_kernel_fn fs_kernel_select(fs_isa_t isa, fs_len_class_t len_class) {
+    switch (isa) {
+        case FS_ISA_AVX512BW: return fs_kernels_avx512[len_class];
+        case FS_ISA_AVX2:     return fs_kernels_avx2[len_class];
+        default:              return fs_kernels_sse2[len_class];
+    }
+}
+
+fs_count_kernel_fn fs_counter_select(fs_isa_t isa, fs_len_class_t len_class) {
+    switch (isa) {
+        case FS_ISA_AVX512BW: return fs_counters_avx512[len_class];
+        case FS_ISA_AVX2:     return fs_counters_avx2[len_class];
+        default:              return fs_counters_sse2[len_class];
+    }
+}
+
+fs_status_t fs_needle_init(fs_needle_t* n, const fs_byte_t* pattern, fs_size_t len, const fs_byte_model_t* model) {
+    if (!n || !pattern) return FS_ERROR_NULL_PTR;
+    if (len == 0 || len > FS_MAX_PATTERN_LEN) return FS_ERROR_INVALID_ARG;
+
+    memset(n, 0, sizeof(fs_needle_t));
+    n->bytes = pattern;
+    n->len = len;
+    n->len_class = fs_len_class(len);
+    n->rare = fs_pick_rare_pair(pattern, len, model);
+
+    // Verify words: the 5..8 class compares 4-byte words, 9+ compares 8-byte words
+    fs_size_t word = n->len_class == FS_LEN_5_8 ? 4 : 8;
+    fs_size_t head_len = len < word ? len : word;
+    memcpy(&n->head, pattern, head_len);
+    if (len >= word) memcpy(&n->tail, pattern + len - word, word);
+
+    n->scan = fs_kernel_select(fs_cpu_isa(), n->len_class);
+    n->fallback = n->scan;
+    n->count = fs_counter_select(fs_cpu_isa(), n->len_class);
+
+    // Long needles: reading only sampled grams beats even the widest prefilter
+    if (len >= FS_SKIP_MIN_LEN && fs_skip_table_init(n)) {
+        n->scan = fs_skip_scan;
+        n->count = NULL;
+    }
+
+    return FS_SUCCESS;
+}
+
+void fs_needle_destroy(fs_needle_t* n) {
+    if (!n) return;
+    fs_skip_table_free(n);
+}
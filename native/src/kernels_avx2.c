@@ -0,0 +1,5 @@
+// 32-byte instantiation of the literal scan kernels
+#define FS_SIMD_TARGET "avx2,popcnt"
+#define FS_SIMD_WIDTH 32
+#define FS_SIMD_SUFFIX avx2
+#include "kernels_impl.h"
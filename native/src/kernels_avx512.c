@@ -0,0 +1,5 @@
+// 64-byte instantiation of the literal scan kernels
+#define FS_SIMD_TARGET "avx512f,avx512bw,popcnt"
+#define FS_SIMD_WIDTH 64
+#define FS_SIMD_SUFFIX avx512
+#include "kernels_impl.h"
@@ -0,0 +1,188 @@
+/*
+ * Literal scan kernel template.
+ *
+ * Included once per instruction set by kernels_sse2.c / kernels_avx2.c /
+ * kernels_avx512.c, each of which defines FS_SIMD_TARGET, FS_SIMD_WIDTH (16,
+ * 32 or 64) and FS_SIMD_SUFFIX and compiles it for that target (simd_target.h). Every ISA walks
+ * the data in 64-byte blocks (4x16, 2x32 or 1x64 compares per rare byte), so
+ * one 64-bit candidate mask comes out of each iteration.
+ *
+ * The body is written once (scan_block_loop) and specialised per pattern
+ * length class through the constant `cls` argument; the compiler folds the
+ * verify switch away in every instantiation. The constant `counting` argument
+ * turns the same loop into a count-only kernel that never writes offsets.
+ */
+#include <string.h>
+#include <immintrin.h>
+#include "kernels.h"
+#include "simd_target.h"
+
+FS_SIMD_TARGET_BEGIN
+
+#define unlikely(x) __builtin_expect(!!(x), 0)
+#define likely(x)   __builtin_expect(!!(x), 1)
+
+#define FS_BLOCK 64
+#define PREFETCH_DIST 320
+
+#define FS_CAT_(a, b) a##_##b
+#define FS_CAT(a, b)  FS_CAT_(a, b)
+#define FS_SIMD_NAME(name) FS_CAT(name, FS_SIMD_SUFFIX)
+
+// 64-byte candidate mask: bit i set when p[i] == b
+#if FS_SIMD_WIDTH == 64
+typedef __m512i vec_t;
+static inline vec_t vec_set1(fs_byte_t b) { return _mm512_set1_epi8((char)b); }
+static inline uint64_t block_eq_mask(const fs_byte_t* p, vec_t v) {
+    return (uint64_t)_mm512_cmpeq_epi8_mask(_mm512_loadu_si512((const void*)p), v);
+}
+#elif FS_SIMD_WIDTH == 32
+typedef __m256i vec_t;
+static inline vec_t vec_set1(fs_byte_t b) { return _mm256_set1_epi8((char)b); }
+static inline uint64_t block_eq_mask(const fs_byte_t* p, vec_t v) {
+    uint32_t lo = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)p), v));
+    uint32_t hi = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(p + 32)), v));
+    return (uint64_t)lo | ((uint64_t)hi << 32);
+}
+#else
+typedef __m128i vec_t;
+static inline vec_t vec_set1(fs_byte_t b) { return _mm_set1_epi8((char)b); }
+static inline uint64_t block_eq_mask(const fs_byte_t* p, vec_t v) {
+    uint64_t m0 = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)p), v));
+    uint64_t m1 = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(p + 16)), v));
+    uint64_t m2 = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(p + 32)), v));
+    uint64_t m3 = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(p + 48)), v));
+    return m0 | (m1 << 16) | (m2 << 32) | (m3 << 48);
+}
+#endif
+
+static inline uint16_t load16(const fs_byte_t* p) { uint16_t v; memcpy(&v, p, 2); return v; }
+static inline uint32_t load32(const fs_byte_t* p) { uint32_t v; memcpy(&v, p, 4); return v; }
+static inline uint64_t load64(const fs_byte_t* p) { uint64_t v; memcpy(&v, p, 8); return v; }
+
+// Full match check for a candidate; reads stay inside [c, c + len)
+static inline __attribute__((always_inline)) int verify(const fs_needle_t* n, const fs_byte_t* c, const fs_len_class_t cls) {
+    switch (cls) {
+        case FS_LEN_1:
+        case FS_LEN_2:
+            return 1; // The rare pair already covers every byte
+        case FS_LEN_3:
+            return load16(c) == (uint16_t)n->head && c[2] == (fs_byte_t)(n->head >> 16);
+        case FS_LEN_4:
+            return load32(c) == (uint32_t)n->head;
+        case FS_LEN_5_8:
+            return load32(c) == (uint32_t)n->head && load32(c + n->len - 4) == (uint32_t)n->tail;
+        case FS_LEN_9_16:
+            return load64(c) == n->head && load64(c + n->len - 8) == n->tail;
+        default:
+            return load64(c) == n->head && load64(c + n->len - 8) == n->tail &&
+                   memcmp(c + 8, n->bytes + 8, n->len - 16) == 0;
+    }
+}
+
+static inline __attribute__((always_inline)) const fs_byte_t* scan_block_loop(
+        const fs_needle_t* n, const fs_byte_t* p, const fs_byte_t* limit, const fs_byte_t* end,
+        const fs_byte_t* base, fs_size_t* out, fs_size_t* count, fs_size_t cap, const fs_len_class_t cls,
+        const int counting) {
+
+    const fs_size_t r1 = n->rare.first;
+    const fs_size_t r2 = n->rare.second;
+    const fs_byte_t b1 = n->bytes[r1];
+    const fs_byte_t b2 = n->bytes[r2];
+    const int pair = cls != FS_LEN_1;
+
+    const vec_t v1 = vec_set1(b1);
+    const vec_t v2 = vec_set1(b2);
+    const fs_size_t reach = (r1 > r2 ? r1 : r2) + FS_BLOCK;
+
+    // 1. 64-byte blocks while both shifted loads stay below `end`
+    while (p < limit && (fs_size_t)(end - p) >= reach) {
+        __builtin_prefetch(p + PREFETCH_DIST, 0, 3);
+
+        uint64_t mask = block_eq_mask(p + r1, v1);
+        if (pair) mask &= block_eq_mask(p + r2, v2);
+
+        // Drop lanes past the caller's range (last block only)
+        fs_size_t span = (fs_size_t)(limit - p);
+        if (unlikely(span < FS_BLOCK)) mask &= (1ULL << span) - 1;
+
+        if (counting && cls <= FS_LEN_2) {
+            // The compared bytes are the whole pattern: every candidate is a match
+            *count += (fs_size_t)__builtin_popcountll(mask);
+            mask = 0;
+        }
+
+        while (mask != 0) {
+            const fs_byte_t* candidate = p + __builtin_ctzll(mask);
+
+            if (verify(n, candidate, cls)) {
+                if (counting) {
+                    (*count)++;
+                } else {
+                    if (unlikely(*count >= cap)) return candidate;
+                    out[(*count)++] = (fs_size_t)(candidate - base);
+                }
+            }
+            mask &= mask - 1;
+        }
+
+        p += FS_BLOCK;
+    }
+
+    // 2. Scalar tail (only the last few bytes before `end`)
+    for (; p < limit; p++) {
+        if (p[r1] == b1 && p[r2] == b2 && verify(n, p, cls)) {
+            if (counting) {
+                (*count)++;
+                continue;
+            }
+            if (unlikely(*count >= cap)) return p;
+            out[(*count)++] = (fs_size_t)(p - base);
+        }
+    }
+
+    return limit;
+}
+
+#define FS_DEFINE_KERNEL(tag, cls) \
+    static const fs_byte_t* FS_SIMD_NAME(kernel_##tag)(const fs_needle_t* n, const fs_byte_t* p, \
+            const fs_byte_t* limit, const fs_byte_t* end, const fs_byte_t* base, \
+            fs_size_t* out, fs_size_t* count, fs_size_t cap) { \
+        return scan_block_loop(n, p, limit, end, base, out, count, cap, cls, 0); \
+    } \
+    static fs_size_t FS_SIMD_NAME(counter_##tag)(const fs_needle_t* n, const fs_byte_t* p, \
+            const fs_byte_t* limit, const fs_byte_t* end) { \
+        fs_size_t count = 0; \
+        scan_block_loop(n, p, limit, end, p, NULL, &count, 0, cls, 1); \
+        return count; \
+    }
+
+FS_DEFINE_KERNEL(len1, FS_LEN_1)
+FS_DEFINE_KERNEL(len2, FS_LEN_2)
+FS_DEFINE_KERNEL(len3, FS_LEN_3)
+FS_DEFINE_KERNEL(len4, FS_LEN_4)
+FS_DEFINE_KERNEL(len5_8, FS_LEN_5_8)
+FS_DEFINE_KERNEL(len9_16, FS_LEN_9_16)
+FS_DEFINE_KERNEL(long, FS_LEN_LONG)
+
+const fs_kernel_fn FS_SIMD_NAME(fs_kernels)[FS_LEN_CLASSES] = {
+    FS_SIMD_NAME(kernel_len1),
+    FS_SIMD_NAME(kernel_len2),
+    FS_SIMD_NAME(kernel_len3),
+    FS_SIMD_NAME(kernel_len4),
+    FS_SIMD_NAME(kernel_len5_8),
+    FS_SIMD_NAME(kernel_len9_16),
+    FS_SIMD_NAME(kernel_long),
+};
+
+const fs_count_kernel_fn FS_SIMD_NAME(fs_counters)[FS_LEN_CLASSES] = {
+    FS_SIMD_NAME(counter_len1),
+    FS_SIMD_NAME(counter_len2),
+    FS_SIMD_NAME(counter_len3),
+    FS_SIMD_NAME(counter_len4),
+    FS_SIMD_NAME(counter_len5_8),
+    FS_SIMD_NAME(counter_len9_16),
+    FS_SIMD_NAME(counter_long),
+};
+
+FS_SIMD_TARGET_END
@@ -0,0 +1,5 @@
+// 16-byte instantiation of the literal scan kernels
+#define FS_SIMD_TARGET "sse2"
+#define FS_SIMD_WIDTH 16
+#define FS_SIMD_SUFFIX sse2
+#include "kernels_impl.h"
@@ -0,0 +1,28 @@
+/*
+ * Line bounds around a position, shared by the line-mode scan (fastscan.c),
+ * the regex matcher (regex_dfa.c) and the stream reader (stream_reader.c).
+ */
+#ifndef FASTSCAN_LINES_IMPL_H
+#define FASTSCAN_LINES_IMPL_H
+
+#include <string.h>
+#include "safe_types.h"
+
+// Offset of the newline ending the line that holds p, or data_len when it is the last line
+static inline fs_size_t fs_line_end(const fs_byte_t* data, fs_size_t data_len, fs_size_t p) {
+    const fs_byte_t* nl = (const fs_byte_t*)memchr(data + p, '\n', data_len - p);
+    return nl ? (fs_size_t)(nl - data) : data_len;
+}
+
+// Start of the line holding p; no line starts before `floor`
+static inline fs_size_t fs_line_start(const fs_byte_t* data, fs_size_t floor, fs_size_t p) {
+#ifdef __GLIBC__
+    const fs_byte_t* nl = (const fs_byte_t*)memrchr(data + floor, '\n', p - floor);
+    return nl ? (fs_size_t)(nl - data) + 1 : floor;
+#else
+    while (p > floor && data[p - 1] != '\n') p--;
+    return p;
+#endif
+}
+
+#endif // FASTSCAN_LINES_IMPL_H
@@ -29,49 +29,250 @@ fs_status_t fs_mmap_open(const char* filepath, fs_region_t* region) {
 
     fs_size_t size = (fs_size_t)st.st_size;
 
-    if (size == 0) {
+    // Pipes, FIFOs, sockets and devices have no size to map; /proc and sysfs files report 0
+    // and are generated as they are read. All of them are read block by block instead.
+    region->stream = 0;
+    region->windowed = 0;
+    region->uring = 0;
+    region->direct = 0;
+    region->once = 0;
+    region->evict = 0;
+    if (!S_ISREG(st.st_mode) || size == 0) {
         region->data = NULL;
         region->size = 0;
         region->fd = fd; 
+        region->stream = 1;
         return FS_SUCCESS;
     }
 
-    // 2. Aggressive mmap flags
-    int flags = MAP_PRIVATE;
+    // 2. Mapped lazily: each scan thread pages in the part it is about to scan (fs_pagein_t)
+    void* map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    
+    // No mapping (a filesystem without mmap support, no address space left): read it instead
+    if (map == MAP_FAILED) {
+        region->data = NULL;
+        region->size = 0;
+        region->fd = fd;
+        region->stream = 1;
+        return FS_SUCCESS;
+    }
 
 #ifdef __linux__
-    // MAP_POPULATE: Pre-fault pages. 
-    // Kernel loads file into RAM immediately during mmap.
-    // Eliminates page faults during scanning loop.
-    flags |= MAP_POPULATE;
+    madvise(map, size, MADV_HUGEPAGE);
 #endif
 
-    void* map = mmap(NULL, size, PROT_READ, flags, fd, 0);
-    
-    if (map == MAP_FAILED) {
-        close(fd);
-        return FS_ERROR_MMAP_FAILED;
+    region->data = (const fs_byte_t*)map;
+    region->size = size;
+    region->fd = fd;
+
+    return FS_SUCCESS;
+}
+
+// mincore reports the page cache of a file mapping only to its owner or a process that could write it;
+// anyone else is told which pages it has mapped itself
+static int cache_visible(int fd) {
+    struct stat st;
+    if (fstat(fd, &st) != 0) return 0;
+    if (geteuid() == 0 || st.st_uid == geteuid()) return 1;
+
+    char path[32];
+    snprintf(path, sizeof(path), "/proc/self/fd/%d", fd);
+    return faccessat(AT_FDCWD, path, W_OK, AT_EACCESS) == 0;
+}
+
+void fs_mmap_once(fs_region_t* region) {
+    if (!region || region->stream) return;
+    region->once = 1;
+    region->evict = cache_visible(region->fd);
+
+#ifdef __linux__
+    // Pages come in only as fs_pagein_t asks: no fault read-around before or past the cursor, and
+    // no huge folios, which would outlive an eviction that covers only part of them
+    if (region->data) {
+        madvise((void*)region->data, region->size, MADV_NOHUGEPAGE);
+        madvise((void*)region->data, region->size, MADV_RANDOM);
     }
+#endif
+}
 
+void fs_mmap_windowed(fs_region_t* region) {
+    if (!region || !region->data) return;
+    munmap((void*)region->data, region->size);
+    region->data = NULL;
+    region->windowed = 1;
+}
+
+fs_status_t fs_window_map(fs_window_t* w, const fs_region_t* region, fs_size_t from, fs_size_t to) {
+    fs_window_unmap(w);
+    if (to > region->size) to = region->size;
+    fs_size_t base = from / FS_MMAP_WINDOW_ALIGN * FS_MMAP_WINDOW_ALIGN;
+    if (to <= base) return FS_SUCCESS;
 
+    void* map = mmap(NULL, to - base, PROT_READ, MAP_PRIVATE, region->fd, (off_t)base);
+    if (map == MAP_FAILED) return FS_ERROR_MMAP_FAILED;
 #ifdef __linux__
-    
-    madvise(map, size, MADV_SEQUENTIAL | MADV_WILLNEED);
-    
+    if (region->once) {
+        madvise(map, to - base, MADV_NOHUGEPAGE);
+        madvise(map, to - base, MADV_RANDOM);
+    }
+#endif
+    w->data = (const fs_byte_t*)map;
+    w->base = base;
+    w->len = to - base;
+    return FS_SUCCESS;
+}
 
-    madvise(map, size, MADV_HUGEPAGE);
+void fs_window_unmap(fs_window_t* w) {
+    if (w->data) munmap((void*)w->data, w->len);
+    w->data = NULL;
+    w->base = w->len = 0;
+}
 
-    
-    if (size > 0) {
-        readahead(fd, 0, size);
+static fs_size_t page_down(fs_size_t at) {
+    return at / FS_MEMORY_ALIGNMENT * FS_MEMORY_ALIGNMENT;
+}
+
+static fs_size_t page_up(fs_size_t at) {
+    return (at + FS_MEMORY_ALIGNMENT - 1) / FS_MEMORY_ALIGNMENT * FS_MEMORY_ALIGNMENT;
+}
+
+void fs_pagein_begin(fs_pagein_t* p, const fs_region_t* region, const fs_byte_t* data, fs_size_t size,
+                     fs_size_t base, fs_size_t from, fs_size_t to) {
+    p->data = region && size > 0 ? data : NULL;
+    p->size = size;
+    p->limit = page_up(size);
+    if (region && region->once && to < size) p->limit = page_up(to);
+
+    // A page shared with the range before belongs to the cursor that scans it first
+    p->dropped = page_up(from);
+    p->populated = page_down(from);
+    p->advised = p->populated;
+
+#ifdef __linux__
+    p->fd = region && region->evict ? region->fd : -1;
+    p->base = base;
+    p->recorded = p->seen = p->populated;
+#else
+    (void)base;
+#endif
+}
+
+#ifdef __linux__
+// Notes which pages up to `to` are cached before the cursor reads them in
+static void pagein_record(fs_pagein_t* p, fs_size_t to) {
+    if (p->fd == -1 || to <= p->seen) return;
+
+    unsigned char vec[256];
+    while (p->seen < to) {
+        fs_size_t len = to - p->seen < sizeof(vec) * FS_MEMORY_ALIGNMENT ? to - p->seen : sizeof(vec) * FS_MEMORY_ALIGNMENT;
+        fs_size_t pages = (len + FS_MEMORY_ALIGNMENT - 1) / FS_MEMORY_ALIGNMENT;
+
+        // Unknown counts as cached: only pages known to be new are evicted
+        if (mincore((void*)(p->data + p->seen), len, vec) != 0) memset(vec, 1, pages);
+        for (fs_size_t i = 0; i < pages; i++) {
+            p->cached[(p->seen / FS_MEMORY_ALIGNMENT + i) % FS_PAGEIN_PAGES] = vec[i] & 1;
+        }
+        p->seen += pages * FS_MEMORY_ALIGNMENT;
+    }
+
+    // The ring keeps the last FS_PAGEIN_PAGES pages
+    if (p->seen - p->recorded > (fs_size_t)FS_PAGEIN_PAGES * FS_MEMORY_ALIGNMENT)
+        p->recorded = p->seen - (fs_size_t)FS_PAGEIN_PAGES * FS_MEMORY_ALIGNMENT;
+}
+
+// [from, to) was just unmapped: its pages that were not cached before the scan leave the page cache
+static void pagein_evict(fs_pagein_t* p, fs_size_t from, fs_size_t to) {
+    if (p->fd == -1) return;
+    if (from < p->recorded) from = p->recorded;
+    if (to > p->seen) to = p->seen;
+
+    fs_size_t run = to;
+    for (fs_size_t at = from; at < to; at += FS_MEMORY_ALIGNMENT) {
+        if (!p->cached[(at / FS_MEMORY_ALIGNMENT) % FS_PAGEIN_PAGES]) {
+            if (run == to) run = at;
+            continue;
+        }
+        if (run < at) posix_fadvise(p->fd, (off_t)(p->base + run), (off_t)(at - run), POSIX_FADV_DONTNEED);
+        run = to;
     }
+    if (run < to) posix_fadvise(p->fd, (off_t)(p->base + run), (off_t)(to - run), POSIX_FADV_DONTNEED);
+    p->recorded = to > p->recorded ? to : p->recorded;
+}
 #endif
 
-    region->data = (const fs_byte_t*)map;
-    region->size = size;
-    region->fd = fd;
+void fs_pagein_advance(fs_pagein_t* p, fs_size_t pos) {
+    const fs_byte_t* data = p->data;
+    if (!data) return;
 
-    return FS_SUCCESS;
+#ifdef __linux__
+    fs_size_t limit = p->limit;
+
+    // 1. Reads ahead, started before the cursor waits on the step in front of it
+    fs_size_t ahead = pos + FS_PAGEIN_AHEAD < limit ? page_up(pos + FS_PAGEIN_AHEAD) : limit;
+    if (ahead > p->advised && (ahead - p->advised >= FS_PAGEIN_STEP || ahead == limit)) {
+        fs_size_t start = p->advised > p->populated ? p->advised : p->populated;
+        pagein_record(p, ahead);
+        if (ahead > start) madvise((void*)(data + start), ahead - start, MADV_WILLNEED);
+        p->advised = ahead;
+    }
+
+    // 2. The next step mapped in one call: no page faults while it is scanned
+    if (pos + FS_PAGEIN_STEP > p->populated && p->populated < limit) {
+        fs_size_t from = p->populated > page_down(pos) ? p->populated : page_down(pos);
+        fs_size_t to = pos + 2 * FS_PAGEIN_STEP < limit ? page_up(pos + 2 * FS_PAGEIN_STEP) : limit;
+        pagein_record(p, to);
+#ifdef MADV_POPULATE_READ
+        if (to > from) madvise((void*)(data + from), to - from, MADV_POPULATE_READ);
+#endif
+        p->populated = to;
+    }
+
+    // 3. Pages the cursor has passed
+    if (pos > p->dropped && pos - p->dropped >= FS_PAGEIN_DROP) {
+        fs_size_t to = page_down(pos);
+        madvise((void*)(data + p->dropped), to - p->dropped, MADV_DONTNEED);
+        pagein_evict(p, p->dropped, to);
+        p->dropped = to;
+    }
+#else
+    (void)pos;
+#endif
+}
+
+void fs_pagein_end(fs_pagein_t* p, fs_size_t to) {
+    if (!p->data) return;
+
+#ifdef __linux__
+    // The last page may hold the next range's first bytes
+    fs_size_t end = to < p->size ? page_down(to) : page_up(p->size);
+    if (end > p->dropped) {
+        madvise((void*)(p->data + p->dropped), end - p->dropped, MADV_DONTNEED);
+        pagein_evict(p, p->dropped, end);
+    }
+    p->dropped = end;
+#else
+    (void)to;
+#endif
+    p->data = NULL;
+}
+
+double fs_mmap_resident(const fs_region_t* region, int samples) {
+    if (!region || !region->data || region->size == 0 || samples <= 0) return 1.0;
+
+    // Not told: a cached file would look cold, so it counts as cached
+    if (!cache_visible(region->fd)) return 1.0;
+
+    long page = sysconf(_SC_PAGESIZE);
+    fs_size_t pages = (region->size + (fs_size_t)page - 1) / (fs_size_t)page;
+    if ((fs_size_t)samples > pages) samples = (int)pages;
+
+    int resident = 0;
+    for (int i = 0; i < samples; i++) {
+        unsigned char vec = 0;
+        fs_size_t at = pages * (fs_size_t)i / (fs_size_t)samples * (fs_size_t)page;
+        if (mincore((void*)(region->data + at), 1, &vec) == 0 && (vec & 1)) resident++;
+    }
+    return (double)resident / samples;
 }
 
 void fs_mmap_close(fs_region_t* region) {
@@ -93,4 +294,10 @@ void fs_mmap_close(fs_region_t* region) {
     }
 
     region->size = 0;
+    region->stream = 0;
+    region->windowed = 0;
+    region->uring = 0;
+    region->direct = 0;
+    region->once = 0;
+    region->evict = 0;
 }
@@ -0,0 +1,5 @@
+// 32-byte instantiation of the multi-literal kernel
+#define FS_SIMD_TARGET "avx2"
+#define FS_SIMD_WIDTH 32
+#define FS_SIMD_SUFFIX avx2
+#include "multi_impl.h"
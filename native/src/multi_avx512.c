@@ -0,0 +1,5 @@
+// 64-byte instantiation of the multi-literal kernel
+#define FS_SIMD_TARGET "avx512f,avx512bw"
+#define FS_SIMD_WIDTH 64
+#define FS_SIMD_SUFFIX avx512
+#include "multi_impl.h"
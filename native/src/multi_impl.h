@@ -0,0 +1,208 @@
+/*
+ * Multi-literal (Teddy-style) kernel template.
+ *
+ * Every input byte is split into nibbles that index two 16-entry tables per
+ * fingerprint position (pshufb); ANDing the results over the first `prefix`
+ * positions leaves, per lane, the set of buckets whose patterns may start
+ * there. Only those buckets' patterns are verified.
+ *
+ * Included by multi_ssse3.c / multi_avx2.c / multi_avx512.c with FS_SIMD_TARGET,
+ * FS_SIMD_WIDTH and FS_SIMD_SUFFIX defined, and by multi_literal.c without them for the shared
+ * verify step and the scalar kernel.
+ */
+#include <string.h>
+#include <immintrin.h>
+#include "multi_literal.h"
+
+#ifdef FS_SIMD_TARGET
+#include "simd_target.h"
+FS_SIMD_TARGET_BEGIN
+#endif
+
+#define unlikely(x) __builtin_expect(!!(x), 0)
+
+#define FS_BLOCK 64
+#define PREFETCH_DIST 320
+
+static inline uint64_t load64(const fs_byte_t* p) { uint64_t v; memcpy(&v, p, 8); return v; }
+
+static inline unsigned fingerprint(const fs_multi_t* m, const fs_byte_t* c, const fs_size_t prefix) {
+    unsigned buckets = 0xff;
+    for (fs_size_t k = 0; k < prefix; k++) buckets &= m->lo[k][c[k] & 15] & m->hi[k][c[k] >> 4];
+    return buckets;
+}
+
+// Verifies the patterns of `buckets` at c and appends every hit in id order.
+// All-or-nothing: returns -1 without writing when they do not all fit.
+static inline int emit_at(const fs_multi_t* m, const fs_byte_t* c, unsigned buckets, const fs_byte_t* end,
+                          const fs_byte_t* base, fs_size_t* out, fs_size_t* count, fs_size_t cap) {
+    uint64_t ids = 0;
+    for (; buckets; buckets &= buckets - 1) ids |= m->bucket_ids[__builtin_ctz(buckets)];
+
+    const fs_size_t room = (fs_size_t)(end - c);
+    const uint64_t word = room >= 8 ? load64(c) : 0;
+    uint64_t found = 0;
+
+    for (; ids; ids &= ids - 1) {
+        const unsigned id = (unsigned)__builtin_ctzll(ids);
+        const fs_size_t len = m->lens[id];
+        if (len > room) continue;
+
+        if (room >= 8) {
+            if ((word & m->head_mask[id]) != m->head[id]) continue;
+            if (len > 8 && memcmp(c + 8, m->bytes[id] + 8, len - 8) != 0) continue;
+        } else if (memcmp(c, m->bytes[id], len) != 0) {
+            continue;
+        }
+        found |= 1ULL << id;
+    }
+
+    if (!found) return 0;
+    if (unlikely(*count + (fs_size_t)__builtin_popcountll(found) > cap)) return -1;
+
+    for (; found; found &= found - 1) {
+        out[(*count)++] = FS_MATCH_PACK(c - base, __builtin_ctzll(found));
+    }
+    return 0;
+}
+
+static inline __attribute__((always_inline)) const fs_byte_t* scan_scalar(
+        const fs_multi_t* m, const fs_byte_t* p, const fs_byte_t* limit, const fs_byte_t* end,
+        const fs_byte_t* base, fs_size_t* out, fs_size_t* count, fs_size_t cap) {
+    const fs_size_t prefix = m->prefix;
+    for (; p < limit; p++) {
+        unsigned buckets = fingerprint(m, p, prefix);
+        if (buckets && emit_at(m, p, buckets, end, base, out, count, cap)) return p;
+    }
+    return limit;
+}
+
+#ifdef FS_SIMD_WIDTH
+
+#define FS_CAT_(a, b) a##_##b
+#define FS_CAT(a, b)  FS_CAT_(a, b)
+#define FS_SIMD_NAME(name) FS_CAT(name, FS_SIMD_SUFFIX)
+
+// Bucket bytes for FS_SIMD_WIDTH positions; tables are broadcast to every 128-bit lane
+#if FS_SIMD_WIDTH == 64
+typedef __m512i tvec_t;
+static inline tvec_t table_load(const uint8_t* t) { return _mm512_broadcast_i32x4(_mm_load_si128((const __m128i*)t)); }
+static inline tvec_t vec_ones(void) { return _mm512_set1_epi8(-1); }
+static inline tvec_t lookup(tvec_t lo_t, tvec_t hi_t, const fs_byte_t* p) {
+    const tvec_t nib = _mm512_set1_epi8(0x0f);
+    tvec_t v = _mm512_loadu_si512((const void*)p);
+    tvec_t lo = _mm512_shuffle_epi8(lo_t, _mm512_and_si512(v, nib));
+    tvec_t hi = _mm512_shuffle_epi8(hi_t, _mm512_and_si512(_mm512_srli_epi16(v, 4), nib));
+    return _mm512_and_si512(lo, hi);
+}
+static inline tvec_t vec_and(tvec_t a, tvec_t b) { return _mm512_and_si512(a, b); }
+static inline uint64_t nonzero_mask(tvec_t v) { return (uint64_t)_mm512_test_epi8_mask(v, v); }
+static inline void vec_store(uint8_t* dst, tvec_t v) { _mm512_store_si512((void*)dst, v); }
+#elif FS_SIMD_WIDTH == 32
+typedef __m256i tvec_t;
+static inline tvec_t table_load(const uint8_t* t) { return _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i*)t)); }
+static inline tvec_t vec_ones(void) { return _mm256_set1_epi8(-1); }
+static inline tvec_t lookup(tvec_t lo_t, tvec_t hi_t, const fs_byte_t* p) {
+    const tvec_t nib = _mm256_set1_epi8(0x0f);
+    tvec_t v = _mm256_loadu_si256((const __m256i*)p);
+    tvec_t lo = _mm256_shuffle_epi8(lo_t, _mm256_and_si256(v, nib));
+    tvec_t hi = _mm256_shuffle_epi8(hi_t, _mm256_and_si256(_mm256_srli_epi16(v, 4), nib));
+    return _mm256_and_si256(lo, hi);
+}
+static inline tvec_t vec_and(tvec_t a, tvec_t b) { return _mm256_and_si256(a, b); }
+static inline uint64_t nonzero_mask(tvec_t v) {
+    return (uint32_t)~_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_setzero_si256()));
+}
+static inline void vec_store(uint8_t* dst, tvec_t v) { _mm256_store_si256((__m256i*)dst, v); }
+#else
+typedef __m128i tvec_t;
+static inline tvec_t table_load(const uint8_t* t) { return _mm_load_si128((const __m128i*)t); }
+static inline tvec_t vec_ones(void) { return _mm_set1_epi8(-1); }
+static inline tvec_t lookup(tvec_t lo_t, tvec_t hi_t, const fs_byte_t* p) {
+    const tvec_t nib = _mm_set1_epi8(0x0f);
+    tvec_t v = _mm_loadu_si128((const __m128i*)p);
+    tvec_t lo = _mm_shuffle_epi8(lo_t, _mm_and_si128(v, nib));
+    tvec_t hi = _mm_shuffle_epi8(hi_t, _mm_and_si128(_mm_srli_epi16(v, 4), nib));
+    return _mm_and_si128(lo, hi);
+}
+static inline tvec_t vec_and(tvec_t a, tvec_t b) { return _mm_and_si128(a, b); }
+static inline uint64_t nonzero_mask(tvec_t v) {
+    return (uint16_t)~_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128()));
+}
+static inline void vec_store(uint8_t* dst, tvec_t v) { _mm_store_si128((__m128i*)dst, v); }
+#endif
+
+#define FS_VECS (FS_BLOCK / FS_SIMD_WIDTH)
+
+static inline __attribute__((always_inline)) const fs_byte_t* scan_teddy(
+        const fs_multi_t* m, const fs_byte_t* p, const fs_byte_t* limit, const fs_byte_t* end,
+        const fs_byte_t* base, fs_size_t* out, fs_size_t* count, fs_size_t cap, const fs_size_t prefix) {
+
+    tvec_t lo_t[FS_TEDDY_MAX_PREFIX], hi_t[FS_TEDDY_MAX_PREFIX];
+    for (fs_size_t k = 0; k < prefix; k++) {
+        lo_t[k] = table_load(m->lo[k]);
+        hi_t[k] = table_load(m->hi[k]);
+    }
+
+    uint8_t buckets[FS_BLOCK] __attribute__((aligned(64)));
+
+    // 1. 64-byte blocks while the shifted loads stay below `end`
+    while (p < limit && (fs_size_t)(end - p) >= FS_BLOCK + prefix - 1) {
+        __builtin_prefetch(p + PREFETCH_DIST, 0, 3);
+
+        tvec_t r[FS_VECS];
+        uint64_t mask = 0;
+        for (int v = 0; v < FS_VECS; v++) {
+            r[v] = vec_ones();
+            for (fs_size_t k = 0; k < prefix; k++) {
+                r[v] = vec_and(r[v], lookup(lo_t[k], hi_t[k], p + v * FS_SIMD_WIDTH + k));
+            }
+            mask |= nonzero_mask(r[v]) << (v * FS_SIMD_WIDTH);
+        }
+
+        // Drop lanes past the caller's range (last block only)
+        fs_size_t span = (fs_size_t)(limit - p);
+        if (unlikely(span < FS_BLOCK)) mask &= (1ULL << span) - 1;
+
+        if (mask) {
+            for (int v = 0; v < FS_VECS; v++) vec_store(buckets + v * FS_SIMD_WIDTH, r[v]);
+
+            for (; mask; mask &= mask - 1) {
+                const unsigned i = (unsigned)__builtin_ctzll(mask);
+                if (emit_at(m, p + i, buckets[i], end, base, out, count, cap)) return p + i;
+            }
+        }
+
+        p += FS_BLOCK;
+    }
+
+    // 2. Scalar tail
+    return scan_scalar(m, p, limit, end, base, out, count, cap);
+}
+
+#define FS_DEFINE_TEDDY(prefix) \
+    static const fs_byte_t* FS_SIMD_NAME(teddy_##prefix)(const fs_multi_t* m, const fs_byte_t* p, \
+            const fs_byte_t* limit, const fs_byte_t* end, const fs_byte_t* base, \
+            fs_size_t* out, fs_size_t* count, fs_size_t cap) { \
+        return scan_teddy(m, p, limit, end, base, out, count, cap, prefix); \
+    }
+
+FS_DEFINE_TEDDY(1)
+FS_DEFINE_TEDDY(2)
+FS_DEFINE_TEDDY(3)
+
+const fs_byte_t* FS_SIMD_NAME(fs_multi_scan)(const fs_multi_t* m, const fs_byte_t* p, const fs_byte_t* limit,
+                                             const fs_byte_t* end, const fs_byte_t* base,
+                                             fs_size_t* out, fs_size_t* count, fs_size_t cap) {
+    switch (m->prefix) {
+        case 1:  return FS_SIMD_NAME(teddy_1)(m, p, limit, end, base, out, count, cap);
+        case 2:  return FS_SIMD_NAME(teddy_2)(m, p, limit, end, base, out, count, cap);
+        default: return FS_SIMD_NAME(teddy_3)(m, p, limit, end, base, out, count, cap);
+    }
+}
+
+#endif // FS_SIMD_WIDTH
+
+#ifdef FS_SIMD_TARGET
+FS_SIMD_TARGET_END
+#endif
@@ -0,0 +1,102 @@
+/*
+ * Multi-literal search: one pass over the data for a small set of patterns.
+ *
+ * Patterns are sorted by their first bytes and dealt into 8 buckets, so
+ * literals with a common prefix share a bucket and its fingerprint bits stay
+ * selective. The fingerprint covers the first min(3, shortest length) bytes.
+ * pshufb is not part of the SSE2 baseline: at that level the 16-byte kernel
+ * needs SSSE3, and CPUs without it walk the same tables one byte at a time.
+ */
+#include "multi_impl.h"
+#include "config.h"
+#include "cpu_features.h"
+
+const fs_byte_t* fs_multi_scan_scalar(const fs_multi_t* m, const fs_byte_t* p, const fs_byte_t* limit,
+                                      const fs_byte_t* end, const fs_byte_t* base,
+                                      fs_size_t* out, fs_size_t* count, fs_size_t cap) {
+    return scan_scalar(m, p, limit, end, base, out, count, cap);
+}
+
+fs_status_t fs_multi_init(fs_multi_t* m, const fs_byte_t* const* patterns, const fs_size_t* lens, fs_size_t count) {
+    if (!m || !patterns || !lens) return FS_ERROR_NULL_PTR;
+    if (count == 0 || count > FS_MULTI_MAX_PATTERNS) return FS_ERROR_INVALID_ARG;
+
+    memset(m, 0, sizeof(fs_multi_t));
+    m->count = count;
+    m->min_len = (fs_size_t)-1;
+
+    // 1. Patterns and their verify words
+    for (fs_size_t i = 0; i < count; i++) {
+        if (!patterns[i]) return FS_ERROR_NULL_PTR;
+        if (lens[i] == 0 || lens[i] > FS_MAX_PATTERN_LEN) return FS_ERROR_INVALID_ARG;
+
+        m->bytes[i] = patterns[i];
+        m->lens[i] = lens[i];
+        if (lens[i] < m->min_len) m->min_len = lens[i];
+        if (lens[i] > m->max_len) m->max_len = lens[i];
+
+        fs_size_t head_len = lens[i] < 8 ? lens[i] : 8;
+        memcpy(&m->head[i], patterns[i], head_len);
+        m->head_mask[i] = head_len == 8 ? ~0ULL : (1ULL << (head_len * 8)) - 1;
+    }
+    m->prefix = m->min_len < FS_TEDDY_MAX_PREFIX ? m->min_len : FS_TEDDY_MAX_PREFIX;
+
+    // 2. Buckets: contiguous runs of the prefix-sorted order
+    // (stable insertion sort; at most 64 entries)
+    fs_size_t order[FS_MULTI_MAX_PATTERNS];
+    for (fs_size_t i = 0; i < count; i++) {
+        fs_size_t j = i;
+        while (j > 0 && memcmp(m->bytes[order[j - 1]], m->bytes[i], m->prefix) > 0) {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = i;
+    }
+
+    for (fs_size_t r = 0; r < count; r++) {
+        fs_size_t id = order[r];
+        fs_size_t bucket = r * FS_TEDDY_BUCKETS / count;
+        m->bucket_ids[bucket] |= 1ULL << id;
+
+        // 3. Fingerprint tables
+        for (fs_size_t k = 0; k < m->prefix; k++) {
+            fs_byte_t x = patterns[id][k];
+            m->lo[k][x & 15] |= (uint8_t)(1u << bucket);
+            m->hi[k][x >> 4] |= (uint8_t)(1u << bucket);
+        }
+    }
+
+    switch (fs_cpu_isa()) {
+        case FS_ISA_AVX512BW: m->scan = fs_multi_scan_avx512; break;
+        case FS_ISA_AVX2:     m->scan = fs_multi_scan_avx2; break;
+        default:
+            m->scan = __builtin_cpu_supports("ssse3") ? fs_multi_scan_ssse3 : fs_multi_scan_scalar;
+            break;
+    }
+
+    return FS_SUCCESS;
+}
+
+static fs_size_t multi_span(const fs_matcher_t* mt, const fs_byte_t* data, fs_size_t data_len,
+                            fs_size_t from, fs_size_t to, fs_size_t* out, fs_size_t* count, fs_size_t cap) {
+    const fs_multi_t* m = (const fs_multi_t*)mt->impl;
+    if (data_len < m->min_len) return to;
+
+    // Last start position that still fits the shortest pattern
+    fs_size_t limit = data_len - m->min_len + 1;
+    if (limit > to) limit = to;
+    if (from >= limit) return to;
+
+    const fs_byte_t* stop = m->scan(m, data + from, data + limit, data + data_len, data, out, count, cap);
+
+    return stop == data + limit ? to : (fs_size_t)(stop - data);
+}
+
+void fs_multi_matcher(fs_matcher_t* out, const fs_multi_t* m) {
+    out->span = multi_span;
+    out->count = NULL;
+    out->impl = m;
+    out->max_len = m->max_len;
+    out->max_per_pos = m->count;
+    out->tagged = 1;
+}
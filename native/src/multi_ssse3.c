@@ -0,0 +1,5 @@
+// 16-byte instantiation of the multi-literal kernel (pshufb needs SSSE3)
+#define FS_SIMD_TARGET "ssse3"
+#define FS_SIMD_WIDTH 16
+#define FS_SIMD_SUFFIX ssse3
+#include "multi_impl.h"
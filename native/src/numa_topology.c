@@ -0,0 +1,114 @@
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+#include "numa_topology.h"
+
+#define NUMA_MAX_CPUS 1024
+
+static pthread_once_t g_numa_once = PTHREAD_ONCE_INIT;
+static int g_nodes = 1;
+static short g_cpu_node[NUMA_MAX_CPUS];     // -1 for CPUs in no node
+
+// "0-3,8-11" -> g_cpu_node[cpu] = node for every listed CPU
+static void parse_cpulist(const char* list, int node) {
+    const char* p = list;
+    while (*p) {
+        char* end;
+        long lo = strtol(p, &end, 10);
+        if (end == p) break;
+        long hi = lo;
+        if (*end == '-') {
+            p = end + 1;
+            hi = strtol(p, &end, 10);
+            if (end == p) break;
+        }
+        for (long cpu = lo; cpu <= hi && cpu < NUMA_MAX_CPUS; cpu++) {
+            if (cpu >= 0) g_cpu_node[cpu] = (short)node;
+        }
+        p = *end == ',' ? end + 1 : end;
+        if (*p == '\n') break;
+    }
+}
+
+static void numa_init_once(void) {
+    for (int cpu = 0; cpu < NUMA_MAX_CPUS; cpu++) g_cpu_node[cpu] = -1;
+
+    // Node ids may have gaps (offline nodes); every id below the highest one counts
+    int found = 0;
+#ifdef __linux__
+    const char* root = getenv("FASTSCAN_NUMA_SYSFS");
+    if (!root) root = "/sys/devices/system/node";
+
+    for (int node = 0; node < FS_NUMA_MAX_NODES; node++) {
+        char path[512];
+        snprintf(path, sizeof(path), "%s/node%d/cpulist", root, node);
+        FILE* f = fopen(path, "r");
+        if (!f) continue;
+
+        char list[4096];
+        if (fgets(list, sizeof(list), f)) parse_cpulist(list, node);
+        fclose(f);
+        found = node + 1;
+    }
+#endif
+    if (found > 1) g_nodes = found;
+
+    if (found == 0) {
+        long ncpu = sysconf(_SC_NPROCESSORS_CONF);
+        for (long cpu = 0; cpu < ncpu && cpu < NUMA_MAX_CPUS; cpu++) g_cpu_node[cpu] = 0;
+    }
+}
+
+void fs_numa_init(void) {
+    pthread_once(&g_numa_once, numa_init_once);
+}
+
+int fs_numa_nodes(void) {
+    fs_numa_init();
+    return g_nodes;
+}
+
+int fs_numa_cpu_node(int cpu) {
+    fs_numa_init();
+    return cpu >= 0 && cpu < NUMA_MAX_CPUS && g_cpu_node[cpu] > 0 ? g_cpu_node[cpu] : 0;
+}
+
+int fs_numa_current_node(void) {
+#ifdef __linux__
+    if (fs_numa_nodes() > 1) return fs_numa_cpu_node(sched_getcpu());
+#endif
+    return 0;
+}
+
+int fs_numa_node_cpus(int node, int* cpus, int max) {
+    fs_numa_init();
+    int n = 0;
+    for (int cpu = 0; cpu < NUMA_MAX_CPUS; cpu++) {
+        if (g_cpu_node[cpu] != node) continue;
+        if (n < max) cpus[n] = cpu;
+        n++;
+    }
+    return n;
+}
+
+void fs_numa_page_nodes(const void** pages, int n, int* nodes) {
+    for (int i = 0; i < n; i++) nodes[i] = -1;
+    if (fs_numa_nodes() <= 1) return;
+
+#if defined(__linux__) && defined(SYS_move_pages)
+    // move_pages with no target nodes only reports where each page is (-ENOENT when not resident)
+    if (syscall(SYS_move_pages, 0, (unsigned long)n, pages, NULL, nodes, 0) != 0) {
+        for (int i = 0; i < n; i++) nodes[i] = -1;
+        return;
+    }
+    for (int i = 0; i < n; i++) {
+        if (nodes[i] < 0 || nodes[i] >= g_nodes) nodes[i] = -1;
+    }
+#endif
+}
@@ -0,0 +1,162 @@
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "parallelism.h"
+
+// Longest cgroup directory path followed
+#define CGROUP_PATH_MAX 4096
+
+static pthread_once_t g_par_once = PTHREAD_ONCE_INIT;
+static fs_parallelism_t g_par;
+
+#ifdef __linux__
+// cgroup v1 mounts the cpu controller under one of these
+static const char* const V1_CPU_ROOTS[] = { "/sys/fs/cgroup/cpu", "/sys/fs/cgroup/cpu,cpuacct", "/sys/fs/cgroup/cpuacct,cpu" };
+
+static int read_line(const char* path, char* buf, size_t size) {
+    FILE* f = fopen(path, "r");
+    if (!f) return -1;
+    int ok = fgets(buf, (int)size, f) != NULL;
+    fclose(f);
+    return ok ? 0 : -1;
+}
+
+// CPUs worth of quota in one cgroup directory (0: no limit there)
+static int dir_quota(const char* dir, int v2) {
+    char path[CGROUP_PATH_MAX + 32], line[128];
+    long long quota = -1, period = 0;
+
+    if (v2) {
+        snprintf(path, sizeof(path), "%s/cpu.max", dir);
+        if (read_line(path, line, sizeof(line))) return 0;
+        if (strncmp(line, "max", 3) == 0) return 0;
+        if (sscanf(line, "%lld %lld", &quota, &period) != 2) return 0;
+    } else {
+        snprintf(path, sizeof(path), "%s/cpu.cfs_quota_us", dir);
+        if (read_line(path, line, sizeof(line))) return 0;
+        quota = atoll(line);
+        snprintf(path, sizeof(path), "%s/cpu.cfs_period_us", dir);
+        if (read_line(path, line, sizeof(line))) return 0;
+        period = atoll(line);
+    }
+    if (quota <= 0 || period <= 0) return 0;
+    return (int)((quota + period - 1) / period);
+}
+
+// Tightest quota on the cgroup `rel` under `root` and on each of its ancestors. Inside a cgroup
+// namespace the path may not exist under the mount; the ancestors (down to the mount itself) still do.
+static int tree_quota(const char* root, const char* rel, int v2) {
+    char dir[CGROUP_PATH_MAX];
+    snprintf(dir, sizeof(dir), "%s%s", root, rel);
+
+    int best = 0;
+    size_t root_len = strlen(root);
+    for (;;) {
+        int q = dir_quota(dir, v2);
+        if (q > 0 && (best == 0 || q < best)) best = q;
+
+        char* slash = strrchr(dir, '/');
+        if (!slash || (size_t)(slash - dir) < root_len) break;
+        *slash = '\0';
+    }
+    return best;
+}
+
+static int cgroup_quota(void) {
+    FILE* f = fopen("/proc/self/cgroup", "r");
+    if (!f) return 0;
+
+    int best = 0;
+    char line[CGROUP_PATH_MAX];
+    while (fgets(line, sizeof(line), f)) {
+        line[strcspn(line, "\n")] = '\0';
+        char* controllers = strchr(line, ':');
+        char* rel = controllers ? strchr(controllers + 1, ':') : NULL;
+        if (!rel) continue;
+        *rel++ = '\0';
+        controllers++;
+        if (strcmp(rel, "/") == 0) rel = "";
+
+        int q = 0;
+        if (*controllers == '\0') {
+            // "0::/path": the unified (v2) hierarchy
+            q = tree_quota("/sys/fs/cgroup", rel, 1);
+        } else {
+            int has_cpu = 0;
+            for (char* c = strtok(controllers, ","); c; c = strtok(NULL, ",")) has_cpu |= strcmp(c, "cpu") == 0;
+            if (!has_cpu) continue;
+            for (size_t i = 0; i < sizeof(V1_CPU_ROOTS) / sizeof(V1_CPU_ROOTS[0]) && q == 0; i++) {
+                q = tree_quota(V1_CPU_ROOTS[i], rel, 0);
+            }
+        }
+        if (q > 0 && (best == 0 || q < best)) best = q;
+    }
+    fclose(f);
+    return best;
+}
+
+// Allowed CPUs that are not the second (third...) hardware thread of a core already counted
+static int physical_cores(const cpu_set_t* allowed) {
+    int cores = 0;
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (!CPU_ISSET(cpu, allowed)) continue;
+
+        char path[128], list[256];
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/thread_siblings_list", cpu);
+        if (read_line(path, list, sizeof(list))) return 0;
+
+        // "2,34" or "2-3": the core is counted by the first allowed sibling
+        int first = cpu;
+        for (char* p = list; *p;) {
+            char* end;
+            long lo = strtol(p, &end, 10);
+            if (end == p) break;
+            long hi = lo;
+            if (*end == '-') hi = strtol(end + 1, &end, 10);
+            for (long s = lo; s <= hi && s < first; s++) {
+                if (s >= 0 && CPU_ISSET((int)s, allowed)) first = (int)s;
+            }
+            p = *end == ',' ? end + 1 : end;
+            if (*p == '\n') break;
+        }
+        if (first == cpu) cores++;
+    }
+    return cores;
+}
+#endif
+
+static void parallelism_once(void) {
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    g_par.online = online > 0 ? (int)online : 1;
+    g_par.affinity = g_par.online;
+    g_par.cores = g_par.online;
+
+#ifdef __linux__
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0) {
+        int n = CPU_COUNT(&allowed);
+        if (n > 0) g_par.affinity = n;
+        int cores = physical_cores(&allowed);
+        g_par.cores = cores > 0 ? cores : g_par.affinity;
+    }
+    g_par.quota = cgroup_quota();
+#endif
+
+    int eff = g_par.affinity;
+    if (g_par.quota > 0 && g_par.quota < eff) eff = g_par.quota;
+    if (g_par.cores < eff) eff = g_par.cores;
+
+    // Manual override for benchmarking, or for hosts whose limits are not visible from inside
+    const char* env = getenv("FASTSCAN_THREADS");
+    if (env && atoi(env) > 0) eff = atoi(env);
+
+    g_par.effective = eff > 0 ? eff : 1;
+}
+
+const fs_parallelism_t* fs_parallelism(void) {
+    pthread_once(&g_par_once, parallelism_once);
+    return &g_par;
+}
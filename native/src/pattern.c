@@ -0,0 +1,103 @@
+#include <stdlib.h>
+#include <string.h>
+#include "pattern.h"
+#include "scanner.h"
+
+fs_status_t fastscan_pattern_compile(fastscan_pattern_t* p, const char* pattern, fs_size_t len,
+                                     fs_pattern_kind_t kind) {
+    if (!p || !pattern) return FS_ERROR_NULL_PTR;
+
+    memset(p, 0, sizeof(fastscan_pattern_t));
+    p->kind = kind;
+    p->text_len = len;
+    p->count = 1;
+
+    if (kind == FS_PATTERN_REGEX) {
+        fs_status_t status = fs_regex_compile(&p->regex, pattern, len);
+        if (status != FS_SUCCESS) return status;
+        fs_regex_matcher(&p->matcher, &p->regex);
+        return FS_SUCCESS;
+    }
+    if (kind != FS_PATTERN_LITERAL) return FS_ERROR_INVALID_ARG;
+
+    // The needle keeps pointing at the pattern bytes, so they are copied
+    p->text = (fs_byte_t*)malloc(len ? len : 1);
+    if (!p->text) return FS_ERROR_OUT_OF_BOUNDS;
+    memcpy(p->text, pattern, len);
+
+    fs_status_t status = fs_needle_init(&p->needle, p->text, len, NULL);
+    if (status != FS_SUCCESS) {
+        fastscan_pattern_destroy(p);
+        return status;
+    }
+    fs_needle_matcher(&p->matcher, &p->needle);
+    return FS_SUCCESS;
+}
+
+fs_status_t fastscan_pattern_compile_list(fastscan_pattern_t* p, const char* const* patterns,
+                                          const fs_size_t* lens, fs_size_t count) {
+    if (!p || !patterns || !lens) return FS_ERROR_NULL_PTR;
+
+    memset(p, 0, sizeof(fastscan_pattern_t));
+    p->kind = FS_PATTERN_MULTI;
+    p->count = count;
+
+    // 1. Too many for the packed buckets: the dictionary keeps its own copy
+    if (count > FS_MULTI_MAX_PATTERNS) {
+        fs_status_t status = fs_dict_build(&p->dict, (const fs_byte_t* const*)patterns, lens, count);
+        if (status != FS_SUCCESS) return status;
+        p->use_dict = 1;
+        fs_dict_matcher(&p->matcher, &p->dict);
+        return FS_SUCCESS;
+    }
+
+    // 2. Teddy tables point at the pattern bytes: copy them back to back
+    for (fs_size_t i = 0; i < count; i++) {
+        if (!patterns[i]) return FS_ERROR_NULL_PTR;
+        p->text_len += lens[i];
+    }
+    p->text = (fs_byte_t*)malloc(p->text_len ? p->text_len : 1);
+    if (!p->text) return FS_ERROR_OUT_OF_BOUNDS;
+
+    const fs_byte_t* ptrs[FS_MULTI_MAX_PATTERNS];
+    fs_size_t off = 0;
+    for (fs_size_t i = 0; i < count; i++) {
+        memcpy(p->text + off, patterns[i], lens[i]);
+        ptrs[i] = p->text + off;
+        off += lens[i];
+    }
+
+    fs_status_t status = fs_multi_init(&p->multi, ptrs, lens, count);
+    if (status != FS_SUCCESS) {
+        fastscan_pattern_destroy(p);
+        return status;
+    }
+    fs_multi_matcher(&p->matcher, &p->multi);
+    return FS_SUCCESS;
+}
+
+fs_status_t fastscan_pattern_load_list(fastscan_pattern_t* p, const char* filepath) {
+    if (!p || !filepath) return FS_ERROR_NULL_PTR;
+
+    memset(p, 0, sizeof(fastscan_pattern_t));
+    p->kind = FS_PATTERN_MULTI;
+
+    fs_status_t status = fs_dict_load(&p->dict, filepath);
+    if (status != FS_SUCCESS) return status;
+    p->use_dict = 1;
+    p->count = p->dict.count;
+    fs_dict_matcher(&p->matcher, &p->dict);
+    return FS_SUCCESS;
+}
+
+void fastscan_pattern_destroy(fastscan_pattern_t* p) {
+    if (!p) return;
+
+    fs_needle_destroy(&p->needle);
+    fs_regex_destroy(&p->regex);
+    if (p->use_dict) fs_dict_destroy(&p->dict);
+
+    free(p->text);
+    p->text = NULL;
+    p->use_dict = 0;
+}
@@ -0,0 +1,715 @@
+/*
+ * Regular expression compiler: parser, required-literal extraction and a
+ * Thompson NFA for the reversed expression (see regex_dfa.c for matching).
+ *
+ * The syntax is JavaScript's minus the parts a DFA cannot express
+ * (backreferences, lookaround, \b). Matching is byte oriented: `.` takes any
+ * byte but \n and \r, negated classes any byte but the newline, and no match
+ * crosses one. As in JavaScript, `^` and `$` also hold after and before a \r.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "regex.h"
+
+typedef enum {
+    AST_EMPTY = 0,
+    AST_SET,
+    AST_CAT,
+    AST_ALT,
+    AST_REPEAT,
+    AST_BOL,
+    AST_EOL
+} ast_op_t;
+
+typedef struct {
+    uint8_t op;
+    uint16_t set;
+    int32_t child;      // CAT / ALT: first operand; REPEAT: the operand
+    int32_t next;       // Following operand of the enclosing CAT / ALT
+    int32_t min;        // REPEAT bounds; max < 0 is unbounded
+    int32_t max;
+} ast_t;
+
+typedef struct {
+    const char* s;
+    fs_size_t len;
+    fs_size_t pos;
+    int depth;
+    int failed;
+
+    ast_t* ast;
+    fs_size_t n;
+    fs_size_t cap;
+
+    uint64_t (*sets)[4];
+    fs_size_t set_count;
+    fs_size_t set_cap;
+} parser_t;
+
+// --- Byte sets ---------------------------------------------------------------
+
+static inline void set_add(uint64_t* set, unsigned b) { set[b >> 6] |= 1ULL << (b & 63); }
+static inline int set_has(const uint64_t* set, unsigned b) { return (set[b >> 6] >> (b & 63)) & 1; }
+
+static void set_add_range(uint64_t* set, unsigned lo, unsigned hi) {
+    for (unsigned b = lo; b <= hi; b++) set_add(set, b);
+}
+
+// \d \w \s and their negations
+static void set_add_escape(uint64_t* set, char e) {
+    uint64_t tmp[4] = {0};
+    switch (e | 0x20) {
+        case 'd': set_add_range(tmp, '0', '9'); break;
+        case 'w': set_add_range(tmp, '0', '9'); set_add_range(tmp, 'a', 'z'); set_add_range(tmp, 'A', 'Z'); set_add(tmp, '_'); break;
+        default:  set_add_range(tmp, '\t', '\r'); set_add(tmp, ' '); break;
+    }
+    const int negate = e >= 'A' && e <= 'Z';
+    for (int i = 0; i < 4; i++) set[i] |= negate ? ~tmp[i] : tmp[i];
+}
+
+static int set_single(const uint64_t* set, fs_byte_t* out) {
+    int count = 0;
+    for (int i = 0; i < 4; i++) count += __builtin_popcountll(set[i]);
+    if (count != 1) return 0;
+    for (int i = 0; i < 4; i++) {
+        if (set[i]) *out = (fs_byte_t)(i * 64 + __builtin_ctzll(set[i]));
+    }
+    return 1;
+}
+
+// --- Parser ------------------------------------------------------------------
+
+static int32_t new_node(parser_t* P, ast_op_t op) {
+    if (P->n == P->cap) {
+        fs_size_t cap = P->cap ? P->cap * 2 : 64;
+        ast_t* grown = (ast_t*)realloc(P->ast, cap * sizeof(ast_t));
+        if (!grown) { P->failed = 1; return -1; }
+        P->ast = grown;
+        P->cap = cap;
+    }
+    ast_t* a = &P->ast[P->n];
+    memset(a, 0, sizeof(ast_t));
+    a->op = (uint8_t)op;
+    a->child = -1;
+    a->next = -1;
+    return (int32_t)P->n++;
+}
+
+// An empty AST_SET node; returns the node, its set is P->sets[P->ast[node].set]
+static int32_t new_set_node(parser_t* P) {
+    if (P->set_count == P->set_cap) {
+        if (P->set_cap >= 0xffff) { P->failed = 1; return -1; }
+        fs_size_t cap = P->set_cap ? P->set_cap * 2 : 64;
+        if (cap > 0xffff) cap = 0xffff;
+        uint64_t (*grown)[4] = realloc(P->sets, cap * sizeof(*grown));
+        if (!grown) { P->failed = 1; return -1; }
+        P->sets = grown;
+        P->set_cap = cap;
+    }
+    int32_t node = new_node(P, AST_SET);
+    if (node < 0) return -1;
+    memset(P->sets[P->set_count], 0, sizeof(P->sets[0]));
+    P->ast[node].set = (uint16_t)P->set_count++;
+    return node;
+}
+
+static int32_t byte_node(parser_t* P, unsigned b) {
+    int32_t node = new_set_node(P);
+    if (node >= 0) set_add(P->sets[P->ast[node].set], b);
+    return node;
+}
+
+static int32_t fail(parser_t* P) {
+    P->failed = 1;
+    return -1;
+}
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if ((c | 0x20) >= 'a' && (c | 0x20) <= 'f') return (c | 0x20) - 'a' + 10;
+    return -1;
+}
+
+// n hex digits at pos, or -1 (nothing consumed)
+static long read_hex(parser_t* P, int n) {
+    if (P->len - P->pos < (fs_size_t)n) return -1;
+    long v = 0;
+    for (int i = 0; i < n; i++) {
+        int h = hex_value(P->s[P->pos + i]);
+        if (h < 0) return -1;
+        v = v * 16 + h;
+    }
+    P->pos += n;
+    return v;
+}
+
+static int is_digit(char c) { return c >= '0' && c <= '9'; }
+
+// {n}, {n,} or {n,m} at pos. Returns 1 and consumes it, 0 when it is a literal '{'
+static int read_braces(parser_t* P, int32_t* min, int32_t* max) {
+    fs_size_t p = P->pos + 1;
+    long lo = 0, hi;
+    if (p >= P->len || !is_digit(P->s[p])) return 0;
+    while (p < P->len && is_digit(P->s[p])) { if (lo <= FS_REGEX_MAX_REPEAT) lo = lo * 10 + (P->s[p] - '0'); p++; }
+    hi = lo;
+    if (p < P->len && P->s[p] == ',') {
+        p++;
+        hi = -1;
+        if (p < P->len && is_digit(P->s[p])) {
+            hi = 0;
+            while (p < P->len && is_digit(P->s[p])) { if (hi <= FS_REGEX_MAX_REPEAT) hi = hi * 10 + (P->s[p] - '0'); p++; }
+        }
+    }
+    if (p >= P->len || P->s[p] != '}') return 0;
+
+    P->pos = p + 1;
+    *min = (int32_t)lo;
+    *max = (int32_t)hi;
+    return 1;
+}
+
+// Escape after a backslash that stands for one byte; -1 when it is a class (\d ...) or unsupported
+static int escape_byte(parser_t* P, char e, int in_class) {
+    switch (e) {
+        case 'n': return '\n';
+        case 't': return '\t';
+        case 'r': return '\r';
+        case 'f': return '\f';
+        case 'v': return '\v';
+        case '0':
+            if (P->pos < P->len && is_digit(P->s[P->pos])) return fail(P);  // Octal
+            return 0;
+        case 'x': {
+            long v = read_hex(P, 2);
+            return v < 0 ? 'x' : (int)v;
+        }
+        case 'c':
+            if (P->pos < P->len && ((P->s[P->pos] | 0x20) >= 'a' && (P->s[P->pos] | 0x20) <= 'z')) {
+                return P->s[P->pos++] % 32;
+            }
+            return fail(P);
+        case 'b':
+            if (in_class) return '\b';
+            return fail(P);                                                  // Word boundary
+        case 'B':
+            return fail(P);
+        case 'd': case 'D': case 'w': case 'W': case 's': case 'S':
+            return -1;
+        default:
+            if (e >= '1' && e <= '9') return fail(P);                        // Backreference
+            return (unsigned char)e;
+    }
+}
+
+static int32_t parse_alt(parser_t* P);
+
+// [...] with ranges, escapes and negation
+static int32_t parse_class(parser_t* P) {
+    int32_t node = new_set_node(P);
+    if (node < 0) return -1;
+    uint64_t* set = P->sets[P->ast[node].set];
+
+    int negate = 0;
+    if (P->pos < P->len && P->s[P->pos] == '^') { negate = 1; P->pos++; }
+
+    while (1) {
+        if (P->pos >= P->len) return fail(P);
+        char c = P->s[P->pos++];
+        if (c == ']') break;
+
+        // 1. One item: a byte or a class escape
+        int lo = (unsigned char)c;
+        if (c == '\\') {
+            if (P->pos >= P->len) return fail(P);
+            char e = P->s[P->pos++];
+            lo = escape_byte(P, e, 1);
+            if (P->failed) return -1;
+            if (lo < 0) { set_add_escape(set, e); continue; }
+        }
+
+        // 2. A range when '-' is followed by another byte
+        if (P->pos + 1 < P->len && P->s[P->pos] == '-' && P->s[P->pos + 1] != ']') {
+            fs_size_t save = P->pos;
+            P->pos++;
+            char d = P->s[P->pos++];
+            int hi = (unsigned char)d;
+            if (d == '\\') {
+                if (P->pos >= P->len) return fail(P);
+                char e = P->s[P->pos++];
+                hi = escape_byte(P, e, 1);
+                if (P->failed) return -1;
+                if (hi < 0) {
+                    // [a-\d]: '-' is literal
+                    set_add(set, (unsigned)lo);
+                    set_add(set, '-');
+                    set_add_escape(set, e);
+                    continue;
+                }
+            }
+            if (hi < lo) { P->pos = save; return fail(P); }
+            set_add_range(set, (unsigned)lo, (unsigned)hi);
+            continue;
+        }
+        set_add(set, (unsigned)lo);
+    }
+
+    if (negate) {
+        for (int i = 0; i < 4; i++) set[i] = ~set[i];
+    }
+    return node;
+}
+
+static int32_t parse_atom(parser_t* P) {
+    char c = P->s[P->pos++];
+    int32_t node;
+
+    switch (c) {
+        case '(': {
+            if (++P->depth > FS_REGEX_MAX_DEPTH) return fail(P);
+            if (P->pos < P->len && P->s[P->pos] == '?') {
+                // (?:...) and (?<name>...) only; lookaround is not regular over lines
+                if (P->pos + 1 < P->len && P->s[P->pos + 1] == ':') {
+                    P->pos += 2;
+                } else if (P->pos + 2 < P->len && P->s[P->pos + 1] == '<' &&
+                           P->s[P->pos + 2] != '=' && P->s[P->pos + 2] != '!') {
+                    const char* close = memchr(P->s + P->pos, '>', P->len - P->pos);
+                    if (!close) return fail(P);
+                    P->pos = (fs_size_t)(close - P->s) + 1;
+                } else {
+                    return fail(P);
+                }
+            }
+            node = parse_alt(P);
+            if (node < 0) return -1;
+            if (P->pos >= P->len || P->s[P->pos] != ')') return fail(P);
+            P->pos++;
+            P->depth--;
+            return node;
+        }
+        case '[':
+            return parse_class(P);
+        case '.':
+            node = new_set_node(P);
+            if (node >= 0) {
+                uint64_t* set = P->sets[P->ast[node].set];
+                memset(set, 0xff, sizeof(P->sets[0]));
+                set[0] &= ~((1ULL << '\n') | (1ULL << '\r'));
+            }
+            return node;
+        case '^':
+            return new_node(P, AST_BOL);
+        case '$':
+            return new_node(P, AST_EOL);
+        case '*': case '+': case '?':
+            return fail(P);                                                  // Nothing to repeat
+        case '{': {
+            int32_t lo, hi;
+            P->pos--;
+            if (read_braces(P, &lo, &hi)) return fail(P);
+            P->pos++;
+            return byte_node(P, '{');
+        }
+        case '\\': {
+            if (P->pos >= P->len) return fail(P);
+            char e = P->s[P->pos++];
+
+            // \uXXXX: the UTF-8 bytes of the code point
+            if (e == 'u') {
+                long cp = read_hex(P, 4);
+                if (cp < 0) return byte_node(P, 'u');
+                fs_byte_t utf8[3];
+                int n;
+                if (cp < 0x80) { utf8[0] = (fs_byte_t)cp; n = 1; }
+                else if (cp < 0x800) { utf8[0] = (fs_byte_t)(0xc0 | (cp >> 6)); utf8[1] = (fs_byte_t)(0x80 | (cp & 63)); n = 2; }
+                else { utf8[0] = (fs_byte_t)(0xe0 | (cp >> 12)); utf8[1] = (fs_byte_t)(0x80 | ((cp >> 6) & 63)); utf8[2] = (fs_byte_t)(0x80 | (cp & 63)); n = 3; }
+                if (n == 1) return byte_node(P, utf8[0]);
+
+                int32_t cat = new_node(P, AST_CAT), last = -1;
+                for (int i = 0; i < n && cat >= 0; i++) {
+                    int32_t b = byte_node(P, utf8[i]);
+                    if (b < 0) return -1;
+                    if (last < 0) P->ast[cat].child = b; else P->ast[last].next = b;
+                    last = b;
+                }
+                return cat;
+            }
+
+            int b = escape_byte(P, e, 0);
+            if (P->failed) return -1;
+            if (b >= 0) return byte_node(P, (unsigned)b);
+
+            node = new_set_node(P);
+            if (node >= 0) set_add_escape(P->sets[P->ast[node].set], e);
+            return node;
+        }
+        default:
+            return byte_node(P, (unsigned char)c);
+    }
+}
+
+static int is_quantifier(parser_t* P) {
+    if (P->pos >= P->len) return 0;
+    char c = P->s[P->pos];
+    if (c == '*' || c == '+' || c == '?') return 1;
+    if (c != '{') return 0;
+    fs_size_t save = P->pos;
+    int32_t lo, hi;
+    int q = read_braces(P, &lo, &hi);
+    P->pos = save;
+    return q;
+}
+
+static int32_t parse_repeat(parser_t* P) {
+    int32_t atom = parse_atom(P);
+    if (atom < 0 || !is_quantifier(P)) return atom;
+
+    const uint8_t op = P->ast[atom].op;
+    if (op == AST_BOL || op == AST_EOL) return fail(P);
+
+    int32_t lo = 0, hi = -1;
+    char c = P->s[P->pos];
+    if (c == '{') {
+        read_braces(P, &lo, &hi);
+        if (lo > FS_REGEX_MAX_REPEAT || hi > FS_REGEX_MAX_REPEAT || (hi >= 0 && hi < lo)) return fail(P);
+    } else {
+        P->pos++;
+        if (c == '+') lo = 1;
+        if (c == '?') hi = 1;
+    }
+
+    // Lazy and greedy forms match the same start offsets
+    if (P->pos < P->len && P->s[P->pos] == '?') P->pos++;
+    if (is_quantifier(P)) return fail(P);
+
+    int32_t node = new_node(P, AST_REPEAT);
+    if (node < 0) return -1;
+    P->ast[node].child = atom;
+    P->ast[node].min = lo;
+    P->ast[node].max = hi;
+    return node;
+}
+
+static int32_t parse_cat(parser_t* P) {
+    int32_t cat = new_node(P, AST_CAT), last = -1;
+    if (cat < 0) return -1;
+
+    while (P->pos < P->len && P->s[P->pos] != '|' && P->s[P->pos] != ')') {
+        int32_t item = parse_repeat(P);
+        if (item < 0) return -1;
+        if (last < 0) P->ast[cat].child = item; else P->ast[last].next = item;
+        last = item;
+    }
+
+    if (last < 0) P->ast[cat].op = AST_EMPTY;
+    else if (P->ast[cat].child == last) return last;
+    return cat;
+}
+
+static int32_t parse_alt(parser_t* P) {
+    int32_t first = parse_cat(P);
+    if (first < 0 || P->pos >= P->len || P->s[P->pos] != '|') return first;
+
+    int32_t alt = new_node(P, AST_ALT), last = first;
+    if (alt < 0) return -1;
+    P->ast[alt].child = first;
+
+    while (P->pos < P->len && P->s[P->pos] == '|') {
+        P->pos++;
+        int32_t item = parse_cat(P);
+        if (item < 0) return -1;
+        P->ast[last].next = item;
+        last = item;
+    }
+    return alt;
+}
+
+// --- Required literal ---------------------------------------------------------
+
+typedef struct {
+    fs_byte_t b[FS_REGEX_MAX_LITERAL];
+    uint32_t n;
+} lit_t;
+
+// What is known about the strings a subexpression matches
+typedef struct {
+    int exact;      // Matches exactly one string: pre == suf == that string
+    lit_t pre;      // Prefix of every match
+    lit_t suf;      // Suffix of every match
+    lit_t must;     // Substring of every match (the longest known)
+    lit_t also;     // Another one, not inside `must`
+} lit_info_t;
+
+static int lit_contains(const lit_t* a, const lit_t* b) {
+    return b->n <= a->n && memmem(a->b, a->n, b->b, b->n) != NULL;
+}
+
+// Adds a required substring: `must` stays the longest, `also` the longest not inside it
+static void offer(lit_info_t* info, const lit_t* cand) {
+    if (cand->n == 0) return;
+    if (cand->n > info->must.n) {
+        lit_t old = info->must;
+        info->must = *cand;
+        if (lit_contains(&info->must, &info->also)) info->also.n = 0;
+        if (old.n > info->also.n && !lit_contains(&info->must, &old)) info->also = old;
+    } else if (cand->n > info->also.n && !lit_contains(&info->must, cand)) {
+        info->also = *cand;
+    }
+}
+
+// dst = a + b, truncated to the first FS_REGEX_MAX_LITERAL bytes; returns 0 when truncated
+static int lit_join_head(lit_t* dst, const lit_t* a, const lit_t* b) {
+    lit_t out = *a;
+    uint32_t take = b->n;
+    if (out.n + take > FS_REGEX_MAX_LITERAL) take = FS_REGEX_MAX_LITERAL - out.n;
+    memcpy(out.b + out.n, b->b, take);
+    out.n += take;
+    *dst = out;
+    return take == b->n;
+}
+
+// dst = a + b, keeping the last FS_REGEX_MAX_LITERAL bytes
+static void lit_join_tail(lit_t* dst, const lit_t* a, const lit_t* b) {
+    fs_byte_t tmp[2 * FS_REGEX_MAX_LITERAL];
+    memcpy(tmp, a->b, a->n);
+    memcpy(tmp + a->n, b->b, b->n);
+    uint32_t n = a->n + b->n, skip = n > FS_REGEX_MAX_LITERAL ? n - FS_REGEX_MAX_LITERAL : 0;
+    memcpy(dst->b, tmp + skip, n - skip);
+    dst->n = n - skip;
+}
+
+static void analyze(const parser_t* P, int32_t idx, lit_info_t* out) {
+    const ast_t* a = &P->ast[idx];
+    memset(out, 0, sizeof(lit_info_t));
+
+    switch (a->op) {
+        case AST_SET: {
+            fs_byte_t b = 0;
+            if (!set_single(P->sets[a->set], &b)) return;
+            out->exact = 1;
+            out->pre.b[0] = out->suf.b[0] = out->must.b[0] = b;
+            out->pre.n = out->suf.n = out->must.n = 1;
+            return;
+        }
+        case AST_EMPTY:
+        case AST_BOL:
+        case AST_EOL:
+            out->exact = 1;
+            return;
+        case AST_CAT: {
+            out->exact = 1;
+            for (int32_t c = a->child; c >= 0; c = P->ast[c].next) {
+                lit_info_t ci;
+                analyze(P, c, &ci);
+
+                // The end of what came before runs straight into the start of this operand
+                lit_t join;
+                lit_join_head(&join, &out->suf, &ci.pre);
+                offer(out, &ci.must);
+                offer(out, &ci.also);
+                offer(out, &join);
+
+                int whole = 1;
+                if (out->exact) whole = lit_join_head(&out->pre, &out->pre, &ci.pre);
+                if (ci.exact) lit_join_tail(&out->suf, &out->suf, &ci.suf);
+                else out->suf = ci.suf;
+                out->exact = out->exact && ci.exact && whole;
+            }
+            break;
+        }
+        case AST_ALT: {
+            int first = 1;
+            for (int32_t c = a->child; c >= 0; c = P->ast[c].next) {
+                lit_info_t ci;
+                analyze(P, c, &ci);
+                if (first) { *out = ci; first = 0; continue; }
+
+                int same_must = ci.must.n == out->must.n && !memcmp(ci.must.b, out->must.b, ci.must.n);
+                out->exact = out->exact && ci.exact && ci.pre.n == out->pre.n && !memcmp(ci.pre.b, out->pre.b, ci.pre.n);
+
+                uint32_t p = 0;
+                while (p < out->pre.n && p < ci.pre.n && out->pre.b[p] == ci.pre.b[p]) p++;
+                out->pre.n = p;
+
+                uint32_t s = 0;
+                while (s < out->suf.n && s < ci.suf.n &&
+                       out->suf.b[out->suf.n - 1 - s] == ci.suf.b[ci.suf.n - 1 - s]) s++;
+                memmove(out->suf.b, out->suf.b + out->suf.n - s, s);
+                out->suf.n = s;
+
+                if (!same_must) out->must.n = 0;
+                out->also.n = 0;
+            }
+            break;
+        }
+        case AST_REPEAT: {
+            if (a->min == 0) return;
+            analyze(P, a->child, out);
+            if (!(a->min == 1 && a->max == 1)) out->exact = 0;
+            break;
+        }
+    }
+
+    offer(out, &out->pre);
+    offer(out, &out->suf);
+}
+
+// --- NFA ----------------------------------------------------------------------
+
+static int32_t emit(fs_regex_t* re, fs_size_t* cap, fs_re_op_t op, uint16_t cls, int32_t out, int32_t out1) {
+    if (re->node_count >= FS_REGEX_MAX_NODES) return -1;
+    if (re->node_count == *cap) {
+        fs_size_t grown_cap = *cap ? *cap * 2 : 64;
+        fs_re_node_t* grown = (fs_re_node_t*)realloc(re->nodes, grown_cap * sizeof(fs_re_node_t));
+        if (!grown) return -1;
+        re->nodes = grown;
+        *cap = grown_cap;
+    }
+    fs_re_node_t* n = &re->nodes[re->node_count];
+    n->op = (uint8_t)op;
+    n->cls = cls;
+    n->out = out;
+    n->out1 = out1;
+    return (int32_t)re->node_count++;
+}
+
+// Builds the reversed expression in front of `next`; returns its entry node or -1
+static int32_t build(const parser_t* P, fs_regex_t* re, fs_size_t* cap, int32_t idx, int32_t next) {
+    const ast_t* a = &P->ast[idx];
+
+    switch (a->op) {
+        case AST_EMPTY: return next;
+        case AST_SET:   return emit(re, cap, FS_RE_BYTES, a->set, next, -1);
+        case AST_BOL:
+            re->anchored = 1;
+            return emit(re, cap, FS_RE_BOL, 0, next, -1);
+        case AST_EOL:
+            re->anchored = 1;
+            return emit(re, cap, FS_RE_EOL, 0, next, -1);
+
+        case AST_CAT:
+            // Reversed: the first operand is read last
+            for (int32_t c = a->child; c >= 0 && next >= 0; c = P->ast[c].next) next = build(P, re, cap, c, next);
+            return next;
+
+        case AST_ALT: {
+            int32_t entry = -1;
+            for (int32_t c = a->child; c >= 0; c = P->ast[c].next) {
+                int32_t e = build(P, re, cap, c, next);
+                if (e < 0) return -1;
+                entry = entry < 0 ? e : emit(re, cap, FS_RE_SPLIT, 0, entry, e);
+                if (entry < 0) return -1;
+            }
+            return entry;
+        }
+
+        case AST_REPEAT: {
+            int32_t tail = next;
+
+            // 1. Optional part: a loop (x*) or max - min nested (x(x)?)?
+            if (a->max < 0) {
+                int32_t loop = emit(re, cap, FS_RE_SPLIT, 0, -1, next);
+                if (loop < 0) return -1;
+                int32_t body = build(P, re, cap, a->child, loop);
+                if (body < 0) return -1;
+                re->nodes[loop].out = body;
+                tail = loop;
+            } else {
+                for (int32_t i = a->min; i < a->max; i++) {
+                    int32_t opt = emit(re, cap, FS_RE_SPLIT, 0, -1, next);
+                    if (opt < 0) return -1;
+                    int32_t body = build(P, re, cap, a->child, tail);
+                    if (body < 0) return -1;
+                    re->nodes[opt].out = body;
+                    tail = opt;
+                }
+            }
+
+            // 2. Mandatory copies
+            for (int32_t i = 0; i < a->min && tail >= 0; i++) tail = build(P, re, cap, a->child, tail);
+            return tail;
+        }
+    }
+    return -1;
+}
+
+// Splits every class into the bytes in `set` and the others
+static void split_byte_classes(fs_regex_t* re, const uint64_t* set) {
+    int16_t split[256][2];
+    memset(split, -1, sizeof(split));
+    fs_size_t classes = 0;
+
+    for (unsigned b = 0; b < 256; b++) {
+        int in = set_has(set, b);
+        int16_t* slot = &split[re->byte_class[b]][in];
+        if (*slot < 0) *slot = (int16_t)classes++;
+        re->byte_class[b] = (uint8_t)*slot;
+    }
+    re->classes = classes;
+}
+
+// Bytes that belong to exactly the same sets share a class; with ^ or $, \r has one of its own
+static void build_byte_classes(fs_regex_t* re) {
+    memset(re->byte_class, 0, sizeof(re->byte_class));
+    re->classes = 1;
+
+    for (fs_size_t s = 0; s < re->set_count && re->classes < 256; s++) split_byte_classes(re, re->sets[s]);
+    if (re->anchored) {
+        uint64_t cr[4] = { 1ULL << '\r', 0, 0, 0 };
+        split_byte_classes(re, cr);
+    }
+}
+
+fs_status_t fs_regex_compile(fs_regex_t* re, const char* pattern, fs_size_t len) {
+    if (!re || !pattern) return FS_ERROR_NULL_PTR;
+    memset(re, 0, sizeof(fs_regex_t));
+
+    parser_t P;
+    memset(&P, 0, sizeof(parser_t));
+    P.s = pattern;
+    P.len = len;
+
+    // 1. Parse; a stray ')' is the only way to stop before the end
+    int32_t root = parse_alt(&P);
+    fs_status_t status = FS_ERROR_INVALID_ARG;
+    if (root < 0 || P.failed || P.pos != P.len) goto done;
+
+    // 2. Reversed NFA ending in the match node
+    fs_size_t cap = 0;
+    int32_t match = emit(re, &cap, FS_RE_MATCH, 0, -1, -1);
+    if (match < 0) goto done;
+    re->start = build(&P, re, &cap, root, match);
+    if (re->start < 0) goto done;
+
+    // 3. Prefilter literal
+    lit_info_t info;
+    analyze(&P, root, &info);
+    if (info.must.n > 0) {
+        memcpy(re->literal, info.must.b, info.must.n);
+        re->literal_len = info.must.n;
+        status = fs_needle_init(&re->needle, re->literal, re->literal_len, NULL);
+        if (status != FS_SUCCESS) goto done;
+
+        memcpy(re->second, info.also.b, info.also.n);
+        re->second_len = info.also.n;
+    }
+
+    re->sets = P.sets;
+    re->set_count = P.set_count;
+    P.sets = NULL;
+    build_byte_classes(re);
+    status = FS_SUCCESS;
+
+done:
+    free(P.ast);
+    free(P.sets);
+    if (status != FS_SUCCESS) fs_regex_destroy(re);
+    return status;
+}
+
+void fs_regex_destroy(fs_regex_t* re) {
+    if (!re) return;
+    if (re->literal_len) fs_needle_destroy(&re->needle);
+    free(re->nodes);
+    free(re->sets);
+    memset(re, 0, sizeof(fs_regex_t));
+}
@@ -0,0 +1,409 @@
+/*
+ * Regex matching: literal prefilter, then a lazily built DFA per candidate line.
+ *
+ * Matches never cross a newline, so a match starting in [from, to) lies on a
+ * line that contains the required literal. The existing needle kernels find
+ * those lines; everything else is skipped at literal speed.
+ *
+ * Each candidate line is read once, backwards, by a DFA over the reversed
+ * expression with the start state re-entered at every byte: after reading
+ * line[p .. end) it accepts exactly when some match starts at p. DFA states
+ * are NFA state sets built on first use and cached per thread; the cache is
+ * flushed when it fills.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "regex.h"
+#include "scanner.h"
+#include "lines_impl.h"
+
+#define unlikely(x) __builtin_expect(!!(x), 0)
+
+#define ASSERT_BOL 1
+#define ASSERT_EOL 2
+
+#define STATE_ACCEPT      1   // Accepts inside a line
+#define STATE_BOL_KNOWN   2
+#define STATE_BOL_ACCEPT  4   // Accepts at the line start
+
+#define CANDIDATE_BATCH 64
+
+typedef struct {
+    const fs_regex_t* re;
+    fs_size_t classes;
+    fs_size_t stride;             // Row length: a transition per class, then the state's flags
+    fs_byte_t rep[256];           // One byte of each class
+
+    int32_t* trans;               // row + class -> next row (state * stride), -1 until computed
+    uint32_t* set_start;          // NFA set of each state: pool[set_start .. + set_len)
+    uint32_t* set_len;
+    fs_size_t states;
+
+    int32_t* pool;
+    fs_size_t pool_len;
+
+    int32_t* table;               // Open addressing over NFA sets: state + 1, 0 when empty
+    fs_size_t table_mask;
+
+    // Closure scratch
+    uint32_t* mark;
+    uint32_t gen;
+    int32_t* stack;
+    int32_t* seeds;
+    int32_t* work;
+    fs_size_t work_len;
+    int work_accept;
+
+    int32_t init;                 // Line end state, -1 after a flush
+    int empty_line;               // An empty line matches (-1 unknown)
+} dfa_t;
+
+static void dfa_free(dfa_t* d) {
+    free(d->trans);
+    free(d->set_start);
+    free(d->set_len);
+    free(d->pool);
+    free(d->table);
+    free(d->mark);
+    free(d->stack);
+    free(d->seeds);
+    free(d->work);
+}
+
+static void dfa_flush(dfa_t* d) {
+    d->states = 0;
+    d->pool_len = 0;
+    d->init = -1;
+    memset(d->table, 0, (d->table_mask + 1) * sizeof(int32_t));
+}
+
+static int dfa_init(dfa_t* d, const fs_regex_t* re) {
+    memset(d, 0, sizeof(dfa_t));
+    d->re = re;
+    d->classes = re->classes;
+    d->stride = re->classes + 1;
+    d->empty_line = -1;
+    for (int b = 255; b >= 0; b--) d->rep[re->byte_class[b]] = (fs_byte_t)b;
+
+    const fs_size_t nodes = re->node_count;
+    d->table_mask = 2 * FS_REGEX_DFA_STATES - 1;
+    d->trans = (int32_t*)malloc(FS_REGEX_DFA_STATES * d->stride * sizeof(int32_t));
+    d->set_start = (uint32_t*)malloc(FS_REGEX_DFA_STATES * sizeof(uint32_t));
+    d->set_len = (uint32_t*)malloc(FS_REGEX_DFA_STATES * sizeof(uint32_t));
+    d->pool = (int32_t*)malloc(FS_REGEX_DFA_POOL * sizeof(int32_t));
+    d->table = (int32_t*)malloc((d->table_mask + 1) * sizeof(int32_t));
+    d->mark = (uint32_t*)calloc(nodes, sizeof(uint32_t));
+    d->stack = (int32_t*)malloc((3 * nodes + 1) * sizeof(int32_t));
+    d->seeds = (int32_t*)malloc(nodes * sizeof(int32_t));
+    d->work = (int32_t*)malloc(nodes * sizeof(int32_t));
+
+    if (!d->trans || !d->set_start || !d->set_len || !d->pool || !d->table ||
+        !d->mark || !d->stack || !d->seeds || !d->work) {
+        dfa_free(d);
+        return -1;
+    }
+    dfa_flush(d);
+    return 0;
+}
+
+static int cmp_int32(const void* a, const void* b) {
+    int32_t x = *(const int32_t*)a, y = *(const int32_t*)b;
+    return (x > y) - (x < y);
+}
+
+// work = the NFA states reachable from seeds (and the start state) without reading
+// a byte. Assertions in `asserts` are crossed; the others stay in the set so a
+// later closure can cross them.
+static void closure(dfa_t* d, const int32_t* seeds, fs_size_t n, int with_start, int asserts) {
+    const fs_re_node_t* nodes = d->re->nodes;
+
+    if (unlikely(++d->gen == 0)) {
+        memset(d->mark, 0, d->re->node_count * sizeof(uint32_t));
+        d->gen = 1;
+    }
+
+    fs_size_t sp = 0;
+    for (fs_size_t i = 0; i < n; i++) d->stack[sp++] = seeds[i];
+    if (with_start) d->stack[sp++] = d->re->start;
+
+    d->work_len = 0;
+    d->work_accept = 0;
+    while (sp) {
+        int32_t s = d->stack[--sp];
+        if (d->mark[s] == d->gen) continue;
+        d->mark[s] = d->gen;
+
+        const fs_re_node_t* node = &nodes[s];
+        switch (node->op) {
+            case FS_RE_SPLIT:
+                d->stack[sp++] = node->out1;
+                d->stack[sp++] = node->out;
+                break;
+            case FS_RE_BOL:
+            case FS_RE_EOL:
+                d->work[d->work_len++] = s;
+                if (asserts & (node->op == FS_RE_BOL ? ASSERT_BOL : ASSERT_EOL)) d->stack[sp++] = node->out;
+                break;
+            case FS_RE_MATCH:
+                d->work_accept = 1;
+                d->work[d->work_len++] = s;
+                break;
+            default:
+                d->work[d->work_len++] = s;
+                break;
+        }
+    }
+    qsort(d->work, d->work_len, sizeof(int32_t), cmp_int32);
+}
+
+static uint32_t hash_set(const int32_t* set, fs_size_t n) {
+    uint32_t h = 2166136261u;
+    for (fs_size_t i = 0; i < n; i++) h = (h ^ (uint32_t)set[i]) * 16777619u;
+    return h;
+}
+
+// State of the set in `work`; -1 when the cache is full
+static int32_t intern(dfa_t* d) {
+    const fs_size_t n = d->work_len;
+    fs_size_t slot = hash_set(d->work, n) & d->table_mask;
+
+    for (; d->table[slot]; slot = (slot + 1) & d->table_mask) {
+        int32_t s = d->table[slot] - 1;
+        if (d->set_len[s] == n && !memcmp(d->pool + d->set_start[s], d->work, n * sizeof(int32_t))) return s;
+    }
+
+    if (d->states == FS_REGEX_DFA_STATES || d->pool_len + n > FS_REGEX_DFA_POOL) return -1;
+
+    int32_t s = (int32_t)d->states++;
+    memcpy(d->pool + d->pool_len, d->work, n * sizeof(int32_t));
+    d->set_start[s] = (uint32_t)d->pool_len;
+    d->set_len[s] = (uint32_t)n;
+    d->pool_len += n;
+    int32_t* row = d->trans + (fs_size_t)s * d->stride;
+    for (fs_size_t c = 0; c < d->classes; c++) row[c] = -1;
+    row[d->classes] = d->work_accept ? STATE_ACCEPT : 0;
+    d->table[slot] = s + 1;
+    return s;
+}
+
+// Interns `work`, flushing the cache first when it is full
+static int32_t intern_or_flush(dfa_t* d) {
+    int32_t s = intern(d);
+    if (unlikely(s < 0)) {
+        dfa_flush(d);
+        s = intern(d);
+    }
+    return s;
+}
+
+// The state after reading byte class c (leftwards) from state s
+static int32_t step(dfa_t* d, int32_t s, fs_size_t c) {
+    const fs_re_node_t* nodes = d->re->nodes;
+    const fs_byte_t b = d->rep[c];
+    const int32_t* set = d->pool + d->set_start[s];
+    fs_size_t n = d->set_len[s];
+
+    // A \r ends a line for ^ and $ (its own class then): ^ holds after it, $ before it
+    const int cr = b == '\r' && d->re->anchored;
+    if (cr) {
+        closure(d, set, n, 0, ASSERT_BOL);
+        set = d->work;
+        n = d->work_len;
+    }
+
+    int32_t* seeds = d->seeds;
+    fs_size_t count = 0;
+    for (fs_size_t i = 0; i < n; i++) {
+        const fs_re_node_t* node = &nodes[set[i]];
+        if (node->op == FS_RE_BYTES && ((d->re->sets[node->cls][b >> 6] >> (b & 63)) & 1)) {
+            seeds[count++] = node->out;
+        }
+    }
+
+    // A match may also end right here: the start state is entered again
+    closure(d, seeds, count, 1, cr ? ASSERT_EOL : 0);
+
+    const fs_size_t before = d->states;
+    int32_t next = intern_or_flush(d);
+    if (d->states >= before) d->trans[(fs_size_t)s * d->stride + c] = (int32_t)(next * d->stride);
+    return next;
+}
+
+static inline int32_t* state_flags(dfa_t* d, int32_t s) { return d->trans + (fs_size_t)s * d->stride + d->classes; }
+
+static int accepts_at_line_start(dfa_t* d, int32_t s) {
+    int32_t* flags = state_flags(d, s);
+    if (!(*flags & STATE_BOL_KNOWN)) {
+        closure(d, d->pool + d->set_start[s], d->set_len[s], 0, ASSERT_BOL);
+        *flags |= STATE_BOL_KNOWN | (d->work_accept ? STATE_BOL_ACCEPT : 0);
+    }
+    return (*flags & STATE_BOL_ACCEPT) != 0;
+}
+
+static int32_t init_state(dfa_t* d) {
+    if (d->init < 0) {
+        closure(d, NULL, 0, 1, ASSERT_EOL);
+        d->init = intern_or_flush(d);
+    }
+    return d->init;
+}
+
+typedef struct {
+    fs_size_t* dst;       // Room for `room` offsets, filled in descending order
+    fs_size_t room;
+    fs_size_t skip;       // Leading (highest) starts to leave out
+    fs_size_t found;
+    fs_size_t written;
+    fs_size_t last_skipped;
+} emit_t;
+
+static inline void emit_start(emit_t* e, fs_size_t p) {
+    if (e->found++ < e->skip) e->last_skipped = p;
+    else if (e->written < e->room) e->dst[e->written++] = p;
+}
+
+// One backward pass over the line [ls, le): match starts in [lo, hi)
+static void line_pass(dfa_t* d, const fs_byte_t* data, fs_size_t data_len,
+                      fs_size_t ls, fs_size_t le, fs_size_t lo, fs_size_t hi, emit_t* e) {
+    int32_t s = init_state(d);
+
+    // 1. Empty match at the line end (its newline)
+    if (le < data_len && le >= lo && le < hi) {
+        int accept;
+        if (ls == le) {
+            if (d->empty_line < 0) {
+                closure(d, NULL, 0, 1, ASSERT_BOL | ASSERT_EOL);
+                d->empty_line = d->work_accept;
+            }
+            accept = d->empty_line;
+        } else {
+            accept = (*state_flags(d, s) & STATE_ACCEPT) ||
+                     (d->re->anchored && data[le - 1] == '\r' && accepts_at_line_start(d, s));
+        }
+        if (accept) emit_start(e, le);
+    }
+
+    // 2. Leftwards to lo, following rows rather than state ids
+    const uint8_t* byte_class = d->re->byte_class;
+    const fs_size_t classes = d->classes, stride = d->stride;
+    const int cr = d->re->anchored;
+    fs_size_t row = (fs_size_t)s * stride;
+    for (fs_size_t p = le; p-- > lo;) {
+        const fs_size_t c = byte_class[data[p]];
+        int32_t next = d->trans[row + c];
+        if (unlikely(next < 0)) next = (int32_t)(step(d, (int32_t)(row / stride), c) * stride);
+        row = (fs_size_t)next;
+
+        // Crossing ^ only adds states, so accepting states accept at the line start too
+        if (d->trans[row + classes] & STATE_ACCEPT) {
+            if (p < hi) emit_start(e, p);
+        } else if (unlikely(p == ls || (cr && data[p - 1] == '\r')) && p < hi &&
+                   accepts_at_line_start(d, (int32_t)(row / stride))) {
+            emit_start(e, p);
+        }
+    }
+}
+
+static void reverse(fs_size_t* a, fs_size_t n) {
+    for (fs_size_t i = 0, j = n; i + 1 < j; i++, j--) {
+        fs_size_t t = a[i]; a[i] = a[j - 1]; a[j - 1] = t;
+    }
+}
+
+// Appends the match starts in [lo, hi) of line [ls, le) in ascending order.
+// Returns hi when they all fit, else the first start left out.
+static fs_size_t scan_line(dfa_t* d, const fs_byte_t* data, fs_size_t data_len,
+                           fs_size_t ls, fs_size_t le, fs_size_t lo, fs_size_t hi,
+                           fs_size_t* out, fs_size_t* count, fs_size_t cap) {
+    emit_t e = { out + *count, cap - *count, 0, 0, 0, 0 };
+    line_pass(d, data, data_len, ls, le, lo, hi, &e);
+
+    if (e.found <= e.room) {
+        reverse(e.dst, e.written);
+        *count += e.written;
+        return hi;
+    }
+
+    // Too many: a second pass keeps the lowest `room` starts
+    e.skip = e.found - e.room;
+    e.found = e.written = 0;
+    line_pass(d, data, data_len, ls, le, lo, hi, &e);
+    reverse(e.dst, e.written);
+    *count += e.written;
+    return e.last_skipped;
+}
+
+// No literal to look for: every line in range goes through the DFA
+static fs_size_t scan_lines(dfa_t* d, const fs_byte_t* data, fs_size_t data_len, fs_size_t from, fs_size_t to,
+                            fs_size_t* out, fs_size_t* count, fs_size_t cap) {
+    fs_size_t ls = fs_line_start(data, 0, from);
+    for (fs_size_t pos = from; pos < to;) {
+        fs_size_t le = fs_line_end(data, data_len, pos);
+        fs_size_t hi = le < to ? le + 1 : to;
+        fs_size_t stop = scan_line(d, data, data_len, ls, le, pos, hi, out, count, cap);
+        if (stop != hi) return stop;
+        pos = ls = le + 1;
+    }
+    return to;
+}
+
+static fs_size_t scan_candidates(dfa_t* d, const fs_byte_t* data, fs_size_t data_len, fs_size_t from, fs_size_t to,
+                                 fs_size_t* out, fs_size_t* count, fs_size_t cap) {
+    const fs_regex_t* re = d->re;
+
+    // Lines starting before `to` end at or before the newline after to - 1
+    const fs_size_t qlimit = fs_line_end(data, data_len, to - 1);
+    fs_size_t cand[CANDIDATE_BATCH];
+    fs_size_t done = from;     // Starts below are reported; a line start unless it is still `from`
+    fs_size_t search = from;
+
+    while (search < qlimit) {
+        fs_size_t found = 0;
+        fs_size_t resume = fs_scan_span(&re->needle, data, data_len, search, qlimit, cand, &found, CANDIDATE_BATCH);
+
+        for (fs_size_t i = 0; i < found; i++) {
+            const fs_size_t q = cand[i];
+            if (q < done) continue;   // Its line is done
+
+            fs_size_t ls = fs_line_start(data, done == from ? 0 : done, q);
+            fs_size_t le = fs_line_end(data, data_len, q);
+            if (re->second_len && !memmem(data + ls, le - ls, re->second, re->second_len)) {
+                done = le + 1;
+                continue;
+            }
+            fs_size_t lo = ls > done ? ls : done;
+            fs_size_t hi = le < to ? le + 1 : to;
+
+            fs_size_t stop = scan_line(d, data, data_len, ls, le, lo, hi, out, count, cap);
+            if (stop != hi) return stop;
+            done = le + 1;
+        }
+
+        if (resume == qlimit) break;
+        search = resume > done ? resume : done;
+    }
+    return to;
+}
+
+static fs_size_t regex_span(const fs_matcher_t* m, const fs_byte_t* data, fs_size_t data_len,
+                            fs_size_t from, fs_size_t to, fs_size_t* out, fs_size_t* count, fs_size_t cap) {
+    const fs_regex_t* re = (const fs_regex_t*)m->impl;
+    if (from >= to) return to;
+
+    dfa_t d;
+    if (dfa_init(&d, re)) return to;
+
+    fs_size_t stop = re->literal_len ? scan_candidates(&d, data, data_len, from, to, out, count, cap)
+                                     : scan_lines(&d, data, data_len, from, to, out, count, cap);
+    dfa_free(&d);
+    return stop;
+}
+
+void fs_regex_matcher(fs_matcher_t* out, const fs_regex_t* re) {
+    out->span = regex_span;
+    out->count = NULL;
+    out->impl = re;
+    out->max_len = (fs_size_t)-1;   // Bounded by the enclosing line only
+    out->max_per_pos = 1;
+    out->tagged = 0;
+}
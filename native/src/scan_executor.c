@@ -0,0 +1,93 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include "scan_executor.h"
+
+typedef struct executor_job {
+    struct executor_job* next;
+    fs_job_fn fn;
+    void* arg;
+} executor_job_t;
+
+// A queue and the threads that take its jobs
+typedef struct {
+    pthread_cond_t cond;
+    executor_job_t* head;
+    executor_job_t* tail;
+    int queued;             // Jobs not taken yet
+    int idle;               // Threads waiting for one
+    int threads;
+    int max_threads;        // 0: no cap
+} executor_lane_t;
+
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static executor_lane_t g_scans = { PTHREAD_COND_INITIALIZER, NULL, NULL, 0, 0, 0, FS_EXECUTOR_MAX_THREADS };
+static executor_lane_t g_blocking = { PTHREAD_COND_INITIALIZER, NULL, NULL, 0, 0, 0, 0 };
+
+static void* executor_thread(void* arg) {
+    executor_lane_t* lane = (executor_lane_t*)arg;
+    pthread_mutex_lock(&g_lock);
+    for (;;) {
+        while (!lane->head) {
+            lane->idle++;
+            pthread_cond_wait(&lane->cond, &g_lock);
+            lane->idle--;
+        }
+
+        executor_job_t* job = lane->head;
+        lane->head = job->next;
+        if (!lane->head) lane->tail = NULL;
+        lane->queued--;
+        pthread_mutex_unlock(&g_lock);
+
+        job->fn(job->arg);
+        free(job);
+
+        pthread_mutex_lock(&g_lock);
+    }
+    return NULL;
+}
+
+static int lane_submit(executor_lane_t* lane, fs_job_fn fn, void* arg) {
+    executor_job_t* job = (executor_job_t*)malloc(sizeof(executor_job_t));
+    if (!job) return -1;
+    job->next = NULL;
+    job->fn = fn;
+    job->arg = arg;
+
+    pthread_mutex_lock(&g_lock);
+    if (lane->tail) lane->tail->next = job;
+    else lane->head = job;
+    lane->tail = job;
+    lane->queued++;
+
+    // More jobs waiting than threads to take them: one more thread, while under the cap
+    if (lane->queued > lane->idle && (!lane->max_threads || lane->threads < lane->max_threads)) {
+        pthread_attr_t attr;
+        pthread_t thread;
+        pthread_attr_init(&attr);
+        pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+        if (pthread_create(&thread, &attr, executor_thread, lane) == 0) lane->threads++;
+        pthread_attr_destroy(&attr);
+    }
+
+    // Nobody to run it, now or later
+    if (lane->threads == 0) {
+        lane->head = lane->tail = NULL;
+        lane->queued = 0;
+        pthread_mutex_unlock(&g_lock);
+        free(job);
+        return -1;
+    }
+
+    pthread_cond_signal(&lane->cond);
+    pthread_mutex_unlock(&g_lock);
+    return 0;
+}
+
+int fs_executor_submit(fs_job_fn fn, void* arg) {
+    return lane_submit(&g_scans, fn, arg);
+}
+
+int fs_executor_submit_blocking(fs_job_fn fn, void* arg) {
+    return lane_submit(&g_blocking, fn, arg);
+}
@@ -0,0 +1,22 @@
+/*
+ * Compiles what follows for the instruction set of the including file,
+ * FS_SIMD_TARGET (e.g. "avx2,popcnt"), without per-file compiler flags:
+ * GCC takes it as a target pragma for the rest of the file, clang (which
+ * ignores that pragma) as a target attribute on every function up to
+ * FS_SIMD_TARGET_END. The intrinsics headers must be included before.
+ */
+#ifndef FASTSCAN_SIMD_TARGET_H
+#define FASTSCAN_SIMD_TARGET_H
+
+#define FS_PRAGMA_(x) _Pragma(#x)
+#define FS_PRAGMA(x) FS_PRAGMA_(x)
+
+#if defined(__clang__)
+#define FS_SIMD_TARGET_BEGIN FS_PRAGMA(clang attribute push (__attribute__((target(FS_SIMD_TARGET))), apply_to = function))
+#define FS_SIMD_TARGET_END _Pragma("clang attribute pop")
+#else
+#define FS_SIMD_TARGET_BEGIN FS_PRAGMA(GCC target(FS_SIMD_TARGET))
+#define FS_SIMD_TARGET_END
+#endif
+
+#endif // FASTSCAN_SIMD_TARGET_H
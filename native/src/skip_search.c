@@ -0,0 +1,126 @@
+/*
+ * Sublinear search for long needles (sampled gram filter).
+ *
+ * Any occurrence of an m-byte needle fully contains one of the 16-byte text
+ * windows sampled every S = m - 15 bytes. So the scan only reads 16 bytes per
+ * S bytes of text. It hashes the first 8 (FS_SKIP_GRAM) against the needle's
+ * grams at offsets [0, S) and checks the second 8 before touching anything
+ * else. Every hit i proposes exactly one
+ * alignment j = x - i, and that alignment can't come from any other sample,
+ * so results come out in order with no duplicates.
+ *
+ * The stride is constant, so the hardware prefetcher keeps up. Once S passes
+ * a cache line, whole lines are never touched, and throughput grows with the
+ * needle length instead of shrinking. Needles where one gram repeats more
+ * than FS_SKIP_MAX_CHAIN times (periodic needles) would propose too many
+ * alignments per sample, so they stay on the rare-pair kernels. Very
+ * repetitive text, where most samples are needle grams, hands the rest of the
+ * range to the rare-pair kernel (n->fallback) for the same reason.
+ */
+#include "kernels.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define unlikely(x) __builtin_expect(!!(x), 0)
+#define likely(x)   __builtin_expect(!!(x), 1)
+
+#define PREFETCH_AHEAD (16 * 1024)
+
+// Hit-rate check: after every SAMPLE_WINDOW samples, give up on more than 1/32 hits
+#define SAMPLE_WINDOW 1024
+#define MAX_WINDOW_HITS (SAMPLE_WINDOW / 32)
+
+static inline uint64_t load64(const fs_byte_t* p) { uint64_t v; memcpy(&v, p, 8); return v; }
+
+static inline unsigned gram_hash(const fs_byte_t* p) {
+    return (unsigned)((load64(p) * 0x9E3779B97F4A7C15ull) >> (64 - FS_SKIP_HASH_BITS));
+}
+
+int fs_skip_table_init(fs_needle_t* n) {
+    fs_size_t stride = n->len - FS_SKIP_SAMPLE + 1;
+
+    uint16_t* table = (uint16_t*)calloc(FS_SKIP_TABLE_SIZE + stride, sizeof(uint16_t));
+    if (!table) return 0;
+
+    n->skip_head = table;
+    n->skip_next = table + FS_SKIP_TABLE_SIZE;
+
+    // Chains hold offset + 1 (0 ends a chain); pushing ascending offsets makes
+    // every chain walk from the largest offset down, i.e. ascending alignments
+    uint16_t chain_len[FS_SKIP_TABLE_SIZE];
+    memset(chain_len, 0, sizeof(chain_len));
+
+    for (fs_size_t i = 0; i < stride; i++) {
+        unsigned h = gram_hash(n->bytes + i);
+        n->skip_next[i] = n->skip_head[h];
+        n->skip_head[h] = (uint16_t)(i + 1);
+
+        if (++chain_len[h] > FS_SKIP_MAX_CHAIN) {
+            fs_skip_table_free(n);
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+void fs_skip_table_free(fs_needle_t* n) {
+    free(n->skip_head);
+    n->skip_head = NULL;
+    n->skip_next = NULL;
+}
+
+static inline int verify_long(const fs_needle_t* n, const fs_byte_t* c) {
+    return c[n->rare.first] == n->bytes[n->rare.first] &&
+           c[n->rare.second] == n->bytes[n->rare.second] &&
+           load64(c) == n->head && load64(c + n->len - 8) == n->tail &&
+           memcmp(c + 8, n->bytes + 8, n->len - 16) == 0;
+}
+
+const fs_byte_t* fs_skip_scan(const fs_needle_t* n, const fs_byte_t* p, const fs_byte_t* limit,
+                              const fs_byte_t* end, const fs_byte_t* base,
+                              fs_size_t* out, fs_size_t* count, fs_size_t cap) {
+    const uint16_t* head = n->skip_head;
+    const uint16_t* next = n->skip_next;
+    const fs_size_t stride = n->len - FS_SKIP_SAMPLE + 1;
+
+    // Alignments in (x - stride, x] are owned by sample x, starting with x = p
+    const fs_byte_t* x = p;
+    const fs_byte_t* first = p;
+    unsigned samples = 0;
+    unsigned hits = 0;
+
+    while (x < limit + stride - 1 && x + FS_SKIP_SAMPLE <= end) {
+        __builtin_prefetch(x + PREFETCH_AHEAD, 0, 0);
+
+        // Alignments up to x - stride are settled; hand the rest over if sampling doesn't pay
+        if (unlikely(++samples == SAMPLE_WINDOW)) {
+            if (hits > MAX_WINDOW_HITS) {
+                const fs_byte_t* resume = x - stride + 1;
+                if (resume < first) resume = first;
+                return resume < limit ? n->fallback(n, resume, limit, end, base, out, count, cap) : limit;
+            }
+            samples = 0;
+            hits = 0;
+        }
+
+        for (uint16_t e = head[gram_hash(x)]; e != 0; e = next[e - 1]) {
+            const fs_size_t i = (fs_size_t)(e - 1);
+            const fs_byte_t* c = x - i;
+            if (c < first || c >= limit) continue;
+
+            // Second half of the sample, same cache line region as the hashed gram
+            if (load64(x + FS_SKIP_GRAM) != load64(n->bytes + i + FS_SKIP_GRAM)) continue;
+            hits++;
+
+            if (verify_long(n, c)) {
+                if (unlikely(*count >= cap)) return c;
+                out[(*count)++] = (fs_size_t)(c - base);
+            }
+        }
+
+        x += stride;
+    }
+
+    return limit;
+}
@@ -0,0 +1,335 @@
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "stream_reader.h"
+#include "lines_impl.h"
+
+// Room in front of every block for the bytes carried over from the one before: enough for the
+// max_len - 1 of any literal. Longer carries (a line, for a regex or in line mode) use a scratch buffer.
+#define STREAM_HEAD FS_MAX_PATTERN_LEN
+
+// A reader idle this long hands over what it has; also how often it looks at the stop flag
+#define STREAM_POLL_MS 100
+
+// Matches per span call
+#define SPAN_BUFFER 4096
+
+typedef struct {
+    fs_byte_t* buf;         // STREAM_HEAD bytes of room, then up to FS_IO_BLOCK_SIZE bytes read
+    fs_size_t len;          // Bytes read; 0 at the end of the stream
+    int full;               // Read, and not released by the scanner yet
+} stream_block_t;
+
+// The two blocks go back and forth between the reader thread and the scanner
+typedef struct {
+    int fd;
+    stream_block_t blocks[2];
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int error;              // errno of a failed read
+    int stop;               // The scanner is done: the reader quits at its next wait
+    const int32_t* cancel;  // ctx->cancel: also stops a reader waiting on an idle pipe
+} stream_reader_t;
+
+typedef struct {
+    const fastscan_ctx_t* ctx;
+    const fs_matcher_t* m;
+    fs_stream_sink_fn sink;
+    void* arg;
+    fs_size_t* count;
+
+    int lines;              // Line mode: one (start, end, number) triple per matching line
+    int line_bounded;       // Blocks are cut at line starts (regex, line mode)
+    fs_needle_t newline;
+    fs_size_t newlines;     // Before the block being scanned
+
+    fs_size_t* buf;
+    fs_size_t cap;
+    fs_byte_t* scratch;
+    fs_size_t scratch_cap;
+
+    fs_size_t found;        // Matches (lines) so far, for progress reports
+    uint64_t interval_ns;
+    uint64_t next_report;
+} stream_scan_t;
+
+static int scan_cancelled(const int32_t* cancel) {
+    return cancel && __atomic_load_n(cancel, __ATOMIC_RELAXED);
+}
+
+static int stream_stopped(stream_reader_t* r) {
+    return __atomic_load_n(&r->stop, __ATOMIC_RELAXED) || scan_cancelled(r->cancel);
+}
+
+// Up to FS_IO_BLOCK_SIZE bytes: fewer at the end of the stream, or once input has paused for
+// STREAM_POLL_MS. -1 on a read error or when stopped.
+static ssize_t fill_block(stream_reader_t* r, fs_byte_t* dst) {
+    struct pollfd pfd = { r->fd, POLLIN, 0 };
+    fs_size_t got = 0;
+
+    while (got < FS_IO_BLOCK_SIZE) {
+        if (stream_stopped(r)) return -1;
+        int ready = poll(&pfd, 1, STREAM_POLL_MS);
+        if (ready == 0) {
+            if (got > 0) break;
+            continue;
+        }
+        if (ready < 0 && errno == EINTR) continue;
+
+        ssize_t n = read(r->fd, dst + got, FS_IO_BLOCK_SIZE - got);
+        if (n == 0) break;
+        if (n < 0) {
+            if (errno == EINTR || errno == EAGAIN) continue;
+            r->error = errno;
+            return -1;
+        }
+        got += (fs_size_t)n;
+    }
+    return (ssize_t)got;
+}
+
+static void* reader_thread(void* arg) {
+    stream_reader_t* r = (stream_reader_t*)arg;
+
+    for (int i = 0;; i ^= 1) {
+        stream_block_t* b = &r->blocks[i];
+        pthread_mutex_lock(&r->lock);
+        while (b->full && !r->stop) pthread_cond_wait(&r->cond, &r->lock);
+        int stop = r->stop;
+        pthread_mutex_unlock(&r->lock);
+        if (stop) break;
+
+        ssize_t n = fill_block(r, b->buf + STREAM_HEAD);
+
+        // A failed read is handed over too: the scanner finds r->error set
+        pthread_mutex_lock(&r->lock);
+        b->len = n > 0 ? (fs_size_t)n : 0;
+        b->full = 1;
+        pthread_cond_broadcast(&r->cond);
+        pthread_mutex_unlock(&r->lock);
+        if (n <= 0) break;
+    }
+    return NULL;
+}
+
+static stream_block_t* wait_block(stream_reader_t* r, int i) {
+    pthread_mutex_lock(&r->lock);
+    while (!r->blocks[i].full) pthread_cond_wait(&r->cond, &r->lock);
+    pthread_mutex_unlock(&r->lock);
+    return &r->blocks[i];
+}
+
+static void release_block(stream_reader_t* r, int i) {
+    pthread_mutex_lock(&r->lock);
+    r->blocks[i].full = 0;
+    pthread_cond_broadcast(&r->cond);
+    pthread_mutex_unlock(&r->lock);
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void report(const stream_scan_t* st, fs_size_t bytes, fs_size_t total) {
+    fs_progress_t progress = { bytes, total, st->count ? *st->count : st->found };
+    st->ctx->on_progress(st->ctx->progress_arg, &progress);
+}
+
+// Starts in [0, end) can be settled with the bytes at hand; the rest wait for the next block
+static fs_size_t settled_end(const stream_scan_t* st, const fs_byte_t* data, fs_size_t len) {
+    fs_size_t keep = st->m->max_len == (fs_size_t)-1 ? 0 : st->m->max_len - 1;
+    if (len <= keep) return 0;
+    fs_size_t end = len - keep;
+    return st->line_bounded ? fs_line_start(data, 0, end) : end;
+}
+
+// Carry followed by the new block, in the scratch buffer; the carry may already be in it
+static fs_byte_t* gather(stream_scan_t* st, const fs_byte_t* carry, fs_size_t carry_len,
+                         const fs_byte_t* block, fs_size_t n) {
+    int inside = st->scratch && carry >= st->scratch && carry < st->scratch + st->scratch_cap;
+    if (inside && carry != st->scratch) memmove(st->scratch, carry, carry_len);
+
+    // Doubling, so a line that spans many blocks is not copied over and over
+    if (carry_len + n > st->scratch_cap) {
+        fs_size_t cap = 2 * (carry_len + n);
+        fs_byte_t* grown = (fs_byte_t*)realloc(st->scratch, cap);
+        if (!grown) return NULL;
+        st->scratch = grown;
+        st->scratch_cap = cap;
+    }
+    if (!inside) memcpy(st->scratch, carry, carry_len);
+    memcpy(st->scratch + carry_len, block, n);
+    return st->scratch;
+}
+
+// Matches starting in [0, end) of data, at stream offset `base`. 1: the sink wants no more.
+static int scan_matches(stream_scan_t* st, const fs_byte_t* data, fs_size_t len, fs_size_t end, fs_size_t base) {
+    const fs_matcher_t* m = st->m;
+
+    if (!st->sink && m->count) {
+        *st->count += m->count(m, data, len, 0, end);
+        return 0;
+    }
+
+    for (fs_size_t from = 0; from < end;) {
+        fs_size_t n = 0;
+        from = m->span(m, data, len, from, end, st->buf, &n, st->cap);
+        if (!st->sink) {
+            *st->count += n;
+            continue;
+        }
+
+        // Tagged matches keep their id above the offset
+        for (fs_size_t i = 0; i < n; i++) st->buf[i] += base;
+        st->found += n;
+        if (n && st->sink(st->arg, st->buf, n)) return 1;
+    }
+    return 0;
+}
+
+// Line mode: data starts a line, and every line starting before `end` ends in data
+static int scan_lines(stream_scan_t* st, const fs_byte_t* data, fs_size_t len, fs_size_t end, fs_size_t base) {
+    const fs_matcher_t* m = st->m;
+    const fs_needle_t* nl = &st->newline;
+    fs_size_t pos = 0, counted = 0;
+
+    while (pos < end) {
+        fs_size_t n = 0;
+        m->span(m, data, len, pos, end, st->buf, &n, m->max_per_pos);
+        if (n == 0) break;
+
+        fs_size_t hit = m->tagged ? FS_MATCH_OFFSET(st->buf[0]) : st->buf[0];
+        fs_size_t start = fs_line_start(data, 0, hit);
+        fs_size_t stop = fs_line_end(data, len, hit);
+        if (start > counted) {
+            st->newlines += nl->count(nl, data + counted, data + start, data + start);
+            counted = start;
+        }
+
+        fs_size_t line[3] = { base + start, base + stop, st->newlines + 1 };
+        st->found++;
+        if (st->sink(st->arg, line, 1)) return 1;
+        pos = stop + 1;
+    }
+
+    if (counted < end) st->newlines += nl->count(nl, data + counted, data + end, data + end);
+    return 0;
+}
+
+fs_status_t fs_stream_scan(const fastscan_ctx_t* ctx, fs_stream_sink_fn sink, void* arg, fs_size_t* count) {
+    if (!ctx || (!sink && !count)) return FS_ERROR_NULL_PTR;
+
+    stream_scan_t st = { 0 };
+    st.ctx = ctx;
+    st.m = &ctx->matcher;
+    st.sink = sink;
+    st.arg = arg;
+    st.count = sink ? NULL : count;
+    st.lines = sink && ctx->line_mode;
+    st.line_bounded = st.lines || st.m->max_len == (fs_size_t)-1;
+    st.cap = st.m->max_per_pos > SPAN_BUFFER ? st.m->max_per_pos : SPAN_BUFFER;
+    if (count) *count = 0;
+
+    if (st.lines && fs_needle_init(&st.newline, (const fs_byte_t*)"\n", 1, NULL) != FS_SUCCESS) {
+        return FS_ERROR_OUT_OF_BOUNDS;
+    }
+
+    stream_reader_t r = { 0 };
+    r.fd = ctx->region.fd;
+    r.cancel = ctx->cancel;
+    st.buf = (fs_size_t*)malloc(st.cap * sizeof(fs_size_t));
+    r.blocks[0].buf = (fs_byte_t*)malloc(STREAM_HEAD + FS_IO_BLOCK_SIZE);
+    r.blocks[1].buf = (fs_byte_t*)malloc(STREAM_HEAD + FS_IO_BLOCK_SIZE);
+    pthread_mutex_init(&r.lock, NULL);
+    pthread_cond_init(&r.cond, NULL);
+
+    pthread_t reader;
+    int started = st.buf && r.blocks[0].buf && r.blocks[1].buf && pthread_create(&reader, NULL, reader_thread, &r) == 0;
+    fs_status_t status = started ? FS_SUCCESS : FS_ERROR_OUT_OF_BOUNDS;
+
+    if (ctx->on_progress) {
+        st.interval_ns = (uint64_t)(ctx->progress_interval_ms ? ctx->progress_interval_ms : 100) * 1000000ull;
+        st.next_report = now_ns() + st.interval_ns;
+    }
+
+    // `carry`: the unsettled tail of the last block, prepended to the next one
+    const fs_byte_t* carry = NULL;
+    fs_size_t carry_len = 0, base = 0;
+    int held = -1;
+
+    for (int i = 0; status == FS_SUCCESS; i ^= 1) {
+        stream_block_t* b = wait_block(&r, i);
+        if (scan_cancelled(ctx->cancel)) {
+            status = FS_ERROR_CANCELLED;
+            break;
+        }
+        if (r.error) {
+            status = FS_ERROR_READ_FAILED;
+            break;
+        }
+
+        fs_size_t len = carry_len + b->len;
+        fs_byte_t* data;
+        if (carry_len <= STREAM_HEAD) {
+            data = b->buf + STREAM_HEAD - carry_len;
+            if (carry_len) memcpy(data, carry, carry_len);
+        } else if (!(data = gather(&st, carry, carry_len, b->buf + STREAM_HEAD, b->len))) {
+            status = FS_ERROR_OUT_OF_BOUNDS;
+            break;
+        }
+
+        // The carry has been copied out of the block before: the reader may refill it
+        if (held >= 0) release_block(&r, held);
+        held = i;
+
+        int last = b->len == 0;
+        fs_size_t end = last ? len : settled_end(&st, data, len);
+        int done = st.lines ? scan_lines(&st, data, len, end, base) : scan_matches(&st, data, len, end, base);
+
+        carry = data + end;
+        carry_len = len - end;
+        base += end;
+
+        // The sink may hand on what it has gathered so far
+        if (!done && sink) done = sink(arg, NULL, 0);
+
+        if (scan_cancelled(ctx->cancel)) {
+            status = FS_ERROR_CANCELLED;
+            break;
+        }
+        if (done || last) break;
+
+        if (st.interval_ns) {
+            uint64_t now = now_ns();
+            if (now >= st.next_report) {
+                st.next_report = now + st.interval_ns;
+                report(&st, base, 0);
+            }
+        }
+    }
+
+    if (status == FS_SUCCESS && ctx->on_progress) report(&st, base + carry_len, base + carry_len);
+
+    if (started) {
+        pthread_mutex_lock(&r.lock);
+        __atomic_store_n(&r.stop, 1, __ATOMIC_RELAXED);
+        pthread_cond_broadcast(&r.cond);
+        pthread_mutex_unlock(&r.lock);
+        pthread_join(reader, NULL);
+    }
+
+    pthread_mutex_destroy(&r.lock);
+    pthread_cond_destroy(&r.cond);
+    free(r.blocks[0].buf);
+    free(r.blocks[1].buf);
+    free(st.buf);
+    free(st.scratch);
+    if (st.lines) fs_needle_destroy(&st.newline);
+    return status;
+}
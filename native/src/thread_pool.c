@@ -0,0 +1,425 @@
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "thread_pool.h"
+#include "numa_topology.h"
+
+// Empty polls before an idle worker goes to sleep (a few tens of µs)
+#define POOL_SPIN 1024
+
+typedef struct {
+    fs_task_fn fn;
+    char* args;
+    size_t stride;
+
+    int remaining;              // Tasks not finished yet; whoever finishes the last one signals
+    int done;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+} pool_job_t;
+
+// Bounded MPMC ring: a cell is free for the push at position p when seq == p,
+// and holds a task for the pop at position p when seq == p + 1
+typedef struct {
+    size_t seq;
+    pool_job_t* job;
+    int index;
+} pool_cell_t;
+
+static pool_cell_t g_cells[FS_POOL_QUEUE_SIZE];
+static size_t g_head __attribute__((aligned(64)));
+static size_t g_tail __attribute__((aligned(64)));
+
+static int g_workers;
+static int g_requested;             // Workers asked for so far (some may have failed to start)
+static pthread_mutex_t g_start_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int g_sleepers;
+static pthread_mutex_t g_idle_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_idle_cond = PTHREAD_COND_INITIALIZER;
+
+static int g_cpus[FS_POOL_MAX_WORKERS];
+
+// NUMA node of a pool worker's CPU; -1 on threads outside the pool
+static __thread int t_node = -1;
+
+// Tasks [lo, hi) of one runner, packed so that taking and stealing are a single CAS
+typedef struct {
+    uint64_t range;
+} __attribute__((aligned(64))) steal_share_t;
+
+#define SHARE(lo, hi) ((uint64_t)(lo) | ((uint64_t)(hi) << 32))
+#define SHARE_LO(r) ((uint32_t)(r))
+#define SHARE_HI(r) ((uint32_t)((r) >> 32))
+#define SHARE_LEFT(r) (SHARE_HI(r) > SHARE_LO(r) ? SHARE_HI(r) - SHARE_LO(r) : 0)
+
+// Shares index `order`, which lists the tasks grouped by node; each node's group starts out split
+// into node_shares[n] shares, claimed by the runners that land on that node. `runners` spare
+// shares start empty, for runners that find none left.
+typedef struct {
+    fs_task_fn fn;
+    char* args;
+    size_t stride;
+    const int* order;           // NULL: task i is at position i
+    const int* nodes;           // Node of each task (NULL: one node)
+    steal_share_t* shares;
+    int nshares;
+
+    int nnodes;
+    int node_first[FS_NUMA_MAX_NODES + 1];     // The last entry is the first spare
+    int node_shares[FS_NUMA_MAX_NODES];
+    int node_next[FS_NUMA_MAX_NODES];
+    int spare_next;
+} steal_job_t;
+
+static inline void cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#else
+    __asm__ __volatile__("" ::: "memory");
+#endif
+}
+
+static int queue_push(pool_job_t* job, int index) {
+    size_t pos = __atomic_load_n(&g_tail, __ATOMIC_RELAXED);
+    for (;;) {
+        pool_cell_t* c = &g_cells[pos & (FS_POOL_QUEUE_SIZE - 1)];
+        intptr_t dif = (intptr_t)__atomic_load_n(&c->seq, __ATOMIC_ACQUIRE) - (intptr_t)pos;
+        if (dif == 0) {
+            if (__atomic_compare_exchange_n(&g_tail, &pos, pos + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                c->job = job;
+                c->index = index;
+                __atomic_store_n(&c->seq, pos + 1, __ATOMIC_RELEASE);
+                return 0;
+            }
+        } else if (dif < 0) {
+            return -1;
+        } else {
+            pos = __atomic_load_n(&g_tail, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+static int queue_pop(pool_job_t** job, int* index) {
+    size_t pos = __atomic_load_n(&g_head, __ATOMIC_RELAXED);
+    for (;;) {
+        pool_cell_t* c = &g_cells[pos & (FS_POOL_QUEUE_SIZE - 1)];
+        intptr_t dif = (intptr_t)__atomic_load_n(&c->seq, __ATOMIC_ACQUIRE) - (intptr_t)(pos + 1);
+        if (dif == 0) {
+            if (__atomic_compare_exchange_n(&g_head, &pos, pos + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                *job = c->job;
+                *index = c->index;
+                __atomic_store_n(&c->seq, pos + FS_POOL_QUEUE_SIZE, __ATOMIC_RELEASE);
+                return 0;
+            }
+        } else if (dif < 0) {
+            return -1;
+        } else {
+            pos = __atomic_load_n(&g_head, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+static int queue_empty(void) {
+    return __atomic_load_n(&g_head, __ATOMIC_SEQ_CST) == __atomic_load_n(&g_tail, __ATOMIC_SEQ_CST);
+}
+
+static void run_item(pool_job_t* job, int index) {
+    job->fn(job->args + (size_t)index * job->stride);
+
+    if (__atomic_sub_fetch(&job->remaining, 1, __ATOMIC_ACQ_REL) == 0) {
+        pthread_mutex_lock(&job->lock);
+        job->done = 1;
+        pthread_cond_signal(&job->cond);
+        pthread_mutex_unlock(&job->lock);
+    }
+}
+
+static void pin_worker(int cpu) {
+    t_node = fs_numa_cpu_node(cpu);
+#ifdef __linux__
+    if (cpu < 0) return;
+    cpu_set_t one;
+    CPU_ZERO(&one);
+    CPU_SET(cpu, &one);
+    pthread_setaffinity_np(pthread_self(), sizeof(one), &one);
+#else
+    (void)cpu;
+#endif
+}
+
+static void* pool_worker(void* arg) {
+    pin_worker(*(const int*)arg);
+
+    int spins = 0;
+    for (;;) {
+        pool_job_t* job;
+        int index;
+        if (queue_pop(&job, &index) == 0) {
+            run_item(job, index);
+            spins = 0;
+            continue;
+        }
+        if (++spins < POOL_SPIN) {
+            cpu_relax();
+            continue;
+        }
+
+        // Registered as a sleeper before the last look at the queue, so a push cannot be missed
+        pthread_mutex_lock(&g_idle_lock);
+        __atomic_add_fetch(&g_sleepers, 1, __ATOMIC_SEQ_CST);
+        while (queue_empty()) pthread_cond_wait(&g_idle_cond, &g_idle_lock);
+        __atomic_sub_fetch(&g_sleepers, 1, __ATOMIC_SEQ_CST);
+        pthread_mutex_unlock(&g_idle_lock);
+        spins = 0;
+    }
+    return NULL;
+}
+
+// CPUs for workers [from, to): those the process may run on, taken from each node in turn so that
+// a pool smaller than the machine still covers every node; -1 when affinity is unknown
+static void assign_cpus(int from, int to) {
+    for (int i = from; i < to; i++) g_cpus[i] = -1;
+#ifdef __linux__
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) return;
+
+    int ncpu = CPU_COUNT(&allowed);
+    if (ncpu == 0) return;
+
+    int order[CPU_SETSIZE];
+    int n = 0;
+    for (int round = 0; n < ncpu; round++) {
+        for (int node = 0; node < fs_numa_nodes(); node++) {
+            int nth = round;
+            for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+                if (CPU_ISSET(cpu, &allowed) && fs_numa_cpu_node(cpu) == node && nth-- == 0) {
+                    order[n++] = cpu;
+                    break;
+                }
+            }
+        }
+    }
+    for (int i = from; i < to; i++) g_cpus[i] = order[i % ncpu];
+#endif
+}
+
+int fs_pool_start(int workers) {
+    if (workers > FS_POOL_MAX_WORKERS) workers = FS_POOL_MAX_WORKERS;
+    if (workers <= __atomic_load_n(&g_requested, __ATOMIC_ACQUIRE)) return fs_pool_size();
+
+    pthread_mutex_lock(&g_start_lock);
+    if (workers > g_requested) {
+        if (g_requested == 0) {
+            for (size_t i = 0; i < FS_POOL_QUEUE_SIZE; i++) g_cells[i].seq = i;
+        }
+        assign_cpus(g_requested, workers);
+
+        int started = 0;
+        for (int i = g_requested; i < workers; i++) {
+            pthread_attr_t attr;
+            pthread_t thread;
+            pthread_attr_init(&attr);
+            pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+            if (pthread_create(&thread, &attr, pool_worker, &g_cpus[i]) == 0) started++;
+            pthread_attr_destroy(&attr);
+        }
+
+        __atomic_add_fetch(&g_workers, started, __ATOMIC_RELEASE);
+        __atomic_store_n(&g_requested, workers, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&g_start_lock);
+    return fs_pool_size();
+}
+
+int fs_pool_size(void) {
+    return __atomic_load_n(&g_workers, __ATOMIC_ACQUIRE);
+}
+
+void fs_pool_run(fs_task_fn fn, void* args, size_t stride, int n) {
+    char* base = (char*)args;
+    if (n <= 1 || fs_pool_size() == 0) {
+        for (int i = 0; i < n; i++) fn(base + (size_t)i * stride);
+        return;
+    }
+
+    pool_job_t job;
+    memset(&job, 0, sizeof(job));
+    job.fn = fn;
+    job.args = base;
+    job.stride = stride;
+    job.remaining = n;
+    pthread_mutex_init(&job.lock, NULL);
+    pthread_cond_init(&job.cond, NULL);
+
+    // 1. Queue all but the first task (a full queue runs it here) and wake sleeping workers
+    for (int i = 1; i < n; i++) {
+        if (queue_push(&job, i)) run_item(&job, i);
+    }
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&g_sleepers, __ATOMIC_SEQ_CST) > 0) {
+        pthread_mutex_lock(&g_idle_lock);
+        pthread_cond_broadcast(&g_idle_cond);
+        pthread_mutex_unlock(&g_idle_lock);
+    }
+
+    // 2. The first task here, then whatever is still queued until this job's tasks are all taken
+    run_item(&job, 0);
+    while (__atomic_load_n(&job.remaining, __ATOMIC_ACQUIRE) > 0) {
+        pool_job_t* other;
+        int index;
+        if (queue_pop(&other, &index)) break;
+        run_item(other, index);
+    }
+
+    // 3. Wait for the ones still running on workers
+    pthread_mutex_lock(&job.lock);
+    while (!job.done) pthread_cond_wait(&job.cond, &job.lock);
+    pthread_mutex_unlock(&job.lock);
+
+    pthread_mutex_destroy(&job.lock);
+    pthread_cond_destroy(&job.cond);
+}
+
+static int take_own(steal_share_t* share, uint32_t* task) {
+    uint64_t r = __atomic_load_n(&share->range, __ATOMIC_ACQUIRE);
+    while (SHARE_LEFT(r)) {
+        if (__atomic_compare_exchange_n(&share->range, &r, SHARE(SHARE_LO(r) + 1, SHARE_HI(r)), 0,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            *task = SHARE_LO(r);
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static int task_at(const steal_job_t* job, uint32_t pos) {
+    return job->order ? job->order[pos] : (int)pos;
+}
+
+// Node of the tasks a share holds (a share never spans two nodes' groups, but stolen halves move)
+static int share_node(const steal_job_t* job, uint64_t r) {
+    if (!job->nodes) return 0;
+    int node = job->nodes[task_at(job, SHARE_HI(r) - 1)];
+    return node >= 0 && node < job->nnodes ? node : 0;
+}
+
+// The back half (rounded up) of the largest share left becomes the thief's own; -1 once all are empty.
+// Shares of the thief's own node go first, so remote pages are only read once the local ones are done.
+// Tasks taken by a thief that has not stored them yet are invisible, but that thief runs them.
+static int steal(steal_job_t* job, int self, int node) {
+    for (;;) {
+        int victim = -1, local = 0;
+        uint64_t vr = 0;
+        for (int i = 0; i < job->nshares; i++) {
+            if (i == self) continue;
+            uint64_t r = __atomic_load_n(&job->shares[i].range, __ATOMIC_ACQUIRE);
+            if (!SHARE_LEFT(r)) continue;
+
+            int same = share_node(job, r) == node;
+            if (same > local || (same == local && SHARE_LEFT(r) > SHARE_LEFT(vr))) {
+                victim = i;
+                vr = r;
+                local = same;
+            }
+        }
+        if (victim < 0) return -1;
+
+        uint32_t lo = SHARE_LO(vr), hi = SHARE_HI(vr);
+        uint32_t mid = hi - (hi - lo + 1) / 2;
+        if (__atomic_compare_exchange_n(&job->shares[victim].range, &vr, SHARE(lo, mid), 0,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            __atomic_store_n(&job->shares[self].range, SHARE(mid, hi), __ATOMIC_RELEASE);
+            return 0;
+        }
+    }
+}
+
+// An unclaimed share of the runner's node, else of the nearest node that has one, else a spare
+static int claim_share(steal_job_t* job, int node) {
+    for (int k = 0; k < job->nnodes; k++) {
+        int n = (node + k) % job->nnodes;
+        int idx = __atomic_fetch_add(&job->node_next[n], 1, __ATOMIC_RELAXED);
+        if (idx < job->node_shares[n]) return job->node_first[n] + idx;
+    }
+    return job->node_first[job->nnodes] + __atomic_fetch_add(&job->spare_next, 1, __ATOMIC_RELAXED);
+}
+
+static void steal_runner(void* arg) {
+    steal_job_t* job = (steal_job_t*)arg;
+    int node = 0;
+    if (job->nnodes > 1) node = t_node >= 0 ? t_node : fs_numa_current_node();
+    int self = claim_share(job, node);
+
+    for (;;) {
+        uint32_t task;
+        if (take_own(&job->shares[self], &task) == 0) {
+            job->fn(job->args + (size_t)task_at(job, task) * job->stride);
+        } else if (steal(job, self, node)) {
+            return;
+        }
+    }
+}
+
+void fs_pool_run_tasks(fs_task_fn fn, void* args, size_t stride, int tasks, int runners, const int* nodes) {
+    if (runners > tasks) runners = tasks;
+    if (runners > FS_POOL_MAX_WORKERS) runners = FS_POOL_MAX_WORKERS;
+    if (runners <= 1 || fs_pool_size() == 0) {
+        for (int i = 0; i < tasks; i++) fn((char*)args + (size_t)i * stride);
+        return;
+    }
+
+    steal_job_t job;
+    memset(&job, 0, sizeof(job));
+    job.fn = fn;
+    job.args = (char*)args;
+    job.stride = stride;
+    job.nnodes = nodes ? fs_numa_nodes() : 1;
+
+    int* order = NULL;
+    if (job.nnodes > 1 && !(order = (int*)malloc((size_t)tasks * sizeof(int)))) job.nnodes = 1;
+
+    // 1. Tasks grouped by node, in file order within each group
+    int count[FS_NUMA_MAX_NODES] = { 0 };
+    int group[FS_NUMA_MAX_NODES];
+    if (job.nnodes > 1) {
+        for (int i = 0; i < tasks; i++) count[nodes[i] >= 0 && nodes[i] < job.nnodes ? nodes[i] : 0]++;
+        for (int n = 0, pos = 0; n < job.nnodes; pos += count[n++]) group[n] = pos;
+        for (int i = 0; i < tasks; i++) order[group[nodes[i] >= 0 && nodes[i] < job.nnodes ? nodes[i] : 0]++] = i;
+        for (int n = 0; n < job.nnodes; n++) group[n] -= count[n];
+        job.order = order;
+        job.nodes = nodes;
+    } else {
+        count[0] = tasks;
+        group[0] = 0;
+    }
+
+    // 2. Each group split among about as many runners as its share of the tasks
+    int nshares = 0;
+    for (int n = 0; n < job.nnodes; n++) {
+        job.node_first[n] = nshares;
+        job.node_shares[n] = count[n] ? (int)((int64_t)runners * count[n] / tasks) : 0;
+        if (count[n] && job.node_shares[n] == 0) job.node_shares[n] = 1;
+        nshares += job.node_shares[n];
+    }
+    job.node_first[job.nnodes] = nshares;
+    if (job.nnodes > 1) nshares += runners;
+
+    steal_share_t shares[nshares];
+    for (int n = 0; n < job.nnodes; n++) {
+        int k = job.node_shares[n];
+        for (int j = 0; j < k; j++) {
+            shares[job.node_first[n] + j].range = SHARE(group[n] + (int64_t)count[n] * j / k,
+                                                        group[n] + (int64_t)count[n] * (j + 1) / k);
+        }
+    }
+    for (int s = job.node_first[job.nnodes]; s < nshares; s++) shares[s].range = SHARE(0, 0);
+    job.shares = shares;
+    job.nshares = nshares;
+
+    // Every runner gets the same job and claims its share once it runs
+    fs_pool_run(steal_runner, &job, 0, runners);
+    free(order);
+}
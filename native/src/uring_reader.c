@@ -0,0 +1,385 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "uring_reader.h"
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define FS_HAVE_URING 1
+#endif
+#endif
+
+#ifdef FS_HAVE_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+typedef enum { BUF_FREE, BUF_READING, BUF_READY, BUF_SCANNING } buf_state_t;
+
+typedef struct {
+    fs_byte_t* data;
+    fs_size_t index;
+    fs_size_t want;         // Bytes this block's read asks for
+    fs_size_t got;
+    buf_state_t state;
+} uring_buf_t;
+
+struct fs_uring {
+    int ring;
+    int fd;
+    int own_fd;             // The O_DIRECT descriptor, closed by fs_uring_finish (-1: none)
+    int direct;
+
+    fs_size_t size;
+    fs_size_t span;         // FS_URING_BLOCK plus the overlap, aligned
+    fs_size_t nblocks;
+    fs_size_t next_block;   // Next one to read
+    fs_size_t limit;        // Blocks past it are not read
+
+    // Rings shared with the kernel
+    void* sq_ring;
+    size_t sq_ring_size;
+    void* cq_ring;
+    size_t cq_ring_size;
+    struct io_uring_sqe* sqes;
+    size_t sqes_size;
+    unsigned* sq_tail;
+    unsigned* sq_mask;
+    unsigned* sq_array;
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    unsigned* cq_mask;
+    struct io_uring_cqe* cqes;
+
+    uring_buf_t* bufs;
+    int depth;
+    int* ready;             // FIFO of buffers whose block is complete
+    int ready_head;
+    int ready_count;
+    int inflight;           // Reads queued or submitted and not completed
+    unsigned queued;        // Of those, still in the submission ring
+
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int reaping;            // A thread waits in io_uring_enter; the others wait on cond
+    int draining;           // fs_uring_finish: nothing is read any more
+    int error;              // errno of a failed read
+};
+
+static int sys_setup(unsigned entries, struct io_uring_params* p) {
+    return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int sys_enter(int ring, unsigned submit, unsigned min_complete, unsigned flags) {
+    return (int)syscall(__NR_io_uring_enter, ring, submit, min_complete, flags, NULL, 0);
+}
+
+static pthread_once_t g_probe_once = PTHREAD_ONCE_INIT;
+static int g_available;
+
+// IORING_OP_READ needs 5.6, the first kernel to report IORING_FEAT_RW_CUR_POS
+static void probe_once(void) {
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    int ring = sys_setup(2, &p);
+    if (ring < 0) return;
+    g_available = (p.features & IORING_FEAT_RW_CUR_POS) != 0;
+    close(ring);
+}
+
+int fs_uring_available(void) {
+    pthread_once(&g_probe_once, probe_once);
+    return g_available;
+}
+
+static int map_rings(fs_uring_t* u, const struct io_uring_params* p) {
+    u->sq_ring_size = p->sq_off.array + p->sq_entries * sizeof(unsigned);
+    u->cq_ring_size = p->cq_off.cqes + p->cq_entries * sizeof(struct io_uring_cqe);
+    if (p->features & IORING_FEAT_SINGLE_MMAP) {
+        if (u->cq_ring_size > u->sq_ring_size) u->sq_ring_size = u->cq_ring_size;
+        u->cq_ring_size = u->sq_ring_size;
+    }
+
+    u->sq_ring = mmap(NULL, u->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->ring, IORING_OFF_SQ_RING);
+    if (u->sq_ring == MAP_FAILED) return -1;
+    if (p->features & IORING_FEAT_SINGLE_MMAP) {
+        u->cq_ring = u->sq_ring;
+    } else {
+        u->cq_ring = mmap(NULL, u->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->ring, IORING_OFF_CQ_RING);
+        if (u->cq_ring == MAP_FAILED) return -1;
+    }
+    u->sqes_size = p->sq_entries * sizeof(struct io_uring_sqe);
+    u->sqes = (struct io_uring_sqe*)mmap(NULL, u->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                         u->ring, IORING_OFF_SQES);
+    if (u->sqes == MAP_FAILED) return -1;
+
+    char* sq = (char*)u->sq_ring;
+    char* cq = (char*)u->cq_ring;
+    u->sq_tail = (unsigned*)(sq + p->sq_off.tail);
+    u->sq_mask = (unsigned*)(sq + p->sq_off.ring_mask);
+    u->sq_array = (unsigned*)(sq + p->sq_off.array);
+    u->cq_head = (unsigned*)(cq + p->cq_off.head);
+    u->cq_tail = (unsigned*)(cq + p->cq_off.tail);
+    u->cq_mask = (unsigned*)(cq + p->cq_off.ring_mask);
+    u->cqes = (struct io_uring_cqe*)(cq + p->cq_off.cqes);
+    return 0;
+}
+
+static void unmap_rings(fs_uring_t* u) {
+    if (u->sqes && u->sqes != MAP_FAILED) munmap(u->sqes, u->sqes_size);
+    if (u->cq_ring && u->cq_ring != MAP_FAILED && u->cq_ring != u->sq_ring) munmap(u->cq_ring, u->cq_ring_size);
+    if (u->sq_ring && u->sq_ring != MAP_FAILED) munmap(u->sq_ring, u->sq_ring_size);
+}
+
+// Queues the read of what buffer b still lacks (under the lock); the caller submits
+static void prep_read(fs_uring_t* u, int b) {
+    uring_buf_t* buf = &u->bufs[b];
+    fs_size_t len = buf->want - buf->got;
+    if (u->direct) len = (len + FS_MEMORY_ALIGNMENT - 1) / FS_MEMORY_ALIGNMENT * FS_MEMORY_ALIGNMENT;
+
+    unsigned tail = *u->sq_tail;
+    unsigned slot = tail & *u->sq_mask;
+    struct io_uring_sqe* sqe = &u->sqes[slot];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = u->fd;
+    sqe->addr = (uint64_t)(uintptr_t)(buf->data + buf->got);
+    sqe->len = (uint32_t)len;
+    sqe->off = (uint64_t)(buf->index * FS_URING_BLOCK + buf->got);
+    sqe->user_data = (uint64_t)b;
+    u->sq_array[slot] = slot;
+    __atomic_store_n(u->sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+    buf->state = BUF_READING;
+    u->inflight++;
+    u->queued++;
+}
+
+static void submit(fs_uring_t* u) {
+    while (u->queued > 0 && !u->error) {
+        int done = sys_enter(u->ring, u->queued, 0, 0);
+        if (done < 0 && (errno == EINTR || errno == EAGAIN)) continue;
+        if (done <= 0) {
+            u->error = done < 0 ? errno : EIO;
+            return;
+        }
+        u->queued -= (unsigned)done;
+    }
+}
+
+// Starts reads into every free buffer, in file order, while blocks remain (under the lock)
+static void refill(fs_uring_t* u) {
+    for (int b = 0; b < u->depth && u->next_block < u->limit && !u->error; b++) {
+        uring_buf_t* buf = &u->bufs[b];
+        if (buf->state != BUF_FREE) continue;
+
+        fs_size_t off = u->next_block * FS_URING_BLOCK;
+        buf->index = u->next_block++;
+        buf->want = u->size - off < u->span ? u->size - off : u->span;
+        buf->got = 0;
+        prep_read(u, b);
+    }
+    submit(u);
+}
+
+// Moves completed reads to the ready list (under the lock); a short read continues where it stopped
+static void reap(fs_uring_t* u) {
+    unsigned head = *u->cq_head;
+    unsigned tail = __atomic_load_n(u->cq_tail, __ATOMIC_ACQUIRE);
+
+    for (; head != tail; head++) {
+        const struct io_uring_cqe* cqe = &u->cqes[head & *u->cq_mask];
+        int b = (int)cqe->user_data;
+        uring_buf_t* buf = &u->bufs[b];
+        int res = cqe->res;
+        u->inflight--;
+
+        int retry = !u->error && !u->draining;
+        if (res == -EINTR || res == -EAGAIN) {
+            if (retry) prep_read(u, b);
+            else buf->state = BUF_FREE;
+            continue;
+        }
+        if (res < 0) {
+            if (!u->error) u->error = -res;
+            buf->state = BUF_FREE;
+            continue;
+        }
+
+        buf->got += (fs_size_t)res;
+        if (buf->got > buf->want) buf->got = buf->want;
+
+        // Buffered reads may stop short; direct ones only at the end of the file (or the data is gone)
+        if (res > 0 && buf->got < buf->want && (!u->direct || buf->got % FS_MEMORY_ALIGNMENT == 0)) {
+            if (retry) prep_read(u, b);
+            else buf->state = BUF_FREE;
+            continue;
+        }
+        if (buf->got < buf->want && !u->error) u->error = EIO;   // The file shrank while it was read
+
+        buf->state = BUF_READY;
+        u->ready[(u->ready_head + u->ready_count++) % u->depth] = b;
+    }
+    __atomic_store_n(u->cq_head, head, __ATOMIC_RELEASE);
+    submit(u);
+}
+
+fs_uring_t* fs_uring_start(int fd, fs_size_t size, fs_size_t overlap, int depth, int direct) {
+    if (!fs_uring_available() || fd < 0 || size == 0) return NULL;
+    if (depth < FS_URING_MIN_DEPTH) depth = FS_URING_MIN_DEPTH;
+    if (depth > FS_URING_MAX_DEPTH) depth = FS_URING_MAX_DEPTH;
+
+    fs_uring_t* u = (fs_uring_t*)calloc(1, sizeof(fs_uring_t));
+    if (!u) return NULL;
+    u->ring = -1;
+    u->fd = fd;
+    u->own_fd = -1;
+    u->size = size;
+    u->span = FS_URING_BLOCK + (overlap + FS_MEMORY_ALIGNMENT - 1) / FS_MEMORY_ALIGNMENT * FS_MEMORY_ALIGNMENT;
+    u->nblocks = (size + FS_URING_BLOCK - 1) / FS_URING_BLOCK;
+    u->limit = u->nblocks;
+    u->depth = depth;
+    pthread_mutex_init(&u->lock, NULL);
+    pthread_cond_init(&u->cond, NULL);
+
+    // A descriptor of its own: O_DIRECT is a property of the open file, which the mapping shares
+    if (direct) {
+        char path[64];
+        snprintf(path, sizeof(path), "/proc/self/fd/%d", fd);
+        u->own_fd = open(path, O_RDONLY | O_DIRECT);
+        if (u->own_fd >= 0) {
+            u->fd = u->own_fd;
+            u->direct = 1;
+        }
+    }
+
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    u->ring = sys_setup((unsigned)depth, &p);
+    u->bufs = (uring_buf_t*)calloc((size_t)depth, sizeof(uring_buf_t));
+    u->ready = (int*)malloc((size_t)depth * sizeof(int));
+    int ok = u->ring >= 0 && u->bufs && u->ready && map_rings(u, &p) == 0;
+    for (int b = 0; ok && b < depth; b++) {
+        ok = posix_memalign((void**)&u->bufs[b].data, FS_MEMORY_ALIGNMENT, u->span) == 0;
+        if (!ok) u->bufs[b].data = NULL;
+    }
+    if (!ok) {
+        fs_uring_finish(u);
+        return NULL;
+    }
+
+    pthread_mutex_lock(&u->lock);
+    refill(u);
+    pthread_mutex_unlock(&u->lock);
+    return u;
+}
+
+int fs_uring_next(fs_uring_t* u, fs_uring_block_t* out) {
+    pthread_mutex_lock(&u->lock);
+    for (;;) {
+        if (!u->reaping) reap(u);
+        if (u->ready_count && !u->error) {
+            int b = u->ready[u->ready_head];
+            u->ready_head = (u->ready_head + 1) % u->depth;
+            u->ready_count--;
+            uring_buf_t* buf = &u->bufs[b];
+            buf->state = BUF_SCANNING;
+
+            out->data = buf->data;
+            out->index = buf->index;
+            out->len = buf->got;
+            out->own = buf->got < FS_URING_BLOCK ? buf->got : FS_URING_BLOCK;
+            out->buf = b;
+            pthread_mutex_unlock(&u->lock);
+            return 1;
+        }
+
+        refill(u);
+        if (u->inflight == 0 || u->error) {
+            pthread_mutex_unlock(&u->lock);
+            return 0;
+        }
+        if (u->reaping) {
+            pthread_cond_wait(&u->cond, &u->lock);
+            continue;
+        }
+
+        // This thread waits for the kernel; the others wait for it
+        u->reaping = 1;
+        pthread_mutex_unlock(&u->lock);
+        sys_enter(u->ring, 0, 1, IORING_ENTER_GETEVENTS);
+        pthread_mutex_lock(&u->lock);
+        u->reaping = 0;
+        reap(u);
+        pthread_cond_broadcast(&u->cond);
+    }
+}
+
+void fs_uring_done(fs_uring_t* u, const fs_uring_block_t* block) {
+    pthread_mutex_lock(&u->lock);
+    u->bufs[block->buf].state = BUF_FREE;
+    pthread_mutex_unlock(&u->lock);
+}
+
+void fs_uring_limit(fs_uring_t* u, fs_size_t blocks) {
+    pthread_mutex_lock(&u->lock);
+    if (blocks < u->limit) u->limit = blocks;
+    pthread_mutex_unlock(&u->lock);
+}
+
+void fs_uring_stop(fs_uring_t* u) {
+    fs_uring_limit(u, 0);
+}
+
+fs_status_t fs_uring_finish(fs_uring_t* u) {
+    if (!u) return FS_SUCCESS;
+
+    // The kernel may still write into the buffers until their reads complete
+    if (u->ring >= 0 && u->sqes && u->sqes != MAP_FAILED) {
+        pthread_mutex_lock(&u->lock);
+        u->limit = 0;
+        u->draining = 1;
+
+        // Reads the kernel has not taken are dropped; the rest must complete
+        u->inflight -= (int)u->queued;
+        u->queued = 0;
+        while (u->inflight > 0) {
+            pthread_mutex_unlock(&u->lock);
+            sys_enter(u->ring, 0, 1, IORING_ENTER_GETEVENTS);
+            pthread_mutex_lock(&u->lock);
+            reap(u);
+        }
+        pthread_mutex_unlock(&u->lock);
+    }
+
+    fs_status_t status = u->error ? FS_ERROR_READ_FAILED : FS_SUCCESS;
+    unmap_rings(u);
+    if (u->ring >= 0) close(u->ring);
+    if (u->own_fd >= 0) close(u->own_fd);
+    for (int b = 0; u->bufs && b < u->depth; b++) free(u->bufs[b].data);
+    free(u->bufs);
+    free(u->ready);
+    pthread_mutex_destroy(&u->lock);
+    pthread_cond_destroy(&u->cond);
+    free(u);
+    return status;
+}
+
+#else
+
+int fs_uring_available(void) { return 0; }
+fs_uring_t* fs_uring_start(int fd, fs_size_t size, fs_size_t overlap, int depth, int direct) {
+    (void)fd; (void)size; (void)overlap; (void)depth; (void)direct;
+    return NULL;
+}
+int fs_uring_next(fs_uring_t* u, fs_uring_block_t* out) { (void)u; (void)out; return 0; }
+void fs_uring_done(fs_uring_t* u, const fs_uring_block_t* block) { (void)u; (void)block; }
+void fs_uring_limit(fs_uring_t* u, fs_size_t blocks) { (void)u; (void)blocks; }
+void fs_uring_stop(fs_uring_t* u) { (void)u; }
+fs_status_t fs_uring_finish(fs_uring_t* u) { (void)u; return FS_SUCCESS; }
+
+#endif
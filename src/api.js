@@ -1,5 +1,7 @@
 const fs = require('fs');
 const errors = require('./errors');
+const { nativePattern } = require('./pattern');
+const { validatePattern, validateTarget } = require('./validate');
 
 // FIX: Require the Native Addon directly to avoid Circular Dependency with index.js
 // The path is relative to the 'src' folder
@@ -36,15 +38,15 @@ function readContext(filepath, offset, beforeBytes, afterBytes) {
  * Advanced API: Search and return text surrounding matches
  * 
  * @param {string} filepath - Path to file
- * @param {string} pattern - Pattern to find
- * @param {object} options - { maxMatches, contextSize }
+ * @param {string|Pattern} pattern - Pattern to find
+ * @param {object} options - { maxMatches, contextSize, threads }
  * @returns {Promise<Array<{offset: number, snippet: string}>>}
  */
 async function scanWithContext(filepath, pattern, options = {}) {
-    const { maxMatches = 100, contextSize = 50 } = options;
+    const { maxMatches = 100, contextSize = 50, threads } = options;
     
     // 1. Get Raw Offsets directly from Native Addon (Fast C Scan)
-    const offsets = addon.scanFile(filepath, pattern, maxMatches);
+    const offsets = addon.scanFile(filepath, nativePattern(pattern), maxMatches, { threads });
     
     // 2. Enrich with context (JS IO)
     const results = [];
@@ -56,28 +58,99 @@ async function scanWithContext(filepath, pattern, options = {}) {
     return results;
 }
 
+/**
+ * Advanced API: Stream the matches of a scan as they are found, in file order.
+ * Yields batches of up to 64K offsets (BigUint64Array, or { offsets, patternIds }
+ * for a pattern list; longer only when a list matches more times than that at
+ * one offset, whose entries always share a batch). The native scan runs on its
+ * own threads at most 4 batches ahead of the consumer, so memory stays bounded
+ * however many matches there are. Leaving the loop early, or aborting options.signal, stops the scan.
+ *
+ * @param {string} filepath - Path to file
+ * @param {string|Pattern} pattern - Pattern to find, or any compiled Pattern but a line-mode one
+ * @param {number} [maxMatches=Infinity] - Matches in the whole stream
+ * @param {object} [options] - { threads, sampleFrequencies, signal }
+ */
+async function* scanBatches(filepath, pattern, maxMatches = Infinity, options = {}) {
+    validateTarget(filepath, options);
+    const target = validatePattern(pattern);
+    if (typeof maxMatches !== 'number' || !(maxMatches > 0)) {
+        throw new errors.InvalidArgumentError('maxMatches must be a positive number');
+    }
+    const { signal } = options;
+    if (signal && signal.aborted) throw new errors.AbortError(signal.reason);
+
+    const ready = [];
+    let done = false;
+    let failure = null;
+    let wake = null;
+    const notify = () => {
+        if (wake) wake();
+        wake = null;
+    };
+
+    let handle;
+    try {
+        handle = addon.scanStream(filepath, target, options, maxMatches, (err, offsets, patternIds) => {
+            if (offsets === undefined) {
+                done = true;
+                if (err && !failure) failure = new (errors.ERROR_MAP[err] || errors.FastScanError)(err);
+            } else {
+                ready.push(patternIds ? { offsets, patternIds } : offsets);
+            }
+            notify();
+        });
+    } catch (err) {
+        throw new (errors.ERROR_MAP[err.message] || errors.FastScanError)(err.message);
+    }
+
+    const onAbort = () => {
+        failure = new errors.AbortError(signal.reason);
+        addon.streamClose(handle);
+        notify();
+    };
+    if (signal) signal.addEventListener('abort', onAbort, { once: true });
+
+    try {
+        for (;;) {
+            if (failure) throw failure;
+            if (ready.length) {
+                yield ready.shift();
+                // Consumed: the scan may run one batch further
+                addon.streamAck(handle);
+            } else if (done) {
+                return;
+            } else {
+                await new Promise(resolve => { wake = resolve; });
+            }
+        }
+    } finally {
+        if (signal) signal.removeEventListener('abort', onAbort);
+        addon.streamClose(handle);
+    }
+}
+
 /**
  * Advanced API: Create an Async Iterator for huge files
- * Useful for processing results as they arrive (simulated via chunking)
- * Note: Since our C implementation returns all offsets at once, this is a wrapper
- * for convenience to allow async/await loops.
+ * Yields one match at a time ({ index, offset }, plus patternId for a pattern
+ * list) from the batches of scanBatches, so the first ones arrive while the
+ * rest of the file is still being scanned.
  */
-async function* scanIterator(filepath, pattern, maxMatches = 100000) {
-    // Get offsets directly from Native Addon
-    const offsets = addon.scanFile(filepath, pattern, maxMatches);
-    
-    for (let i = 0; i < offsets.length; i++) {
-        yield {
-            index: i,
-            offset: offsets[i],
-            // You could add lazy context loading here
-        };
-        // Simulate async flow if needed
-        await setImmediate(); 
+async function* scanIterator(filepath, pattern, maxMatches = 100000, options = {}) {
+    let index = 0;
+    for await (const batch of scanBatches(filepath, pattern, maxMatches, options)) {
+        const offsets = batch.offsets || batch;
+        const ids = batch.patternIds;
+        for (let i = 0; i < offsets.length; i++) {
+            yield ids
+                ? { index: index++, offset: offsets[i], patternId: ids[i] }
+                : { index: index++, offset: offsets[i] };
+        }
     }
 }
 
 module.exports = {
     scanWithContext,
-    scanIterator
+    scanIterator,
+    scanBatches
 };
@@ -41,10 +41,41 @@ class MappingError extends FastScanError {
     }
 }
 
+class ReadError extends FastScanError {
+    constructor(message) {
+        super(`Failed to read input: ${message}`, 'FS_READ_FAILED', 'read');
+        this.name = 'ReadError';
+    }
+}
+
+class AbortError extends FastScanError {
+    constructor(reason) {
+        super('The scan was aborted', 'ABORT_ERR', 'scan');
+        this.name = 'AbortError';
+        if (reason !== undefined) this.cause = reason;
+    }
+}
+
+// Map C Error Codes to JS Error Classes
+const ERROR_MAP = {
+    'File not found': FileNotFoundError,
+    'Memory mapping failed': MappingError,
+    'Read failed': ReadError,
+    'Buffer allocation failed': MemoryError,
+    'Invalid dictionary': InvalidArgumentError,
+    'Invalid regular expression': InvalidArgumentError,
+    'Invalid pattern': InvalidArgumentError,
+    'Pattern too long': InvalidArgumentError
+
+};
+
 module.exports = {
+    ERROR_MAP,
     FastScanError,
     FileNotFoundError,
     MemoryError,
     InvalidArgumentError,
-    MappingError
+    MappingError,
+    ReadError,
+    AbortError
 };
@@ -2,35 +2,176 @@
 const addon = require('bindings')('fastscan.node'); 
 
 const { 
+    ERROR_MAP,
     FastScanError, 
     FileNotFoundError, 
     MemoryError, 
     InvalidArgumentError,
-    MappingError 
+    MappingError,
+    AbortError
 } = require('./errors');
-const { scanWithContext, scanIterator } = require('./api');
+const { scanWithContext, scanIterator, scanBatches } = require('./api');
+const { Pattern, Dictionary } = require('./pattern');
+const { validatePattern, validateTarget } = require('./validate');
 
-// Map C Error Codes to JS Error Classes
-const ERROR_MAP = {
-    'File not found': FileNotFoundError,
-    'Memory mapping failed': MappingError,
-    'Buffer allocation failed': MemoryError
+// Pattern ids share a 64-bit match with the offset (native FS_DICT_MAX_PATTERNS)
+const MAX_MULTI_PATTERNS = 1 << 20;
 
-};
+/**
+ * Internal helper to validate input arguments; returns what the addon takes for the pattern
+ */
+function validate(filepath, pattern, maxMatches, options = {}) {
+    validateCommon(filepath, maxMatches, options);
+    return validatePattern(pattern);
+}
+
+function validateCommon(filepath, maxMatches, options) {
+    validateTarget(filepath, options);
+    if (typeof maxMatches !== 'number' || maxMatches <= 0) {
+        throw new InvalidArgumentError('maxMatches must be a positive number');
+    }
+}
 
 /**
- * Internal helper to validate input arguments
+ * Starts an async native scan and maps its errors. An options.signal becomes a
+ * flag the native tasks read every 256KB; aborting rejects with AbortError once
+ * they have stopped and freed their partial results. Progress reports still in
+ * flight when the promise settles are dropped.
  */
-function validate(filepath, pattern, maxMatches) {
+function runAsync(options, start) {
+    const { signal, onProgress } = options;
+    if (onProgress) {
+        let settled = false;
+        const report = progress => { if (!settled) onProgress(progress); };
+        const pending = runAsync({ ...options, onProgress: undefined }, opts => start({ ...opts, onProgress: report }));
+        pending.then(() => { settled = true; }, () => { settled = true; });
+        return pending;
+    }
+    if (!signal) {
+        return start(options).catch(err => {
+            const ErrorClass = ERROR_MAP[err.message] || FastScanError;
+            throw new ErrorClass(err.message);
+        });
+    }
+    if (signal.aborted) return Promise.reject(new AbortError(signal.reason));
+
+    const cancel = new Int32Array(1);
+    const onAbort = () => Atomics.store(cancel, 0, 1);
+    signal.addEventListener('abort', onAbort, { once: true });
+
+    let pending;
+    try {
+        pending = start({ ...options, cancel });
+    } catch (err) {
+        signal.removeEventListener('abort', onAbort);
+        throw err;
+    }
+    return pending.catch(err => {
+        if (err === 'Scan aborted' || err.message === 'Scan aborted') throw new AbortError(signal.reason);
+        const ErrorClass = ERROR_MAP[err.message] || FastScanError;
+        throw new ErrorClass(err.message);
+    }).finally(() => signal.removeEventListener('abort', onAbort));
+}
+
+/**
+ * Builds a dictionary from a newline-separated pattern file.
+ * The pattern on line i (0-based) is reported as patternId i; empty lines never match.
+ *
+ * @param {string} filepath - Pattern file.
+ * @returns {Dictionary}
+ */
+function loadDictionary(filepath) {
     if (!filepath || typeof filepath !== 'string') {
         throw new InvalidArgumentError('Filepath must be a string');
     }
-    if (!pattern || typeof pattern !== 'string') {
-        throw new InvalidArgumentError('Pattern must be a string');
+    try {
+        return new Dictionary(addon.loadDictionary(filepath));
+    } catch (err) {
+        const ErrorClass = ERROR_MAP[err.message] || FastScanError;
+        throw new ErrorClass(err.message);
     }
-    if (typeof maxMatches !== 'number' || maxMatches <= 0) {
-        throw new InvalidArgumentError('maxMatches must be a positive number');
+}
+
+/**
+ * Validates the pattern list of the multi-pattern API; returns what the addon takes
+ */
+function validatePatterns(patterns) {
+    if (patterns instanceof Pattern) {
+        if (patterns.kind !== 'multi') {
+            throw new InvalidArgumentError('Compiled pattern must be a pattern list');
+        }
+        return patterns._handle;
+    }
+    if (!Array.isArray(patterns) || patterns.length === 0) {
+        throw new InvalidArgumentError('patterns must be a non-empty array');
+    }
+    if (patterns.length > MAX_MULTI_PATTERNS) {
+        throw new InvalidArgumentError(`At most ${MAX_MULTI_PATTERNS} patterns per scan`);
+    }
+    for (const p of patterns) {
+        if (!p || typeof p !== 'string') {
+            throw new InvalidArgumentError('Every pattern must be a non-empty string');
+        }
+    }
+    return patterns;
+}
+
+// Flags that do not change what the native engine matches (lines are always the unit)
+const REGEX_FLAGS = /^[gmy]*$/;
+
+/**
+ * Accepts a string or a RegExp; returns the source handed to the addon
+ */
+function validateRegex(regex) {
+    if (regex instanceof Pattern) {
+        if (regex.kind !== 'regex') {
+            throw new InvalidArgumentError('Compiled pattern must be a regular expression');
+        }
+        return regex._handle;
+    }
+    if (regex instanceof RegExp) {
+        if (!REGEX_FLAGS.test(regex.flags)) {
+            throw new InvalidArgumentError(`Unsupported regular expression flags: ${regex.flags}`);
+        }
+        return regex.source;
+    }
+    if (!regex || typeof regex !== 'string') {
+        throw new InvalidArgumentError('Regex must be a string or a RegExp');
     }
+    return regex;
+}
+
+/**
+ * Prepares a pattern once for many scans, so each call skips the pattern copy,
+ * length class and rare-byte selection, table building or regex compilation.
+ *
+ * @param {string|string[]|RegExp} pattern - A literal, a literal list (same ids as
+ *   scanFileMulti) or a regular expression.
+ * @param {object} [options] - { regex: treat a string pattern as a regular expression }
+ * @returns {Pattern}
+ */
+function compile(pattern, options = {}) {
+    if (options === null || typeof options !== 'object') {
+        throw new InvalidArgumentError('options must be an object');
+    }
+    let native;
+    try {
+        if (pattern instanceof RegExp || options.regex) {
+            native = addon.compile(validateRegex(pattern), true);
+        } else if (Array.isArray(pattern)) {
+            native = addon.compile(validatePatterns(pattern), false);
+        } else {
+            if (!pattern || typeof pattern !== 'string') {
+                throw new InvalidArgumentError('Pattern must be a string, an array of strings or a RegExp');
+            }
+            native = addon.compile(pattern, false);
+        }
+    } catch (err) {
+        if (err instanceof FastScanError) throw err;
+        const ErrorClass = ERROR_MAP[err.message] || FastScanError;
+        throw new ErrorClass(err.message);
+    }
+    return new Pattern(native);
 }
 
 /**
@@ -38,16 +179,25 @@ function validate(filepath, pattern, maxMatches) {
  * WARNING: This function blocks the event loop. Use only for CLI tools or scripts.
  * 
  * @param {string} filepath - Absolute or relative path to file.
- * @param {string} pattern - The text pattern to search for.
+ * @param {string|Pattern} pattern - The text pattern to search for, or any compiled Pattern
+ *   (a 'multi' one returns the scanFileMulti result shape).
  * @param {number} maxMatches - Maximum number of matches to return.
+ * @param {object} [options] - { sampleFrequencies: pick prefilter bytes from a sample of the file,
+ *   threads: threads for this scan, the caller included (default: parallelism.threads),
+ *   io: how a regular file is read: 'mmap' (mapped whole and paged in), 'window' (256MB mapped
+ *   per thread at a time), 'once' (mapped, and the pages the scan reads in are evicted again behind
+ *   it, for background scans), 'uring' (io_uring reads into buffers), 'direct' (io_uring with O_DIRECT,
+ *   leaving the page cache alone) or 'auto' (default: io_uring for files of 64MB or more that are
+ *   mostly not cached, windows for files of 4GB or more). io_uring needs Linux 5.6. io_uring and
+ *   windows are used by literal and multi-pattern scans; regular expressions and lines map whole. }
  * @returns {BigUint64Array} - Array of byte offsets (Zero-Copy TypedArray)
  */
-function scanFile(filepath, pattern, maxMatches = 100000) {
-    validate(filepath, pattern, maxMatches);
+function scanFile(filepath, pattern, maxMatches = 100000, options = {}) {
+    const target = validate(filepath, pattern, maxMatches, options);
     
     try {
         // Native Call
-        const result = addon.scanFile(filepath, pattern, maxMatches);
+        const result = addon.scanFile(filepath, target, maxMatches, options);
         return result; // This is a BigUint64Array now (Efficient!)
     } catch (err) {
         // Enhance error handling
@@ -61,19 +211,171 @@ function scanFile(filepath, pattern, maxMatches = 100000) {
  * Ideal for Web Servers. Does not block the event loop.
  * 
  * @param {string} filepath - Absolute or relative path to file.
- * @param {string} pattern - The text pattern to search for.
+ * @param {string|Pattern} pattern - Same as scanFile.
  * @param {number} maxMatches - Maximum number of matches to return.
+ * @param {object} [options] - Same as scanFile, plus (for every async function)
+ *   signal: an AbortSignal that stops the scan (the promise then rejects with AbortError);
+ *   onProgress: called with { bytesScanned, totalBytes, matches } at most every
+ *   progressInterval ms (default 100), and once with bytesScanned === totalBytes at the end.
  * @returns {Promise<BigUint64Array>} - Resolves with an array of byte offsets.
  */
-function scanFileAsync(filepath, pattern, maxMatches = 100000) {
-    validate(filepath, pattern, maxMatches);
+function scanFileAsync(filepath, pattern, maxMatches = 100000, options = {}) {
+    const target = validate(filepath, pattern, maxMatches, options);
     
     // The native C addon directly creates and returns a Promise
     // We wrap it to catch errors and transform them to our classes
-    return addon.scanFileAsync(filepath, pattern, maxMatches).catch(err => {
+    return runAsync(options, opts => addon.scanFileAsync(filepath, target, maxMatches, opts));
+}
+
+/**
+ * Returns the lines that contain at least one match, like `grep -n`. A line
+ * with several matches is listed once. `ends` is the offset of the line's
+ * '\n' (or the file size for a last line without one); line numbers start at 1.
+ *
+ * @param {string} filepath - Absolute or relative path to file.
+ * @param {string|Pattern} pattern - The text pattern, or any compiled Pattern.
+ * @param {number} maxLines - Maximum number of lines to return.
+ * @param {object} [options] - Same as scanFile.
+ * @returns {{lineNumbers: BigUint64Array, starts: BigUint64Array, ends: BigUint64Array}}
+ */
+function scanFileLines(filepath, pattern, maxLines = 100000, options = {}) {
+    const target = validate(filepath, pattern, maxLines, options);
+
+    try {
+        return addon.scanFileLines(filepath, target, maxLines, options);
+    } catch (err) {
+        const ErrorClass = ERROR_MAP[err.message] || FastScanError;
+        throw new ErrorClass(err.message);
+    }
+}
+
+/**
+ * Async version of scanFileLines.
+ *
+ * @returns {Promise<{lineNumbers: BigUint64Array, starts: BigUint64Array, ends: BigUint64Array}>}
+ */
+function scanFileLinesAsync(filepath, pattern, maxLines = 100000, options = {}) {
+    const target = validate(filepath, pattern, maxLines, options);
+
+    return runAsync(options, opts => addon.scanFileLinesAsync(filepath, target, maxLines, opts));
+}
+
+/**
+ * Counts the matches in a file without collecting their offsets: there is no
+ * maxMatches cap and memory does not grow with the number of matches.
+ * Overlapping matches count separately, as in scanFile.
+ *
+ * @param {string} filepath - Absolute or relative path to file.
+ * @param {string|Pattern} pattern - The text pattern, or any compiled Pattern
+ *   (a 'multi' one counts every (offset, pattern) pair).
+ * @param {object} [options] - Same as scanFile.
+ * @returns {number}
+ */
+function countFile(filepath, pattern, options = {}) {
+    validateTarget(filepath, options);
+    const target = validatePattern(pattern);
+
+    try {
+        return addon.countFile(filepath, target, options);
+    } catch (err) {
+        const ErrorClass = ERROR_MAP[err.message] || FastScanError;
+        throw new ErrorClass(err.message);
+    }
+}
+
+/**
+ * Async version of countFile.
+ *
+ * @returns {Promise<number>}
+ */
+function countFileAsync(filepath, pattern, options = {}) {
+    validateTarget(filepath, options);
+    const target = validatePattern(pattern);
+
+    return runAsync(options, opts => addon.countFileAsync(filepath, target, opts));
+}
+
+/**
+ * Searches for several literals in a single pass over the file.
+ * Matches are ordered by offset; several patterns matching at one offset
+ * are listed in pattern order. maxMatches caps the total across patterns.
+ * Up to 64 patterns use a packed SIMD matcher; longer lists build a dictionary.
+ *
+ * @param {string} filepath - Absolute or relative path to file.
+ * @param {string[]|Pattern} patterns - Text patterns, a loaded Dictionary or a compiled list.
+ * @param {number} maxMatches - Maximum number of matches to return.
+ * @param {object} [options] - Same as scanFile.
+ * @returns {{offsets: BigUint64Array, patternIds: Uint32Array}} - patternIds[i] indexes `patterns`
+ */
+function scanFileMulti(filepath, patterns, maxMatches = 100000, options = {}) {
+    validateCommon(filepath, maxMatches, options);
+    const set = validatePatterns(patterns);
+
+    try {
+        return addon.scanFileMulti(filepath, set, maxMatches, options);
+    } catch (err) {
         const ErrorClass = ERROR_MAP[err.message] || FastScanError;
         throw new ErrorClass(err.message);
-    });
+    }
+}
+
+/**
+ * Async version of scanFileMulti.
+ *
+ * @returns {Promise<{offsets: BigUint64Array, patternIds: Uint32Array}>}
+ */
+function scanFileMultiAsync(filepath, patterns, maxMatches = 100000, options = {}) {
+    validateCommon(filepath, maxMatches, options);
+    const set = validatePatterns(patterns);
+
+    return runAsync(options, opts => addon.scanFileMultiAsync(filepath, set, maxMatches, opts));
+}
+
+/**
+ * Searches for a regular expression (JavaScript syntax, no backreferences,
+ * lookaround or \b). Matches never cross a newline: ^ and $ are line anchors
+ * and `.` takes any byte but '\n'. Returns the offset of every position where
+ * a match starts, like the overlapping matches of scanFile.
+ * Lines are only examined when they contain a literal every match needs.
+ *
+ * @param {string} filepath - Absolute or relative path to file.
+ * @param {string|RegExp|Pattern} regex - Expression; RegExp flags other than g/m/y are rejected.
+ * @param {number} maxMatches - Maximum number of matches to return.
+ * @param {object} [options] - Same as scanFile.
+ * @returns {BigUint64Array} - Array of byte offsets
+ */
+function scanFileRegex(filepath, regex, maxMatches = 100000, options = {}) {
+    validateCommon(filepath, maxMatches, options);
+    const source = validateRegex(regex);
+
+    try {
+        return addon.scanFileRegex(filepath, source, maxMatches, options);
+    } catch (err) {
+        const ErrorClass = ERROR_MAP[err.message] || FastScanError;
+        throw new ErrorClass(err.message);
+    }
+}
+
+/**
+ * Async version of scanFileRegex.
+ *
+ * @returns {Promise<BigUint64Array>}
+ */
+function scanFileRegexAsync(filepath, regex, maxMatches = 100000, options = {}) {
+    validateCommon(filepath, maxMatches, options);
+    const source = validateRegex(regex);
+
+    return runAsync(options, opts => addon.scanFileRegexAsync(filepath, source, maxMatches, opts));
+}
+
+/**
+ * Start the native worker pool now instead of on the first scan of a large file.
+ * Workers stay alive (sleeping when idle) for the life of the process.
+ *
+ * @returns {number} - Pool workers (0 on a single-core machine)
+ */
+function warmup() {
+    return addon.warmup();
 }
 
 // Export Main Features
@@ -81,15 +383,40 @@ module.exports = {
     // Core
     scanFile,
     scanFileAsync,
+    scanFileMulti,
+    scanFileMultiAsync,
+    scanFileRegex,
+    scanFileRegexAsync,
+    scanFileLines,
+    scanFileLinesAsync,
+    countFile,
+    countFileAsync,
+    loadDictionary,
+    compile,
+    warmup,
+    Pattern,
+    Dictionary,
     
     // High Level API
     scanWithContext,
     scanIterator,
+    scanBatches,
     
+    // Active SIMD kernel ("sse2" | "avx2" | "avx512bw")
+    simd: addon.simd,
+
+    // CPU ids of each NUMA node (one entry on single-node machines)
+    numaNodes: addon.numaNodes,
+
+    // CPUs scans may use: { online, affinity, quota, cores, effective, threads }. `effective` is the
+    // smallest of the affinity mask, the cgroup CPU quota and the physical cores; scans use `threads`.
+    parallelism: addon.parallelism,
+
     // Types (for instanceof checks)
     errors: {
         FastScanError,
         FileNotFoundError,
-        MemoryError
+        MemoryError,
+        AbortError
     }
 };
@@ -0,0 +1,34 @@
+/**
+ * A pattern prepared once and reused across scans: the kernel choice, the
+ * rare-byte pair and skip table of a literal, the tables of a literal list,
+ * or the automaton of a regular expression. Created by compile(); every scan
+ * function accepts it in place of its pattern argument.
+ *
+ * kind: 'literal' | 'multi' | 'regex'. Native memory is released when the
+ * object is garbage collected (pending async scans keep it alive).
+ */
+class Pattern {
+    constructor(native) {
+        this._handle = native.handle;
+        this.kind = native.kind;
+        this.size = native.size;          // Patterns in the set (1 unless kind is 'multi')
+        this.maxLength = native.maxLength; // Longest match in bytes; Infinity for regex
+    }
+}
+
+/**
+ * A literal set loaded once (e.g. ~500k IOC strings) and reused across scans.
+ * Created by loadDictionary(); a 'multi' Pattern, so it goes wherever an array of patterns does.
+ */
+class Dictionary extends Pattern {}
+
+// What the addon takes for a pattern argument
+function nativePattern(pattern) {
+    return pattern instanceof Pattern ? pattern._handle : pattern;
+}
+
+module.exports = {
+    Pattern,
+    Dictionary,
+    nativePattern
+};
@@ -0,0 +1,48 @@
+const { InvalidArgumentError } = require('./errors');
+const { Pattern } = require('./pattern');
+
+// How a regular file is read: see options.io of scanFile
+const IO_MODES = ['auto', 'mmap', 'uring', 'direct', 'window', 'once'];
+
+/**
+ * Argument checks shared by index.js and api.js; each throws InvalidArgumentError
+ */
+
+// Returns what the addon takes for the pattern
+function validatePattern(pattern) {
+    if (pattern instanceof Pattern) return pattern._handle;
+    if (!pattern || typeof pattern !== 'string') {
+        throw new InvalidArgumentError('Pattern must be a string or a compiled Pattern');
+    }
+    return pattern;
+}
+
+function validateTarget(filepath, options) {
+    if (!filepath || typeof filepath !== 'string') {
+        throw new InvalidArgumentError('Filepath must be a string');
+    }
+    if (options === null || typeof options !== 'object') {
+        throw new InvalidArgumentError('options must be an object');
+    }
+    if (options.threads !== undefined && !(Number.isInteger(options.threads) && options.threads > 0)) {
+        throw new InvalidArgumentError('options.threads must be a positive integer');
+    }
+    if (options.signal !== undefined && !(options.signal instanceof AbortSignal)) {
+        throw new InvalidArgumentError('options.signal must be an AbortSignal');
+    }
+    if (options.onProgress !== undefined && typeof options.onProgress !== 'function') {
+        throw new InvalidArgumentError('options.onProgress must be a function');
+    }
+    if (options.progressInterval !== undefined &&
+        !(Number.isInteger(options.progressInterval) && options.progressInterval > 0)) {
+        throw new InvalidArgumentError('options.progressInterval must be a positive integer');
+    }
+    if (options.io !== undefined && !IO_MODES.includes(options.io)) {
+        throw new InvalidArgumentError(`options.io must be one of ${IO_MODES.join(', ')}`);
+    }
+}
+
+module.exports = {
+    validatePattern,
+    validateTarget
+};
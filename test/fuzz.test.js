@@ -0,0 +1,532 @@
+/**
+ * Differential fuzz test: every scan kernel against Buffer.indexOf.
+ * Covers all pattern length classes, tiny/odd file sizes (scalar tails),
+ * files big enough for the multi-threaded path, multi-pattern sets and
+ * regular expressions (against RegExp, line by line).
+ *
+ * Run with FASTSCAN_ISA=sse2|avx2 to exercise the narrower kernels.
+ */
+const fastscan = require('../src/index');
+const assert = require('assert');
+const fs = require('fs');
+const { spawn, execFileSync } = require('child_process');
+const os = require('os');
+const path = require('path');
+
+const tmpFile = path.join(os.tmpdir(), `fastscan-fuzz-${process.pid}.log`);
+const dictFile = path.join(os.tmpdir(), `fastscan-fuzz-${process.pid}.dict`);
+const fifoFile = path.join(os.tmpdir(), `fastscan-fuzz-${process.pid}.fifo`);
+
+// Every case from here on runs on the started pool; a second warmup is a no-op
+const workers = fastscan.warmup();
+assert.ok(Number.isInteger(workers) && workers >= 0 && fastscan.warmup() === workers);
+
+let seed = Number(process.env.SEED || 12345);
+function rand(n) {
+    seed = (seed * 1103515245 + 12345) & 0x7fffffff;
+    return seed % n;
+}
+
+function expected(buf, needle, max) {
+    const out = [];
+    let i = 0;
+    while (out.length < max) {
+        const j = buf.indexOf(needle, i);
+        if (j < 0) break;
+        out.push(j);
+        i = j + 1;
+    }
+    return out;
+}
+
+const SIZES = [1, 7, 63, 64, 65, 200, 4096, 65537, 300000, 1 << 21];
+const LENGTHS = [1, 2, 3, 4, 5, 8, 9, 16, 17, 40, 300, 2000];
+const ALPHABET = 'ab\nE:R ';
+
+// 'skewed': small alphabet => dense candidates and matches across chunk boundaries
+// 'random': high entropy => long needles take the sampled skip engine
+// 'mixed':  random first half, periodic second half => skip engine hands over mid-scan
+function fill(buf, style) {
+    const half = buf.length >> 1;
+    for (let i = 0; i < buf.length; i++) {
+        if (style === 'random' || (style === 'mixed' && i < half)) buf[i] = rand(256);
+        else buf[i] = ALPHABET.charCodeAt(rand(rand(4) ? 3 : ALPHABET.length));
+    }
+}
+
+// Multi-pattern reference: every pattern's matches, ordered by (offset, pattern id)
+function expectedMulti(buf, needles, max) {
+    const all = [];
+    needles.forEach((needle, id) => {
+        for (const off of expected(buf, needle, Infinity)) all.push([off, id]);
+    });
+    all.sort((a, b) => a[0] - b[0] || a[1] - b[1]);
+    return all.slice(0, max);
+}
+
+// Lines holding at least one of the ascending match offsets, as [lineNumber, start, end]
+function expectedLines(buf, offsets, max) {
+    const out = [];
+    let line = 1, lineStart = 0, scanned = 0;
+    for (const off of offsets) {
+        if (out.length && off <= out[out.length - 1][2]) continue;
+        if (out.length >= max) break;
+        for (; scanned < off; scanned++) {
+            if (buf[scanned] === 10) { line++; lineStart = scanned + 1; }
+        }
+        const nl = buf.indexOf(10, off);
+        out.push([line, lineStart, nl < 0 ? buf.length : nl]);
+    }
+    return out;
+}
+
+function gotLines(res) {
+    return Array.from(res.starts, (start, i) => [Number(res.lineNumbers[i]), Number(start), Number(res.ends[i])]);
+}
+
+// A random substring of buf made ASCII and NUL-free in place
+function pickNeedle(buf, len) {
+    const at = rand(buf.length - len + 1);
+    for (let i = at; i < at + len; i++) {
+        buf[i] &= 0x7f;
+        if (buf[i] === 0) buf[i] = 1;
+    }
+    return Buffer.from(buf.subarray(at, at + len));
+}
+
+// Regex reference: sticky RegExp at every position of every line ('s': `.` takes
+// everything but the newline, which never reaches it)
+function expectedRegex(buf, source, max) {
+    const out = [];
+    // Per line, as the scan sees it: `.` stops at \r, and ^ / $ also hold after / before one
+    const re = new RegExp(source, 'my');
+    const text = buf.toString('latin1');
+    let ls = 0;
+    while (ls <= text.length && out.length < max) {
+        let le = text.indexOf('\n', ls);
+        if (le < 0) le = text.length;
+        const line = text.slice(ls, le);
+        const last = le < text.length ? line.length : line.length - 1;
+        for (let i = 0; i <= last && out.length < max; i++) {
+            re.lastIndex = i;
+            if (re.test(line)) out.push(ls + i);
+        }
+        ls = le + 1;
+    }
+    return out;
+}
+
+const RE_ATOMS = ['a', 'b', 'E', 'R', ':', ' ', '.', '[ab]', '[^a]', '[E-b]', '\\s', '\\w', '\\d', '(a|b)', '(?:E:|R)', 'ab:', 'R R'];
+const RE_QUANTS = ['', '', '', '*', '+', '?', '{2}', '{1,3}', '{0,2}', '+?'];
+const RE_FIXED = ['ERROR.*timeout after \\d+ms', '^a', 'b$', '^$', '^(ab|ba)+$', 'E.*R', '[^\\s]{3}:', 'a*', '.$', '^.'];
+
+function randomRegex() {
+    const parts = [];
+    const n = 1 + rand(4);
+    for (let i = 0; i < n; i++) parts.push(RE_ATOMS[rand(RE_ATOMS.length)] + RE_QUANTS[rand(RE_QUANTS.length)]);
+    let src = parts.join('');
+    if (rand(4) === 0) src = '^' + src;
+    if (rand(4) === 0) src += '$';
+    if (rand(5) === 0) src += '|' + RE_ATOMS[rand(RE_ATOMS.length)] + 'E';
+    return src;
+}
+
+let cases = 0;
+try {
+    // Pipes are read in 1MB blocks: matches across block boundaries, lines longer than a block,
+    // and a writer that pauses (the reader hands over a short block) must not change any result
+    {
+        execFileSync('mkfifo', [fifoFile]);
+        const viaPipe = (scan, pause) => {
+            const writer = pause
+                ? `head -c ${pause} "${tmpFile}"; sleep 0.3; tail -c +${pause + 1} "${tmpFile}"`
+                : `cat "${tmpFile}"`;
+            spawn('sh', ['-c', `(${writer}) > "${fifoFile}"`], { stdio: 'ignore' });
+            return scan(fifoFile);
+        };
+
+        for (const style of ['random', 'skewed']) {
+            const buf = Buffer.alloc((3 << 20) + rand(4096));
+            fill(buf, style);
+            if (style === 'random') buf.fill('a', 1 << 20, (2 << 20) + 5000);
+            fs.writeFileSync(tmpFile, buf);
+
+            for (const len of [1, 4, 17, 2000]) {
+                const needle = pickNeedle(buf, len);
+                needle.copy(buf, (1 << 20) - (len >> 1));
+                fs.writeFileSync(tmpFile, buf);
+                const want = expected(buf, needle, Infinity);
+                const pattern = needle.toString('latin1');
+                assert.deepStrictEqual(Array.from(viaPipe(f => fastscan.scanFile(f, pattern, 1e8)), Number), want, `pipe ${style} ${len}`);
+                assert.strictEqual(viaPipe(f => fastscan.countFile(f, pattern)), want.length, `pipe count ${style} ${len}`);
+                assert.deepStrictEqual(gotLines(viaPipe(f => fastscan.scanFileLines(f, pattern, 1e8), 4096 + rand(4096))),
+                    expectedLines(buf, want, Infinity), `pipe lines ${style} ${len}`);
+                assert.deepStrictEqual(Array.from(viaPipe(f => fastscan.scanFile(f, pattern, 5)), Number), want.slice(0, 5));
+                cases++;
+            }
+
+            const needles = [pickNeedle(buf, 3), pickNeedle(buf, 9), Buffer.from('aa')];
+            fs.writeFileSync(tmpFile, buf);
+            const res = viaPipe(f => fastscan.scanFileMulti(f, needles.map(n => n.toString('latin1')), 1e8), 1 << 20);
+            const got = Array.from(res.offsets, (off, i) => [Number(off), res.patternIds[i]]);
+            assert.deepStrictEqual(got, expectedMulti(buf, needles, 1e8), `pipe multi ${style}`);
+
+            for (const source of ['a[ab]:', '^a+b', '^$']) {
+                assert.deepStrictEqual(Array.from(viaPipe(f => fastscan.scanFileRegex(f, source, 1e8)), Number),
+                    expectedRegex(buf, source, Infinity), `pipe regex ${style} ${source}`);
+            }
+            cases++;
+        }
+    }
+
+    for (const style of ['skewed', 'random', 'mixed']) {
+        for (const size of SIZES) {
+            const buf = Buffer.alloc(size);
+            fill(buf, style);
+
+            for (const len of LENGTHS) {
+                if (len > size) continue;
+
+                // Pattern bytes are kept ASCII so the JS string maps 1:1 to bytes
+                const at = rand(size - len + 1);
+                for (let i = at; i < at + len; i++) buf[i] &= 0x7f;
+                if (buf[at] === 0) buf[at] = 1;
+                const needle = Buffer.from(buf.subarray(at, at + len));
+                if (needle.includes(0)) continue;
+
+                // Plant extra copies so sparse styles still produce matches
+                for (let k = 0; k < 3 && size > 4 * len; k++) needle.copy(buf, rand(size - len));
+
+                fs.writeFileSync(tmpFile, buf);
+                const max = rand(3) === 0 ? 1 + rand(100) : 10000000;
+
+                const want = expected(buf, needle, max);
+                // Every other case goes through a compiled pattern
+                const pattern = cases % 2 ? fastscan.compile(needle.toString('latin1')) : needle.toString('latin1');
+                const got = Array.from(fastscan.scanFile(tmpFile, pattern, max), Number);
+                assert.deepStrictEqual(got, want, `style=${style} size=${size} len=${len} max=${max} compiled=${cases % 2}`);
+                if (max === 10000000) {
+                    assert.strictEqual(fastscan.countFile(tmpFile, pattern), want.length, `count style=${style} size=${size} len=${len}`);
+                    const maxLines = rand(2) ? 1 + rand(50) : 10000000;
+                    assert.deepStrictEqual(gotLines(fastscan.scanFileLines(tmpFile, pattern, maxLines)), expectedLines(buf, want, maxLines),
+                        `lines style=${style} size=${size} len=${len} max=${maxLines}`);
+                }
+                cases++;
+            }
+        }
+    }
+
+    for (const style of ['skewed', 'random']) {
+        for (const size of SIZES) {
+            const buf = Buffer.alloc(size);
+            fill(buf, style);
+
+            // Up to 64: packed SIMD matcher; above: dictionary
+            for (const count of [1, 2, 5, 8, 9, 24, 64, 65, 500, 5000]) {
+                if (count > 64 && (size < 4096 || count * size > 4e8)) continue;
+                const needles = [];
+                // (big sets skip the shortest lengths to keep the reference affordable)
+                const minIndex = count > 64 ? 4 : 0;
+                for (let i = 0; i < count; i++) {
+                    const len = Math.min(size, LENGTHS[minIndex + rand(LENGTHS.length - 1 - minIndex)]);
+                    needles.push(pickNeedle(buf, len));
+                }
+                // Duplicates and nested prefixes must all be reported
+                if (count > 2) needles[count - 1] = needles[0];
+                if (count > 3 && needles[1].length > 1) needles[2] = needles[1].subarray(0, needles[1].length >> 1);
+
+                fs.writeFileSync(tmpFile, buf);
+                const max = rand(3) === 0 ? 1 + rand(100) : 10000000;
+
+                const want = expectedMulti(buf, needles, max);
+                const list = needles.map(n => n.toString('latin1'));
+                const res = fastscan.scanFileMulti(tmpFile, cases % 2 ? fastscan.compile(list) : list, max);
+                const got = Array.from(res.offsets, (off, i) => [Number(off), res.patternIds[i]]);
+                assert.deepStrictEqual(got, want, `multi style=${style} size=${size} count=${count} max=${max} compiled=${cases % 2}`);
+                if (max === 10000000) {
+                    assert.strictEqual(fastscan.countFile(tmpFile, fastscan.compile(list)), want.length, `multi count style=${style} size=${size} count=${count}`);
+                }
+                cases++;
+            }
+        }
+    }
+
+    // Regular expressions: ASCII text ('skewed', or random 7-bit with sparse newlines)
+    for (const style of ['skewed', 'ascii']) {
+        for (const size of [1, 63, 65, 4096, 300000, 1 << 21]) {
+            const buf = Buffer.alloc(size);
+            if (style === 'ascii') {
+                for (let i = 0; i < size; i++) buf[i] = rand(64) ? 32 + rand(95) : (rand(2) ? 10 : rand(2) ? 13 : rand(32));
+            } else {
+                fill(buf, 'skewed');
+            }
+            fs.writeFileSync(tmpFile, buf);
+
+            const sources = size > 300000 ? [RE_FIXED[0], randomRegex()] : [...RE_FIXED, randomRegex(), randomRegex(), randomRegex()];
+            for (const source of sources) {
+                const max = rand(3) === 0 ? 1 + rand(100) : 10000000;
+                const want = expectedRegex(buf, source, max);
+                const regex = cases % 2 ? fastscan.compile(source, { regex: true }) : source;
+                const got = Array.from(fastscan.scanFileRegex(tmpFile, regex, max), Number);
+                assert.deepStrictEqual(got, want, `regex style=${style} size=${size} re=/${source}/ max=${max} compiled=${cases % 2}`);
+                if (max === 10000000) {
+                    const compiled = fastscan.compile(source, { regex: true });
+                    assert.strictEqual(fastscan.countFile(tmpFile, compiled), want.length, `regex count re=/${source}/`);
+                    assert.deepStrictEqual(gotLines(fastscan.scanFileLines(tmpFile, compiled, 10000000)), expectedLines(buf, want, Infinity),
+                        `regex lines re=/${source}/`);
+                }
+                cases++;
+            }
+        }
+    }
+
+    // Dictionary file: line i is pattern i, empty lines and \r\n are allowed
+    {
+        const buf = Buffer.alloc(1 << 20);
+        fill(buf, 'random');
+        const needles = [];
+        for (let i = 0; i < 2000; i++) needles.push(pickNeedle(buf, 1 + rand(30)));
+        fs.writeFileSync(tmpFile, buf);
+        fs.writeFileSync(dictFile, needles.map((n, i) => (i % 7 === 3 ? '' : n.toString('latin1')) + (i % 2 ? '\r\n' : '\n')).join(''));
+
+        const dict = fastscan.loadDictionary(dictFile);
+        assert.strictEqual(dict.size, needles.length);
+
+        const live = needles.map((n, i) => (i % 7 === 3 ? Buffer.from('\0no-match\0') : n));
+        const want = expectedMulti(buf, live, 10000000);
+        const res = fastscan.scanFileMulti(tmpFile, dict, 10000000);
+        const got = Array.from(res.offsets, (off, i) => [Number(off), res.patternIds[i]]);
+        assert.deepStrictEqual(got, want, 'dictionary file');
+        cases++;
+    }
+
+    // Enough work-stealing tasks to split any machine's share: matches packed into one region,
+    // plus copies straddling every page-aligned boundary a task could end on
+    {
+        const buf = Buffer.alloc(24 << 20, 'log line without the word\n');
+        const needle = Buffer.from('ERROR timeout');
+        for (let i = 0; i < 20000; i++) needle.copy(buf, (9 << 20) + rand(1 << 20));
+        for (let b = 4096; b < buf.length; b += 4096 * (1 + rand(64))) needle.copy(buf, b - 1 - rand(needle.length - 1));
+        fs.writeFileSync(tmpFile, buf);
+
+        const want = expected(buf, needle, Infinity);
+        assert.deepStrictEqual(Array.from(fastscan.scanFile(tmpFile, 'ERROR timeout', 10000000), Number), want, 'clustered');
+        assert.deepStrictEqual(Array.from(fastscan.scanFile(tmpFile, 'ERROR timeout', 777), Number), want.slice(0, 777), 'clustered max');
+        assert.strictEqual(fastscan.countFile(tmpFile, 'ERROR timeout'), want.length, 'clustered count');
+        assert.deepStrictEqual(Array.from(fastscan.scanFile(tmpFile, 'ERROR timeout', 10000000, { threads: 3 }), Number), want,
+            'clustered threads');
+        assert.strictEqual(fastscan.countFile(tmpFile, 'ERROR timeout', { threads: 5 }), want.length, 'clustered count threads');
+        assert.deepStrictEqual(gotLines(fastscan.scanFileLines(tmpFile, 'ERROR timeout', 10000000)), expectedLines(buf, want, Infinity),
+            'clustered lines');
+        assert.deepStrictEqual(gotLines(fastscan.scanFileLines(tmpFile, 'ERROR timeout', 50)), expectedLines(buf, want, 50),
+            'clustered lines max');
+
+        // Millions of hits: every task chains several result slabs, all placed in one array
+        const dense = expected(buf, Buffer.from('o'), Infinity);
+        assert.deepStrictEqual(Array.from(fastscan.scanFile(tmpFile, 'o', 10000000), Number), dense, 'dense');
+        assert.deepStrictEqual(Array.from(fastscan.scanFile(tmpFile, 'o', 12289), Number), dense.slice(0, 12289), 'dense max');
+        cases++;
+    }
+
+    // io_uring reads 4MB blocks in completion order, and windowed scans map windows per thread: matches
+    // straddling every block boundary, a short last block and a file smaller than one block give what
+    // the whole mapping gives (kernels without io_uring map in every mode)
+    for (const size of [(17 << 20) + 12345, 100000]) {
+        const buf = Buffer.alloc(size, 'log line without the word\n');
+        const needle = Buffer.from('ERROR timeout');
+        const long = Buffer.from(Array.from({ length: 300 }, () => 97 + rand(26)));
+        for (let b = 4 << 20; b < size; b += 4 << 20) {
+            needle.copy(buf, b - 1 - rand(needle.length - 1));
+            long.copy(buf, b - 1 - rand(long.length - 1) - 64);
+        }
+        needle.copy(buf, size - needle.length);
+        for (let i = 0; i < 500; i++) needle.copy(buf, rand(size - needle.length));
+        fs.writeFileSync(tmpFile, buf);
+
+        const want = expected(buf, needle, Infinity);
+        const wantMulti = expectedMulti(buf, [needle, long, Buffer.from('word')], Infinity);
+        const list = [needle.toString('latin1'), long.toString('latin1'), 'word'];
+        for (const io of ['uring', 'direct', 'window', 'once', 'mmap', 'auto']) {
+            const tag = `io=${io} size=${size}`;
+            assert.deepStrictEqual(Array.from(fastscan.scanFile(tmpFile, 'ERROR timeout', 10000000, { io }), Number), want, tag);
+            assert.deepStrictEqual(Array.from(fastscan.scanFile(tmpFile, 'ERROR timeout', 33, { io, threads: 3 }), Number),
+                want.slice(0, 33), `${tag} max`);
+            assert.strictEqual(fastscan.countFile(tmpFile, 'ERROR timeout', { io }), want.length, `${tag} count`);
+
+            const res = fastscan.scanFileMulti(tmpFile, list, 10000000, { io });
+            assert.deepStrictEqual(Array.from(res.offsets, (off, i) => [Number(off), res.patternIds[i]]), wantMulti, `${tag} multi`);
+            assert.strictEqual(fastscan.countFile(tmpFile, fastscan.compile(list), { io }), wantMulti.length, `${tag} multi count`);
+            assert.deepStrictEqual(gotLines(fastscan.scanFileLines(tmpFile, 'ERROR timeout', 10000000, { io })),
+                expectedLines(buf, want, Infinity), `${tag} lines`);
+            cases++;
+        }
+    }
+    assert.throws(() => fastscan.scanFile(tmpFile, 'ERROR', 10, { io: 'aio' }), fastscan.errors.InvalidArgumentError);
+
+    // One compiled pattern of each kind, reused across files and through scanFile
+    {
+        const literal = fastscan.compile('needle');
+        const list = fastscan.compile(['need', 'needle', 'le']);
+        const regex = fastscan.compile(/ne+dle$/m);
+        assert.deepStrictEqual([literal.kind, list.kind, regex.kind], ['literal', 'multi', 'regex']);
+        assert.deepStrictEqual([literal.maxLength, list.size, regex.maxLength], [6, 3, Infinity]);
+
+        for (const text of ['a needle\nneedle', 'no match here', 'needleneedle']) {
+            const buf = Buffer.from(text);
+            fs.writeFileSync(tmpFile, buf);
+            assert.deepStrictEqual(Array.from(fastscan.scanFile(tmpFile, literal), Number), expected(buf, Buffer.from('needle'), Infinity));
+            assert.deepStrictEqual(Array.from(fastscan.scanFile(tmpFile, regex), Number), expectedRegex(buf, 'ne+dle$', Infinity));
+
+            const res = fastscan.scanFile(tmpFile, list);
+            const got = Array.from(res.offsets, (off, i) => [Number(off), res.patternIds[i]]);
+            assert.deepStrictEqual(got, expectedMulti(buf, ['need', 'needle', 'le'].map(n => Buffer.from(n)), Infinity));
+            cases++;
+        }
+
+        assert.throws(() => fastscan.scanFileRegex(tmpFile, literal), fastscan.errors.FastScanError);
+        assert.throws(() => fastscan.scanFileMulti(tmpFile, regex), fastscan.errors.FastScanError);
+        assert.throws(() => fastscan.compile('a(', { regex: true }), fastscan.errors.FastScanError);
+        assert.throws(() => fastscan.compile('x'.repeat(5000)), fastscan.errors.FastScanError);
+    }
+} finally {
+    fs.rmSync(tmpFile, { force: true });
+    fs.rmSync(dictFile, { force: true });
+    fs.rmSync(fifoFile, { force: true });
+}
+
+// Async scans and their AbortSignal: a scan aborted in flight (or before it starts) rejects with AbortError
+async function asyncCases() {
+    const buf = Buffer.alloc(8 << 20, 'o');
+    buf.write('oox', 5 << 20);
+    fs.writeFileSync(tmpFile, buf);
+    try {
+        const live = new AbortController();
+        const got = await fastscan.scanFileAsync(tmpFile, 'oox', 10, { signal: live.signal });
+        assert.deepStrictEqual(Array.from(got, Number), [5 << 20]);
+        assert.strictEqual(await fastscan.countFileAsync(tmpFile, 'oox', { signal: live.signal }), 1);
+        cases++;
+
+        // The last report covers the whole file and the final match count
+        for (const [start, matches] of [
+            [onProgress => fastscan.scanFileAsync(tmpFile, 'oox', 10, { onProgress, progressInterval: 1 }), 1],
+            [onProgress => fastscan.countFileAsync(tmpFile, 'o', { onProgress }), buf.length - 1],
+            [onProgress => fastscan.scanFileLinesAsync(tmpFile, 'x', 10, { onProgress }), 1],
+        ]) {
+            const reports = [];
+            await start(r => reports.push(r));
+            assert.ok(reports.length >= 1);
+            assert.deepStrictEqual(reports[reports.length - 1], { bytesScanned: buf.length, totalBytes: buf.length, matches });
+            assert.ok(reports.every(r => r.bytesScanned <= r.totalBytes));
+            cases++;
+        }
+
+        // Streaming: batches joined equal the one-shot result, entries at one offset never split between batches
+        // (also when each scan window maps windows of its own)
+        const streams = [['oox', Infinity], ['o', 200001, 'window'], [fastscan.compile(['o', 'oo', 'ooo']), 200001, 'window']];
+        for (const [pattern, max, io] of streams) {
+            const offsets = [];
+            const ids = [];
+            for await (const batch of fastscan.scanBatches(tmpFile, pattern, max, { io })) {
+                assert.ok((batch.offsets || batch).length <= 65536);
+                offsets.push(...Array.from(batch.offsets || batch, Number));
+                if (batch.patternIds) ids.push(...batch.patternIds);
+            }
+            const want = pattern instanceof fastscan.Pattern
+                ? fastscan.scanFileMulti(tmpFile, pattern, max)
+                : { offsets: fastscan.scanFile(tmpFile, pattern, Number.isFinite(max) ? max : 1000) };
+            assert.deepStrictEqual(offsets, Array.from(want.offsets, Number));
+            if (want.patternIds) assert.deepStrictEqual(ids, Array.from(want.patternIds));
+            cases++;
+        }
+        // More entries at one offset than a batch holds: they come in one longer batch, none dropped
+        {
+            const dupFile = tmpFile + '.dup';
+            fs.writeFileSync(dupFile, 'xoxxo');
+            const batches = [];
+            for await (const batch of fastscan.scanBatches(dupFile, fastscan.compile(Array(70000).fill('o')))) {
+                batches.push([batch.offsets.length, ...new Set(Array.from(batch.offsets, Number))]);
+            }
+            fs.unlinkSync(dupFile);
+            assert.deepStrictEqual(batches, [[70000, 1], [70000, 4]]);
+            cases++;
+        }
+        for (const [path, options] of [[tmpFile, { io: 'bogus' }], [tmpFile, { threads: -3 }], [42, {}]]) {
+            await assert.rejects(fastscan.scanBatches(path, 'o', 10, options).next(), fastscan.errors.InvalidArgumentError);
+        }
+        await assert.rejects(fastscan.scanBatches(tmpFile, '', 10).next(), fastscan.errors.InvalidArgumentError);
+        for await (const m of fastscan.scanIterator(tmpFile, 'o', 1 << 23)) {
+            assert.deepStrictEqual(m, { index: 0, offset: 0n });
+            break;
+        }
+        // More unread streams than the executor has threads: other async scans still run
+        {
+            const open = Array.from({ length: 20 }, () => fastscan.scanBatches(tmpFile, 'o', 1 << 23));
+            await Promise.all(open.map(it => it.next()));
+            assert.strictEqual((await fastscan.scanFileAsync(tmpFile, 'oox', 10)).length, 1);
+            await Promise.all(open.map(it => it.return()));
+            cases++;
+        }
+
+        // A match at every byte: 64MB of offsets, far too long to finish before the abort lands
+        for (const start of [
+            signal => fastscan.scanFileAsync(tmpFile, 'o', 1 << 23, { signal }),
+            signal => fastscan.scanFileMultiAsync(tmpFile, ['o', 'oo'], 1 << 23, { signal }),
+        ]) {
+            const ac = new AbortController();
+            const pending = start(ac.signal);
+            ac.abort('closed');
+            await assert.rejects(pending, err => err instanceof fastscan.errors.AbortError && err.cause === 'closed');
+            await assert.rejects(start(ac.signal), fastscan.errors.AbortError);
+            cases++;
+        }
+        assert.throws(() => fastscan.scanFileAsync(tmpFile, 'o', 1, { signal: {} }), fastscan.errors.FastScanError);
+
+        // A pipe: batches come as blocks are read, and an abort reaches a reader waiting on an idle writer
+        execFileSync('mkfifo', [fifoFile]);
+        const writers = [];
+        const idlePipe = () => writers.push(spawn('sh', ['-c', `(printf 'oox\\n'; sleep 30) > "${fifoFile}"`], { stdio: 'ignore' }));
+        try {
+            idlePipe();
+            const seen = [];
+            const stream = new AbortController();
+            await assert.rejects((async () => {
+                for await (const batch of fastscan.scanBatches(fifoFile, 'oox', Infinity, { signal: stream.signal })) {
+                    seen.push(...Array.from(batch, Number));
+                    stream.abort();
+                }
+            })(), fastscan.errors.AbortError);
+            assert.deepStrictEqual(seen, [0]);
+
+            idlePipe();
+            const count = new AbortController();
+            const pending = fastscan.countFileAsync(fifoFile, 'oox', { signal: count.signal });
+            setTimeout(() => count.abort(), 50);
+            await assert.rejects(pending, fastscan.errors.AbortError);
+
+            // More scans waiting on a pipe than the executor has threads: other async scans still run
+            const waiting = Array.from({ length: 20 }, () => {
+                const ac = new AbortController();
+                return [ac, fastscan.countFileAsync(fifoFile, 'oox', { signal: ac.signal })];
+            });
+            idlePipe();
+            assert.strictEqual((await fastscan.scanFileAsync(tmpFile, 'oox', 10)).length, 1);
+            const settled = waiting.map(([ac, p]) => (ac.abort(), assert.rejects(p, fastscan.errors.AbortError)));
+            await Promise.all(settled);
+        } finally {
+            for (const w of writers) w.kill();
+        }
+        cases++;
+        cases++;
+        cases++;
+    } finally {
+        fs.rmSync(tmpFile, { force: true });
+        fs.rmSync(fifoFile, { force: true });
+    }
+}
+
+asyncCases().then(() => {
+    console.log(`✅ fuzz: ${cases} cases passed (${fastscan.simd})`);
+}, err => {
+    console.error(err);
+    process.exitCode = 1;
+});